@@ -0,0 +1,246 @@
+#include "Bench.hpp"
+#include "Memory.hpp"
+#include "ProgramCache.hpp"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef GLITTER_COMMIT
+#define GLITTER_COMMIT "unknown"
+#endif
+
+namespace
+{
+    // Nearest-rank percentile of sorted samples
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    }
+
+    std::string escape(const std::string& text)
+    {
+        std::string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                result += c;
+        }
+        return result;
+    }
+
+    void usage()
+    {
+        std::cerr << "Usage: GlitterBench [--iterations N] [--warmup N] [--filter TEXT]\n"
+                     "                    [--output FILE] [--scratch PREFIX]\n"
+                     "                    [--model FILE] [--texture FILE] [--egl]" << std::endl;
+    }
+}
+
+Bench::Bench(int argc, char* argv[])
+    : ok(true), useEgl(false), iterationCount(30), warmupCount(3), scratchPrefix("GlitterBench.")
+{
+    for (int i = 1; i < argc && ok; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--egl")
+            useEgl = true;
+        else if (arg == "--iterations" && hasValue)
+            iterationCount = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 1));
+        else if (arg == "--warmup" && hasValue)
+            warmupCount = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 0));
+        else if (arg == "--filter" && hasValue)
+            filter = argv[++i];
+        else if (arg == "--output" && hasValue)
+            output = argv[++i];
+        else if (arg == "--scratch" && hasValue)
+            scratchPrefix = argv[++i];
+        else if (arg == "--model" && hasValue)
+            modelPath = argv[++i];
+        else if (arg == "--texture" && hasValue)
+            texturePath = argv[++i];
+        else
+            ok = false;
+    }
+    if (!ok)
+        usage();
+}
+
+double Bench::now()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool Bench::selected(const std::string& name) const
+{
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+Bench::Scenario& Bench::scenario(const std::string& name)
+{
+    for (auto& existing : scenarios)
+        if (existing.name == name)
+            return existing;
+    scenarios.push_back({ name, std::vector<double>(), 0, false });
+    return scenarios.back();
+}
+
+void Bench::run(const std::string& name, const std::function<void()>& body,
+                const std::function<void()>& prepare)
+{
+    if (!selected(name))
+        return;
+    std::cerr << "Running " << name << std::endl;
+    scenario(name).counted = true;
+    for (unsigned int i = 0; i < warmupCount + iterationCount; ++i)
+    {
+        if (prepare)
+            prepare();
+        uint64_t allocations = heapAllocations();
+        double begin = now();
+        body();
+        double elapsed = now() - begin;
+        allocations = heapAllocations() - allocations;
+        if (i >= warmupCount)
+        {
+            sample(name, elapsed);
+            scenario(name).allocations += allocations;
+        }
+    }
+}
+
+void Bench::sample(const std::string& name, double milliseconds)
+{
+    scenario(name).samples.push_back(milliseconds);
+}
+
+void Bench::describe(const std::string& key, const std::string& value)
+{
+    facts.push_back(std::make_pair(key, value));
+}
+
+bool Bench::write() const
+{
+    std::ostringstream json;
+    json.precision(6);
+    json << std::fixed;
+    json << "{\n  \"commit\": \"" << escape(GLITTER_COMMIT) << "\",\n"
+         << "  \"iterations\": " << iterationCount << ",\n"
+         << "  \"warmup\": " << warmupCount << ",\n";
+    for (const auto& fact : facts)
+        json << "  \"" << escape(fact.first) << "\": \"" << escape(fact.second) << "\",\n";
+    json << "  \"unit\": \"ms\",\n  \"scenarios\": [";
+
+    std::fprintf(stderr, "\n%-32s %10s %10s %10s %10s %10s\n", "Scenario", "min", "p50", "p90", "p99", "max");
+    for (size_t i = 0; i < scenarios.size(); ++i)
+    {
+        std::vector<double> sorted = scenarios[i].samples;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (double value : sorted)
+            mean += value;
+        mean = sorted.empty() ? 0.0 : mean / sorted.size();
+
+        json << (i ? ",\n" : "\n")
+             << "    { \"name\": \"" << escape(scenarios[i].name) << "\", \"samples\": " << sorted.size()
+             << ", \"min\": " << (sorted.empty() ? 0.0 : sorted.front())
+             << ", \"mean\": " << mean
+             << ", \"p50\": " << percentile(sorted, 50.0)
+             << ", \"p90\": " << percentile(sorted, 90.0)
+             << ", \"p95\": " << percentile(sorted, 95.0)
+             << ", \"p99\": " << percentile(sorted, 99.0)
+             << ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back());
+        if (scenarios[i].counted)
+            json << ", \"allocations\": " << (sorted.empty() ? 0.0 : double(scenarios[i].allocations) / sorted.size());
+        json << " }";
+        std::fprintf(stderr, "%-32s %10.3f %10.3f %10.3f %10.3f %10.3f\n", scenarios[i].name.c_str(),
+                     sorted.empty() ? 0.0 : sorted.front(), percentile(sorted, 50.0),
+                     percentile(sorted, 90.0), percentile(sorted, 99.0),
+                     sorted.empty() ? 0.0 : sorted.back());
+    }
+    json << "\n  ]\n}\n";
+
+    if (output.empty())
+    {
+        std::cout << json.str();
+        return bool(std::cout);
+    }
+    std::ofstream file(output);
+    if (!(file << json.str()))
+    {
+        std::cerr << "ERROR::BENCH::OUTPUT_NOT_WRITTEN " << output << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    Bench bench(argc, argv);
+    if (!bench.valid())
+        return EXIT_FAILURE;
+
+    // CPU-only scenarios first, so they run even where no context can be made
+    benchModelLoad(bench);
+    benchTextureDecode(bench);
+    benchPhysicsStep(bench);
+
+    // A hidden window is enough for offscreen work. With --egl the context
+    // comes from EGL, and on GLFW builds with the null platform no display
+    // server is needed at all.
+#if defined(GLFW_PLATFORM) && defined(GLFW_PLATFORM_NULL)
+    if (bench.egl())
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+    GLFWwindow* window = nullptr;
+    if (glfwInit())
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+#ifdef GLFW_EGL_CONTEXT_API
+        if (bench.egl())
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#endif
+        window = glfwCreateWindow(64, 64, "GlitterBench", nullptr, nullptr);
+    }
+
+    if (window == nullptr)
+    {
+        std::cerr << "ERROR::BENCH::NO_CONTEXT GL scenarios skipped" << std::endl;
+        bench.describe("renderer", "none");
+    }
+    else
+    {
+        glfwMakeContextCurrent(window);
+        glfwSwapInterval(0);
+        gladLoadGL();
+        bench.describe("renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        bench.describe("version", reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+        // Keep cached binaries away from the application's own cache
+        ProgramCache::get().setDirectory(bench.scratch() + "cache");
+        benchShaderCompile(bench);
+        benchDrawSubmit(bench);
+        glfwDestroyWindow(window);
+    }
+    glfwTerminate();
+    return bench.write() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
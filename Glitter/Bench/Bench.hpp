@@ -0,0 +1,85 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// Harness behind the GlitterBench target. Each scenario is run for a few
+// untimed warm-up iterations and then a fixed number of timed ones, and the
+// samples are summarised as percentiles so runs on different commits can be
+// diffed from the JSON alone.
+//
+//     GlitterBench --iterations 50 --filter draw --output bench.json
+class Bench
+{
+public:
+    Bench(int argc, char* argv[]);
+
+    // False if the arguments were malformed or --help was given
+    bool valid() const { return ok; }
+
+    // True if the scenario matches --filter (every scenario by default)
+    bool selected(const std::string& name) const;
+
+    unsigned int iterations() const { return iterationCount; }
+    unsigned int warmup() const { return warmupCount; }
+
+    // Time body once per iteration; prepare runs untimed before each call.
+    // Heap allocations during the timed calls are reported per iteration.
+    void run(const std::string& name, const std::function<void()>& body,
+             const std::function<void()>& prepare = nullptr);
+
+    // Add one sample for scenarios that time themselves
+    void sample(const std::string& name, double milliseconds);
+
+    // Free-form facts about the run, e.g. the GL renderer
+    void describe(const std::string& key, const std::string& value);
+
+    // Scratch files are written next to this prefix; removed by the scenarios
+    const std::string& scratch() const { return scratchPrefix; }
+
+    // Optional real assets to load instead of the generated ones
+    const std::string& model() const { return modelPath; }
+    const std::string& texture() const { return texturePath; }
+    bool egl() const { return useEgl; }
+
+    // Print a table to stderr and write the JSON to --output or stdout
+    bool write() const;
+
+    static double now();
+
+private:
+    struct Scenario
+    {
+        std::string name;
+        std::vector<double> samples;
+        uint64_t allocations; // Over every timed run() iteration
+        bool counted;         // Timed by run(), so allocations are known
+    };
+
+    Scenario& scenario(const std::string& name);
+
+    bool ok;
+    bool useEgl;
+    unsigned int iterationCount;
+    unsigned int warmupCount;
+    std::string filter;
+    std::string output;
+    std::string scratchPrefix;
+    std::string modelPath;
+    std::string texturePath;
+    std::vector<std::pair<std::string, std::string>> facts;
+    std::vector<Scenario> scenarios;
+};
+
+// Scenarios; each needs the GL context current unless noted
+void benchModelLoad(Bench& bench);     // No context needed
+void benchTextureDecode(Bench& bench); // No context needed
+void benchShaderCompile(Bench& bench);
+void benchDrawSubmit(Bench& bench);
+void benchPhysicsStep(Bench& bench);   // No context needed
+
+#endif
@@ -0,0 +1,398 @@
+#include "Bench.hpp"
+#include "GLState.hpp"
+#include "ProgramCache.hpp"
+#include "Shader.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <btBulletDynamicsCommon.h>
+#include <glad/glad.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Same post-processing Mirage::Mesh asks Assimp for
+    const unsigned int importFlags = aiProcessPreset_TargetRealtime_MaxQuality
+                                   | aiProcess_OptimizeGraph
+                                   | aiProcess_FlipUVs;
+
+    // One unit cube per object, each with its own material so they stay separate sub-meshes
+    void writeModel(const std::string& path, unsigned int parts)
+    {
+        std::ofstream obj(path);
+        std::ofstream mtl(path + ".mtl");
+        size_t slash = path.find_last_of("/\\");
+        obj << "mtllib " << path.substr(slash == std::string::npos ? 0 : slash + 1) << ".mtl\n";
+        const int corners[8][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+                                    { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } };
+        const int faces[6][4] = { { 1, 4, 3, 2 }, { 5, 6, 7, 8 }, { 1, 2, 6, 5 },
+                                  { 2, 3, 7, 6 }, { 3, 4, 8, 7 }, { 4, 1, 5, 8 } };
+        for (unsigned int i = 0; i < parts; ++i)
+        {
+            float x = float(i % 32) * 2.0f, y = float(i / 32 % 32) * 2.0f, z = float(i / 1024) * 2.0f;
+            mtl << "newmtl part" << i << "\nKd " << (i % 7) / 7.0f << " 0.5 0.5\n";
+            obj << "o part" << i << "\nusemtl part" << i << "\n";
+            for (const auto& corner : corners)
+                obj << "v " << x + corner[0] << " " << y + corner[1] << " " << z + corner[2] << "\n";
+            obj << "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n";
+            int base = int(i) * 8, uv = int(i) * 4;
+            for (const auto& face : faces)
+                obj << "f " << base + face[0] << "/" << uv + 1 << " " << base + face[1] << "/" << uv + 2 << " "
+                    << base + face[2] << "/" << uv + 3 << " " << base + face[3] << "/" << uv + 4 << "\n";
+        }
+    }
+
+    uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+    {
+        static uint32_t table[256] = { 0 };
+        if (table[1] == 0)
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void appendBig(std::vector<unsigned char>& out, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<unsigned char>(value >> shift));
+    }
+
+    void appendChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+    {
+        appendBig(png, static_cast<uint32_t>(data.size()));
+        size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        appendBig(png, crc32(&png[start], png.size() - start));
+    }
+
+    // An RGBA PNG with Sub-filtered rows in stored deflate blocks. There is
+    // no encoder in the tree, so decoding exercises stb's PNG parsing, inflate
+    // and unfiltering, but not Huffman decoding; pass --texture for that.
+    std::vector<unsigned char> makePng(unsigned int size)
+    {
+        std::vector<unsigned char> raw;
+        raw.reserve(size * (size * 4 + 1));
+        for (unsigned int y = 0; y < size; ++y)
+        {
+            raw.push_back(1);
+            for (unsigned int x = 0; x < size * 4; ++x)
+                raw.push_back(static_cast<unsigned char>((x * 7 + y * 13) ^ (x * y >> 5)));
+        }
+
+        std::vector<unsigned char> zlib = { 0x78, 0x01 };
+        for (size_t offset = 0; offset < raw.size(); offset += 65535)
+        {
+            size_t length = std::min<size_t>(65535, raw.size() - offset);
+            zlib.push_back(offset + length == raw.size() ? 1 : 0);
+            zlib.push_back(static_cast<unsigned char>(length));
+            zlib.push_back(static_cast<unsigned char>(length >> 8));
+            zlib.push_back(static_cast<unsigned char>(~length));
+            zlib.push_back(static_cast<unsigned char>(~length >> 8));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+        }
+        uint32_t a = 1, b = 0;
+        for (unsigned char value : raw)
+        {
+            a = (a + value) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBig(zlib, (b << 16) | a);
+
+        std::vector<unsigned char> header;
+        appendBig(header, size);
+        appendBig(header, size);
+        header.insert(header.end(), { 8, 6, 0, 0, 0 });
+        std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        appendChunk(png, "IHDR", header);
+        appendChunk(png, "IDAT", zlib);
+        appendChunk(png, "IEND", std::vector<unsigned char>());
+        return png;
+    }
+
+    void writeFile(const std::string& path, const std::string& text)
+    {
+        std::ofstream file(path);
+        file << text;
+    }
+
+    const char* vertexSource = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+uniform vec2 offset;
+void main()
+{
+    gl_Position = vec4(aPos.xy * 0.01 + offset, aPos.z, 1.0);
+}
+)";
+
+    const char* fragmentSource = R"(#version 330 core
+out vec4 FragColor;
+uniform vec4 color;
+void main()
+{
+    FragColor = color;
+}
+)";
+}
+
+void benchModelLoad(Bench& bench)
+{
+    const unsigned int sizes[] = { 64, 1024 };
+    for (unsigned int parts : sizes)
+    {
+        std::string name = "model_load_" + std::to_string(parts);
+        if (!bench.selected(name))
+            continue;
+        std::string path = bench.scratch() + "model" + std::to_string(parts) + ".obj";
+        writeModel(path, parts);
+        bench.run(name, [&]()
+        {
+            Assimp::Importer importer;
+            if (importer.ReadFile(path, importFlags) == nullptr)
+                std::cerr << "ERROR::BENCH::MODEL_NOT_LOADED " << importer.GetErrorString() << std::endl;
+        });
+        std::remove(path.c_str());
+        std::remove((path + ".mtl").c_str());
+    }
+
+    if (!bench.model().empty())
+        bench.run("model_load_file", [&]()
+        {
+            Assimp::Importer importer;
+            importer.ReadFile(bench.model(), importFlags);
+        });
+}
+
+void benchTextureDecode(Bench& bench)
+{
+    std::vector<unsigned char> png = makePng(1024);
+    bench.run("texture_decode_1024", [&]()
+    {
+        int width, height, channels;
+        unsigned char* image = stbi_load_from_memory(png.data(), int(png.size()), &width, &height, &channels, 0);
+        if (image == nullptr)
+            std::cerr << "ERROR::BENCH::TEXTURE_NOT_DECODED " << stbi_failure_reason() << std::endl;
+        stbi_image_free(image);
+    });
+
+    if (!bench.texture().empty())
+        bench.run("texture_decode_file", [&]()
+        {
+            int width, height, channels;
+            stbi_image_free(stbi_load(bench.texture().c_str(), &width, &height, &channels, 0));
+        });
+}
+
+void benchShaderCompile(Bench& bench)
+{
+    std::string vertexPath = bench.scratch() + "bench.vert";
+    std::string fragmentPath = bench.scratch() + "bench.frag";
+
+    // Cold: a fresh comment every iteration misses any driver-side cache
+    // keyed on the source, and the program cache is emptied before each build
+    unsigned int salt = 0;
+    bench.run("shader_compile_cold", [&]()
+    {
+        Shader shader(vertexPath.c_str(), fragmentPath.c_str());
+        GLState::get().deleteProgram(shader.ID);
+    }, [&]()
+    {
+        std::string comment = "// " + std::to_string(Bench::now()) + " " + std::to_string(salt++) + "\n";
+        writeFile(vertexPath, vertexSource + comment);
+        writeFile(fragmentPath, fragmentSource + comment);
+        ProgramCache::get().clear();
+    });
+
+    // Warm: the first build stores the binary, later ones restore it
+    if (bench.selected("shader_compile_warm"))
+    {
+        ProgramCache::get().clear();
+        writeFile(vertexPath, vertexSource);
+        writeFile(fragmentPath, fragmentSource);
+        Shader primer(vertexPath.c_str(), fragmentPath.c_str());
+        GLState::get().deleteProgram(primer.ID);
+        bench.run("shader_compile_warm", [&]()
+        {
+            Shader shader(vertexPath.c_str(), fragmentPath.c_str());
+            GLState::get().deleteProgram(shader.ID);
+        });
+    }
+    std::remove(vertexPath.c_str());
+    std::remove(fragmentPath.c_str());
+    ProgramCache::get().clear();
+}
+
+void benchDrawSubmit(Bench& bench)
+{
+    const unsigned int counts[] = { 10000, 100000 };
+    bool any = false;
+    for (unsigned int draws : counts)
+        any = any || bench.selected("draw_submit_" + std::to_string(draws));
+    if (!any)
+        return;
+
+    // Offscreen target, since a hidden window's pixels may never be owned
+    GLuint framebuffer, colour;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colour);
+    glBindRenderbuffer(GL_RENDERBUFFER, colour);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 256, 256);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+    glViewport(0, 0, 256, 256);
+
+    float vertices[] = { -1.0f, -1.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+    unsigned int indices[] = { 0, 1, 2 };
+    GLuint vertexArray, buffers[2];
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(2, buffers);
+    GLState::get().bindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+    glEnableVertexAttribArray(0);
+
+    std::string vertexPath = bench.scratch() + "draw.vert";
+    std::string fragmentPath = bench.scratch() + "draw.frag";
+    writeFile(vertexPath, vertexSource);
+    writeFile(fragmentPath, fragmentSource);
+    Shader shader(vertexPath.c_str(), fragmentPath.c_str());
+    shader.use();
+    shader.setVec4("color", glm::vec4(1.0f));
+    int offset = shader.uniform("offset");
+
+    // Submit is the CPU cost of issuing the calls; complete waits for the GPU too
+    for (unsigned int draws : counts)
+    {
+        std::string suffix = std::to_string(draws);
+        if (!bench.selected("draw_submit_" + suffix))
+            continue;
+        std::cerr << "Running draw_submit_" << suffix << std::endl;
+        for (unsigned int i = 0; i < bench.warmup() + bench.iterations(); ++i)
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+            glFinish();
+            double begin = Bench::now();
+            for (unsigned int draw = 0; draw < draws; ++draw)
+            {
+                shader.setVec2(offset, glm::vec2(float(draw % 100) / 50.0f - 1.0f, float(draw / 100 % 100) / 50.0f - 1.0f));
+                glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
+            }
+            double submitted = Bench::now();
+            glFinish();
+            double completed = Bench::now();
+            if (i < bench.warmup())
+                continue;
+            bench.sample("draw_submit_" + suffix, submitted - begin);
+            bench.sample("draw_complete_" + suffix, completed - begin);
+        }
+    }
+
+    GLState::get().deleteProgram(shader.ID);
+    GLState::get().deleteVertexArray(vertexArray);
+    glDeleteBuffers(2, buffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colour);
+    std::remove(vertexPath.c_str());
+    std::remove(fragmentPath.c_str());
+}
+
+void benchPhysicsStep(Bench& bench)
+{
+    const unsigned int counts[] = { 256, 2048 };
+    for (unsigned int bodies : counts)
+    {
+        std::string name = "physics_step_" + std::to_string(bodies);
+        if (!bench.selected(name))
+            continue;
+
+        btDefaultCollisionConfiguration configuration;
+        btCollisionDispatcher dispatcher(&configuration);
+        btDbvtBroadphase broadphase;
+        btSequentialImpulseConstraintSolver solver;
+        btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &configuration);
+        world.setGravity(btVector3(0, -9.81f, 0));
+
+        btStaticPlaneShape groundShape(btVector3(0, 1, 0), 0);
+        btRigidBody ground(0, nullptr, &groundShape);
+        world.addRigidBody(&ground);
+
+        // Loose columns of boxes that fall, collide and settle the same way every run
+        btBoxShape boxShape(btVector3(0.5f, 0.5f, 0.5f));
+        btVector3 inertia(0, 0, 0);
+        boxShape.calculateLocalInertia(1, inertia);
+        std::vector<std::unique_ptr<btDefaultMotionState>> states;
+        std::vector<std::unique_ptr<btRigidBody>> boxes;
+        std::vector<btTransform> starts;
+        unsigned int side = static_cast<unsigned int>(std::ceil(std::sqrt(bodies / 8.0)));
+        for (unsigned int i = 0; i < bodies; ++i)
+        {
+            btVector3 origin(btScalar(i % side) * 1.1f, 1.0f + btScalar(i / (side * side)) * 1.2f,
+                             btScalar(i / side % side) * 1.1f);
+            starts.push_back(btTransform(btQuaternion::getIdentity(), origin));
+            states.emplace_back(new btDefaultMotionState(starts.back()));
+            btRigidBody::btRigidBodyConstructionInfo info(1, states.back().get(), &boxShape, inertia);
+            boxes.emplace_back(new btRigidBody(info));
+            world.addRigidBody(boxes.back().get());
+        }
+
+        // Every sample times the same step: the boxes are put back where they
+        // started and stepped untimed for half a second, while they collide
+        const int warmSteps = 30;
+        auto restore = [&]()
+        {
+            for (size_t i = 0; i < boxes.size(); ++i)
+            {
+                btRigidBody& box = *boxes[i];
+                box.setWorldTransform(starts[i]);
+                box.setInterpolationWorldTransform(starts[i]);
+                states[i]->setWorldTransform(starts[i]);
+                box.setLinearVelocity(btVector3(0, 0, 0));
+                box.setAngularVelocity(btVector3(0, 0, 0));
+                box.setInterpolationLinearVelocity(btVector3(0, 0, 0));
+                box.setInterpolationAngularVelocity(btVector3(0, 0, 0));
+                box.clearForces();
+                box.forceActivationState(ACTIVE_TAG);
+                box.setDeactivationTime(0);
+                broadphase.getOverlappingPairCache()->cleanProxyFromPairs(box.getBroadphaseHandle(), &dispatcher);
+            }
+            solver.reset();
+            world.updateAabbs();
+            for (int step = 0; step < warmSteps; ++step)
+                world.stepSimulation(btScalar(1.0 / 60.0), 0);
+        };
+
+        bench.run(name, [&]()
+        {
+            world.stepSimulation(btScalar(1.0 / 60.0), 0);
+        }, restore);
+
+        for (auto& box : boxes)
+            world.removeRigidBody(box.get());
+        world.removeRigidBody(&ground);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef EXTENSIONS_H
+#define EXTENSIONS_H
+
+// Tokens from extensions that the bundled glad headers may not have been generated with
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_TEXTURE_SPARSE_ARB
+#define GL_TEXTURE_SPARSE_ARB 0x91A6
+#define GL_VIRTUAL_PAGE_SIZE_INDEX_ARB 0x91A7
+#define GL_NUM_SPARSE_LEVELS_ARB 0x91AA
+#define GL_NUM_VIRTUAL_PAGE_SIZES_ARB 0x91A8
+#define GL_VIRTUAL_PAGE_SIZE_X_ARB 0x9195
+#define GL_VIRTUAL_PAGE_SIZE_Y_ARB 0x9196
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Check whether the current context exposes an extension, e.g. "GL_KHR_parallel_shader_compile".
+// The extension list is queried once, on the first call, which must come from a thread with the
+// context current (normally right after gladLoadGL); later calls are safe from any thread.
+bool hasExtension(const char* name);
+
+#endif
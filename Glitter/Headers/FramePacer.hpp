@@ -0,0 +1,85 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+struct GLFWwindow;
+
+// How buffer swaps wait for the display
+enum class SwapMode
+{
+    Immediate, // No vsync; tears, lowest latency
+    VSync,     // Wait for every vertical blank
+    Adaptive,  // Vsync, but late frames swap at once instead of waiting a whole refresh
+};
+
+struct PacingOptions
+{
+    unsigned int framesInFlight = 2;  // Frames the CPU may run ahead of the GPU
+    SwapMode swap = SwapMode::VSync;
+    double frameLimit = 0.0;          // Frames per second; 0 leaves pacing to the swap
+    bool lowLatency = false;          // Wait for the previous frame before sampling input
+};
+
+// Keeps the CPU a bounded number of frames ahead of the GPU. Every frame is
+// fenced when it is swapped, and begin() waits on the fence of the frame
+// that last used the slot it hands out, so per-frame resources indexed by
+// slot() are never written while the GPU still reads them. A limiter with
+// a drift-free deadline spaces frames evenly when vsync alone doesn't.
+//
+//     FramePacer pacer(window);
+//     while (!glfwWindowShouldClose(window))
+//     {
+//         pacer.begin();    // may wait on the GPU, then on the limiter
+//         glfwPollEvents(); // input is sampled as late as possible
+//         ... update and draw using buffers[pacer.slot()] ...
+//         pacer.end();      // fences the frame and swaps
+//     }
+class FramePacer
+{
+public:
+    explicit FramePacer(GLFWwindow* window, const PacingOptions& options = PacingOptions());
+    ~FramePacer();
+
+    void setSwapMode(SwapMode mode);
+    void setFrameLimit(double framesPerSecond);
+    void setLowLatency(bool value) { options.lowLatency = value; }
+    const PacingOptions& settings() const { return options; }
+
+    // Wait until the slot for the next frame is free, then for the limiter
+    void begin();
+
+    // Fence everything issued this frame and present it
+    void end();
+
+    // Index of the current frame's resources, below framesInFlight()
+    unsigned int slot() const { return current; }
+    unsigned int framesInFlight() const { return options.framesInFlight; }
+
+    // Last frame's start-to-start time, and how much of it went to waiting
+    double frameMilliseconds() const { return frameTime; }
+    double gpuWaitMilliseconds() const { return gpuWait; }
+    double limiterWaitMilliseconds() const { return limiterWait; }
+
+private:
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    static void wait(GLsync& fence);
+    static double now();
+
+    GLFWwindow* window;
+    PacingOptions options;
+    std::vector<GLsync> fences; // One per slot, set when its frame was swapped
+    unsigned int current;
+    unsigned int previous;
+    double deadline;
+    double frameStart;
+    double frameTime;
+    double gpuWait;
+    double limiterWait;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+
+
+// Shadow copy of the binding state of the current context. Binds that would
+// not change anything are skipped. Code that binds through raw GL calls must
+// call invalidate() afterwards, and objects should be deleted through the
+// delete* functions so stale names are never treated as bound.
+class GLState
+{
+public:
+    // One tracker per context; Glitter only ever renders from one context,
+    // and ShaderLibrary's watcher context just compiles and links
+    static GLState& get();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+    void bindBuffer(GLenum target, GLuint buffer);
+
+    GLuint program() const { return currentProgram; }
+    GLuint vertexArray() const { return currentVertexArray; }
+
+    // Delete objects and drop them from the shadow state
+    void deleteProgram(GLuint program);
+    void deleteVertexArray(GLuint vertexArray);
+    void deleteTexture(GLuint texture);
+    void deleteBuffer(GLuint buffer);
+
+    // True the first time it is called for a program, so one-off per-program
+    // setup (such as assigning sampler units) runs exactly once
+    bool configure(GLuint program);
+
+    // Forget everything, e.g. after third-party code changed bindings
+    void invalidate();
+
+    // Bind calls issued and skipped since the last resetCounters()
+    std::size_t issued() const { return issuedCount; }
+    std::size_t skipped() const { return skippedCount; }
+    void resetCounters() { issuedCount = skippedCount = 0; }
+
+private:
+    GLState();
+
+    static const GLuint maxUnits = 32;
+    struct Unit { GLenum target; GLuint texture; };
+
+    GLuint currentProgram;
+    GLuint currentVertexArray;
+    GLuint activeUnit;
+    Unit units[maxUnits];
+    std::unordered_map<GLenum, GLuint> buffers;
+    std::unordered_set<GLuint> configured;
+    std::size_t issuedCount;
+    std::size_t skippedCount;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+// One queued unit of work. The counter, if any, drops when it finishes.
+struct Job
+{
+    std::function<void()> work;
+    const char* name;
+    JobCounter* counter;
+    bool main; // Only the main thread may run it
+};
+
+// Number of unfinished jobs tied to it. Wait on it with JobSystem::wait(),
+// or queue follow-up jobs that start once it reaches zero with after().
+// Must outlive every job that counts against it.
+class JobCounter
+{
+public:
+    JobCounter() : value(0) {}
+    bool done() const { return value.load(std::memory_order_acquire) == 0; }
+    int pending() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+    friend class JobSystem;
+
+    std::atomic<int> value;
+    std::mutex mutex;              // Guards continuations and the final decrement
+    std::vector<Job> continuations;
+};
+
+// Process-wide work-stealing scheduler. Each worker owns a deque: it pushes
+// and pops its own jobs at the back, and idle workers steal from the front
+// of the others, so a job's children tend to run hot in the same cache.
+// Jobs queued from threads outside the pool land in a shared deque the
+// workers also steal from. GL calls must stay on the context thread, so
+// runOnMain() jobs wait in their own queue until that thread calls pump()
+// or waits on a counter. Whoever waits runs other jobs in the meantime,
+// so waiting inside a job never deadlocks the pool.
+//
+//     JobCounter decoded;
+//     for (auto& image : images)
+//         JobSystem::get().run([&image]() { image.decode(); }, &decoded, "Decode");
+//     JobSystem::get().after(decoded, [&]() { upload(images); }, nullptr, "Upload", true);
+//     JobSystem::get().parallelFor(0, objects.size(), 256, [&](size_t begin, size_t end) { ... });
+//
+// The first call to get() must come from the GL thread, which becomes the
+// main thread.
+class JobSystem
+{
+public:
+    static JobSystem& get();
+    ~JobSystem();
+
+    // Queue a job; counter is raised now and lowered when the job finishes
+    void run(std::function<void()> work, JobCounter* counter = nullptr, const char* name = "Job");
+
+    // Queue a job for the main thread only
+    void runOnMain(std::function<void()> work, JobCounter* counter = nullptr, const char* name = "Main Job");
+
+    // Queue a job once dependency reaches zero, at once if it already has
+    void after(JobCounter& dependency, std::function<void()> work, JobCounter* counter = nullptr,
+               const char* name = "Job", bool onMain = false);
+
+    // Run queued main-thread jobs for up to budget seconds (all of them if
+    // zero), always at least one; returns how many ran. Main thread only.
+    size_t pump(double budget = 0.0);
+
+    // Block until counter reaches zero, running other jobs meanwhile
+    void wait(JobCounter& counter);
+
+    // Split [begin, end) into chunks of at least grain items, run body on
+    // each across the pool and the calling thread, and wait for all of them
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& body);
+
+    unsigned int workers() const { return static_cast<unsigned int>(threads.size()); }
+    bool onMainThread() const { return std::this_thread::get_id() == mainThread; }
+
+private:
+    JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Ring of jobs that keeps its storage, so steady queuing never allocates
+    struct Queue
+    {
+        Queue() : first(0), count(0) {}
+        void pushBack(Job&& job);
+        Job popBack();
+        Job popFront();
+
+        std::mutex mutex;
+        std::vector<Job> jobs; // Size is zero or a power of two
+        size_t first;
+        size_t count;
+    };
+
+    void push(Job&& job);
+    void pushMain(Job&& job);
+    bool take(Job& job);
+    bool takeMain(Job& job);
+    void execute(Job& job);
+    void finish(JobCounter* counter);
+    void loop(unsigned int index);
+
+    // One per worker, then the shared deque for outside threads
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    Queue mainJobs;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;     // Workers: something was queued
+    std::condition_variable finished; // Waiters: some counter reached zero
+    std::atomic<int> queued;          // Jobs in the worker and shared deques
+    std::atomic<bool> quit;
+    std::thread::id mainThread;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Set to 0 to leave the global operator new alone; the counters then stay zero
+#ifndef GLITTER_COUNT_ALLOCATIONS
+#define GLITTER_COUNT_ALLOCATIONS 1
+#endif
+
+// Heap allocations since startup on every thread, counted by the global
+// operator new in Memory.cpp. The profiler turns them into a per-frame count.
+uint64_t heapAllocations();
+uint64_t heapBytes();
+
+// Linear allocator for data that only lives until the end of the frame.
+// allocate() bumps one atomic offset, so any thread may take memory while
+// a frame is recorded, and reset() gives it all back at once; call it on
+// the GL thread at the top of the frame, once nothing from the last one is
+// still being read. Requests past the end are served from the heap for the
+// rest of the frame, and the next reset() grows the block to fit them.
+//
+//     FrameVector<DrawData> draws;     // Memory comes from FrameArena::get()
+//     draws.reserve(count);
+//     FrameArena::get().reset();       // Next frame; draws must be gone by now
+class FrameArena
+{
+public:
+    static FrameArena& get();
+    explicit FrameArena(size_t capacity = 1 << 20);
+    ~FrameArena();
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    void reset();
+
+    // Bytes handed out this frame, overflow included; the most in any frame
+    size_t used() const { return offset.load(std::memory_order_relaxed); }
+    size_t peak() const { return highWater; }
+    size_t capacity() const { return size; }
+
+private:
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    std::unique_ptr<unsigned char[]> memory;
+    size_t size;
+    std::atomic<size_t> offset;
+    size_t highWater;
+
+    std::mutex overflowMutex;
+    std::vector<void*> overflow; // Heap blocks freed by the next reset()
+};
+
+// Standard allocator over a FrameArena. Deallocation does nothing, so a
+// container using it must be dropped before the arena is next reset.
+template <typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameAllocator() : arena(&FrameArena::get()) {}
+    explicit FrameAllocator(FrameArena& source) : arena(&source) {}
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const FrameAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <typename U> friend class FrameAllocator;
+    FrameArena* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// Fixed-size blocks carved out of chunks that are kept until the pool goes
+// away, recycled through a free list threaded through the unused blocks.
+// Keeps many small nodes of one type next to each other and, once the
+// pool has grown to the working set, off the general heap entirely.
+//
+//     static PoolAllocator nodes(sizeof(Node), alignof(Node));
+//     Node* node = new (nodes.allocate()) Node();
+//     node->~Node();
+//     nodes.deallocate(node);
+class PoolAllocator
+{
+public:
+    PoolAllocator(size_t blockSize, size_t alignment, size_t blocksPerChunk = 64);
+
+    void* allocate();
+    void deallocate(void* block);
+
+    // Blocks handed out and not yet returned, and blocks owned in total
+    size_t live() const;
+    size_t reserved() const;
+
+private:
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    void grow();
+
+    size_t stride;
+    size_t alignment;
+    size_t chunkBlocks;
+    std::vector<std::unique_ptr<unsigned char[]>> chunks;
+    FreeBlock* freeList;
+    size_t liveCount;
+    mutable std::mutex mutex;
+};
+
+#endif
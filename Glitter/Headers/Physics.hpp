@@ -0,0 +1,119 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <btBulletDynamicsCommon.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TransformStore;
+
+// Bullet world stepped at a fixed rate on its own thread. After every step
+// the body transforms are published into a triple-buffered snapshot that
+// the render thread picks up without locking, and the renderer blends the
+// two latest steps so motion stays smooth at any frame rate. Rendering runs
+// one step behind the simulation in exchange.
+//
+//     PhysicsWorld physics(60.0);
+//     int crate = physics.addBody(new btRigidBody(info));
+//     physics.start();
+//     ...
+//     // Every frame, before drawing
+//     std::vector<glm::mat4> transforms;
+//     physics.interpolate(transforms);
+//     glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(transforms[crate]));
+//
+// Everything that touches Bullet objects after start() must go through
+// post(), which runs the edit on the physics thread before the next step.
+class PhysicsWorld
+{
+public:
+    explicit PhysicsWorld(double stepsPerSecond = 60.0, unsigned maxCatchUp = 4);
+    ~PhysicsWorld();
+
+    // Takes ownership of the body and its motion state (not its shape) and
+    // returns the body's index in interpolated transforms. Removing an id
+    // that is not live, e.g. twice, only logs an error.
+    int addBody(btRigidBody* body);
+    void removeBody(int id);
+    void post(std::function<void(btDiscreteDynamicsWorld&)> edit);
+
+    void start();
+    void stop();
+    bool running() const { return worker.joinable(); }
+
+    // Blend the latest two steps for the current time. Bodies that are
+    // removed or not yet stepped get the identity. False before any step.
+    bool interpolate(std::vector<glm::mat4>& transforms);
+
+    // Same, written into a store so only bodies that moved become dirty
+    bool interpolate(TransformStore& store);
+
+    // Steps simulated, and steps skipped because the thread fell behind
+    std::uint64_t steps() const { return stepCount; }
+    std::uint64_t dropped() const { return dropCount; }
+
+private:
+    struct Pose
+    {
+        glm::vec3 position;
+        glm::quat rotation;
+        bool live;
+    };
+
+    // One published step: the poses before and after it and when it was due
+    struct Snapshot
+    {
+        std::vector<Pose> previous;
+        std::vector<Pose> current;
+        double time;
+        std::uint64_t step;
+    };
+
+    const Snapshot* acquire(float& alpha);
+    static Pose blend(const Snapshot& snapshot, size_t index, float alpha);
+    void run();
+    void apply();
+    void publish(double time);
+
+    btDefaultCollisionConfiguration configuration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btDiscreteDynamicsWorld world;
+
+    // Physics thread only
+    std::vector<btRigidBody*> bodies;
+    std::vector<Pose> poses;
+
+    // Shared; guarded by editMutex
+    std::mutex editMutex;
+    std::vector<std::function<void(btDiscreteDynamicsWorld&)>> edits;
+    std::vector<int> freeIds;
+    std::vector<bool> liveIds; // Cleared as soon as removal is requested
+    int nextId;
+
+    // Triple buffer: the writer fills snapshots[writeSlot], then swaps it
+    // with the ready slot; the reader swaps its slot out only when fresh
+    static const unsigned freshBit = 4;
+    Snapshot snapshots[3];
+    std::atomic<unsigned> readySlot;
+    unsigned writeSlot;
+    unsigned readSlot;
+
+    std::thread worker;
+    std::atomic<bool> quit;
+    double stepLength;
+    unsigned catchUp;
+    std::atomic<std::uint64_t> stepCount;
+    std::atomic<std::uint64_t> dropCount;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Set to 0 to compile every scope macro away
+#ifndef GLITTER_PROFILE
+#define GLITTER_PROFILE 1
+#endif
+
+
+// Per-frame counters summed across threads
+namespace ProfileCounter
+{
+    enum : unsigned int
+    {
+        DrawCalls = 0,
+        Triangles,
+        Binds,         // Binds issued through GLState
+        SkippedBinds,  // Binds GLState found redundant
+        UploadBytes,
+        Allocations,   // Heap allocations on any thread during the frame
+        FrameBytes,    // Bytes taken from the FrameArena
+        Count,
+    };
+}
+
+// Summary of one finished frame. gpuMilliseconds stays negative until the
+// frame's timer queries come back, a few frames later.
+struct FrameStats
+{
+    uint64_t frame;
+    double cpuMilliseconds;
+    double gpuMilliseconds;
+    uint64_t counters[ProfileCounter::Count];
+};
+
+// Share of one frame a thread spent running jobs
+struct WorkerStats
+{
+    std::string name;
+    uint64_t jobs;
+    double busyMilliseconds;
+    double utilization; // Busy time over the frame's CPU time
+};
+
+// Frame profiler with nested CPU scopes on any thread and GPU scopes on the
+// GL thread. CPU scopes go into a per-thread ring that only its own thread
+// writes, published with one atomic store, so recording never locks. GPU
+// scopes are pairs of GL_TIMESTAMP queries kept in a ring of frames in flight
+// and read back only once available, so the CPU never waits on the GPU.
+//
+//     Profiler::get().beginFrame();
+//     { PROFILE_SCOPE("Cull"); bvh.cull(frustum, visible); }
+//     { PROFILE_GPU("Submit"); arena.submit(shader); }
+//     Profiler::get().endFrame();
+//     Profiler::get().writeTrace("frame.json"); // chrome://tracing
+class Profiler
+{
+public:
+    static Profiler& get();
+
+    void setEnabled(bool value) { enabled = value; }
+    bool isEnabled() const { return enabled; }
+
+    // Label the calling thread in traces
+    void nameThread(const std::string& name);
+
+    // Frame boundaries; call on the GL thread
+    void beginFrame();
+    void endFrame();
+
+    // CPU scopes; names must outlive the profiler (string literals)
+    void beginScope(const char* name);
+    void endScope();
+
+    // GPU scopes; GL thread only. Returns the slot to pass to endGpu.
+    int beginGpu(const char* name);
+    void endGpu(int slot);
+
+    void count(unsigned int counter, uint64_t amount = 1) { counters[counter] += amount; }
+
+    // Credit the calling thread with one job's run time
+    void addBusy(int64_t nanoseconds);
+
+    // Per-thread job time over the latest finished frame; threads that
+    // have never run a job are left out
+    const std::vector<WorkerStats>& workers() const { return workerStats; }
+
+    // Latest finished frame, and the mean over the frames still in history
+    const FrameStats& lastFrame() const;
+    FrameStats average() const;
+    void report() const;
+
+    // All recorded scopes as Chrome trace event JSON
+    bool writeTrace(const std::string& path) const;
+
+private:
+    Profiler();
+
+    struct Event
+    {
+        const char* name;
+        int64_t begin;
+        int64_t end;
+    };
+
+    // Written by one thread only; readers see events below head
+    struct ThreadBuffer
+    {
+        static const size_t capacity = 1 << 16;
+        std::vector<Event> events;
+        std::vector<Event> open; // Scopes not yet ended, innermost last
+        std::atomic<uint64_t> head;
+        std::atomic<uint64_t> busy; // Nanoseconds spent in jobs, ever
+        std::atomic<uint64_t> jobs;
+        uint64_t busySeen, jobsSeen; // As of the last endFrame(); GL thread only
+        std::string name;
+        unsigned int id;
+    };
+
+    struct GpuScope
+    {
+        const char* name;
+        unsigned int beginQuery;
+        unsigned int endQuery;
+    };
+
+    // One frame's timestamp queries; scope 0 brackets the whole frame
+    struct GpuFrame
+    {
+        std::vector<GLuint> queries;
+        std::vector<GpuScope> scopes;
+        unsigned int used;
+        uint64_t frame;
+        bool pending;
+    };
+
+    static const unsigned int framesInFlight = 4;
+    static const unsigned int historySize = 240;
+    static const size_t gpuEventLimit = 1 << 16;
+
+    ThreadBuffer& threadBuffer();
+    unsigned int query(GpuFrame& frame);
+    void resolve(GpuFrame& frame);
+    static int64_t now();
+
+    bool enabled;
+    bool gpuTimers;
+    int64_t gpuOffset; // Add to GPU timestamps to land on the CPU clock
+
+    mutable std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+    GpuFrame gpuFrames[framesInFlight];
+    std::vector<Event> gpuEvents; // Resolved, oldest overwritten first
+    size_t gpuEventHead;
+
+    std::atomic<uint64_t> counters[ProfileCounter::Count];
+    FrameStats history[historySize];
+    std::vector<WorkerStats> workerStats;
+    uint64_t frameIndex;
+    int64_t frameBegin;
+    size_t bindsAtBegin, skipsAtBegin;
+    uint64_t allocationsAtBegin;
+};
+
+// RAII wrappers behind the macros
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) { Profiler::get().beginScope(name); }
+    ~ProfileScope() { Profiler::get().endScope(); }
+};
+
+class ProfileGpuScope
+{
+public:
+    explicit ProfileGpuScope(const char* name) : slot(Profiler::get().beginGpu(name)) {}
+    ~ProfileGpuScope() { Profiler::get().endGpu(slot); }
+private:
+    int slot;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#if GLITTER_PROFILE
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU(name) ProfileGpuScope PROFILE_CONCAT(profileGpuScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU(name) ((void)0)
+#endif
+
+#endif
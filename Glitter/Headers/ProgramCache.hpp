@@ -0,0 +1,67 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <string>
+#include <vector>
+
+
+// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// Entries are keyed by a hash of the shader sources, any injected defines and
+// the GL vendor/renderer/version strings, so driver updates invalidate them.
+//
+//     auto key = ProgramCache::get().key({ vertexCode, fragmentCode });
+//     if (!ProgramCache::get().load(program, key))
+//     {
+//         ProgramCache::prepare(program);
+//         ... compile, attach and link ...
+//         ProgramCache::get().store(program, key);
+//     }
+class ProgramCache
+{
+public:
+    // Process-wide cache shared by every Shader
+    static ProgramCache& get();
+
+    // Directory that holds the cached binaries; created on first store
+    void setDirectory(const std::string& path);
+    const std::string& directory() const { return dir; }
+
+    // Turn caching off, e.g. while iterating on shaders
+    void setEnabled(bool value) { enabled = value; }
+
+    // Hash the sources, defines and current GL driver strings into a cache key
+    std::string key(const std::vector<std::string>& sources, const std::string& defines = "") const;
+
+    // Mark a program as retrievable; call before glLinkProgram on a cache miss
+    static void prepare(unsigned int program);
+
+    // Try to restore a linked program; false if missing or rejected by the driver
+    bool load(unsigned int program, const std::string& key);
+
+    // Write a successfully linked program to disk
+    bool store(unsigned int program, const std::string& key);
+
+    // Delete every cached binary, and the directory once empty, e.g. so
+    // timed builds really start cold
+    void clear();
+
+    // Hit/miss statistics. A rejected binary also counts as a miss.
+    unsigned int hits() const { return hitCount; }
+    unsigned int misses() const { return missCount; }
+    unsigned int rejected() const { return rejectCount; }
+    void report() const;
+
+private:
+    ProgramCache();
+
+    bool supported() const;
+    std::string path(const std::string& key) const;
+
+    std::string dir;
+    bool enabled;
+    unsigned int hitCount;
+    unsigned int missCount;
+    unsigned int rejectCount;
+};
+
+#endif
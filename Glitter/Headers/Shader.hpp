@@ -1,26 +1,55 @@
 #ifndef SHADER_H
 #define SHADER_H
-  
+
+#include <glm/glm.hpp>
+
 #include <string>
 #include <fstream>
-  
+#include <unordered_map>
+
 
 class Shader
 {
 public:
     // The program ID
     unsigned int ID;
-  
+
     // Constructor reads and builds the shader
     Shader(const char* vertexPath, const char* fragmentPath);
 
     // Use/activate the shader
     void use() const;
 
+    // Look up a cached uniform location; returns -1 if the uniform is not active
+    int uniform(const std::string &name) const;
+
     // Utility uniform functions
-    void setBool(const std::string &name, bool value) const;  
-    void setInt(const std::string &name, int value) const;   
+    void setBool(const std::string &name, bool value) const;
+    void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
+    void setVec2(const std::string &name, const glm::vec2 &value) const;
+    void setVec3(const std::string &name, const glm::vec3 &value) const;
+    void setVec4(const std::string &name, const glm::vec4 &value) const;
+    void setMat4(const std::string &name, const glm::mat4 &value) const;
+
+    // Location based uniform functions, for hot paths that cache uniform() results
+    void setBool(int location, bool value) const;
+    void setInt(int location, int value) const;
+    void setFloat(int location, float value) const;
+    void setVec2(int location, const glm::vec2 &value) const;
+    void setVec3(int location, const glm::vec3 &value) const;
+    void setVec4(int location, const glm::vec4 &value) const;
+    void setMat4(int location, const glm::mat4 &value) const;
+
+private:
+    // Compile, attach and link the sources into ID; used on a program cache miss
+    void compile(const std::string& vertexCode, const std::string& fragmentCode);
+
+    // Fill the uniform location table from the program's active uniforms
+    void cacheUniforms();
+
+    // Uniform name to location table, built once after linking
+    std::unordered_map<std::string, int> uniforms;
 };
-  
-#endif
\ No newline at end of file
+
+#endif
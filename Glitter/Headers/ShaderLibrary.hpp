@@ -0,0 +1,134 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct GLFWwindow;
+
+// Shader programs that rebuild themselves when their source files change.
+// Stage files are expanded by a small preprocessor that resolves #include
+// directives, and every file a stage reads is remembered. A watcher thread
+// polls those files on a hidden context sharing objects with the window;
+// only stages that read a changed file are recompiled, and only programs
+// using them are relinked. A finished program is fenced and swapped in by
+// update() between frames. A stage or link that fails leaves the old
+// program in place, so a typo never takes the frame down.
+//
+//     auto lit = ShaderLibrary::get().load({ "lit.vert", "lit.frag" });
+//     ShaderLibrary::get().watch(window);
+//     while (running)
+//     {
+//         ShaderLibrary::get().update();
+//         GLState::get().useProgram(ShaderLibrary::get().program(lit));
+//         ...
+//     }
+//     ShaderLibrary::get().unwatch(); // Before glfwTerminate()
+//
+// Includes are searched beside the including file, then in the library
+// directory, and each file is pasted at most once per stage. #line
+// directives keep compiler messages pointing at the right file: the source
+// string numbers in a log are listed under it.
+class ShaderLibrary
+{
+public:
+    static ShaderLibrary& get();
+    ~ShaderLibrary();
+
+    // Where relative stage names and includes are found; defaults to the
+    // source tree's Glitter/Shaders, not the copy made next to the binary
+    void setDirectory(const std::string& path) { dir = path; }
+    const std::string& directory() const { return dir; }
+
+    // Build a program from stage files, picking each stage from its extension
+    // (.vert, .tesc, .tese, .geom, .frag, .comp), through the program binary
+    // cache. The handle stays valid across rebuilds. GL thread only.
+    unsigned int load(const std::vector<std::string>& stages);
+
+    // The program's current GL name, 0 until it first builds. Uniform
+    // locations can change with every rebuild; generation() counts them.
+    GLuint program(unsigned int handle) const { return programs[handle].current; }
+    int uniform(unsigned int handle, const std::string& name) const;
+    unsigned int generation(unsigned int handle) const { return programs[handle].generation; }
+
+    // Start polling files every interval seconds on a context shared with
+    // window; both must be called from the GL thread
+    void watch(GLFWwindow* window, double interval = 0.25);
+    void unwatch();
+    bool watching() const { return worker.joinable(); }
+
+    // Swap in programs whose rebuild has finished on the GPU and delete the
+    // ones they replace; returns how many were swapped. GL thread only.
+    size_t update();
+
+    // Expand #include directives in a file. files, if given, receives every
+    // file read, the root first, in #line source string order.
+    static bool preprocess(const std::string& path, std::string& source,
+                           std::vector<std::string>* files = nullptr,
+                           const std::string& includeDirectory = "");
+
+private:
+    ShaderLibrary();
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    // One source file compiled as one stage; shared by every program using it
+    struct Stage
+    {
+        std::string path;
+        GLenum type;
+        GLuint shader;                  // 0 until compiled, e.g. after a cache hit
+        std::string source;             // Preprocessed text
+        std::vector<std::string> files; // Everything source was built from
+    };
+
+    struct Program
+    {
+        std::vector<size_t> stages;
+        std::unordered_map<std::string, int> uniforms;
+        GLuint current;
+        unsigned int generation;
+    };
+
+    // A rebuilt program waiting for its fence before update() swaps it in
+    struct Swap
+    {
+        size_t program;
+        GLuint id;
+        GLsync fence;
+    };
+
+    size_t addStage(const std::string& path);
+    bool compile(Stage& stage);
+    GLuint link(const Program& program, bool retrievable);
+    void track(const std::vector<std::string>& files);
+    void run();
+    void rebuild();
+
+    // Stages, the program list and stamps are guarded by mutex, which the
+    // watcher holds while it rebuilds; ready is guarded by readyMutex. A
+    // program's current, uniforms and generation are only touched on the GL
+    // thread, so update() never waits for a rebuild.
+    std::vector<Stage> stages;
+    std::vector<Program> programs;
+    std::unordered_map<std::string, std::pair<long long, long long>> stamps; // Modified nanoseconds, size
+    std::vector<Swap> ready;
+    std::mutex mutex;
+    std::mutex readyMutex;
+    std::condition_variable wake;
+    std::thread worker;
+    GLFWwindow* context;
+    double pollInterval;
+    bool stopping;
+    std::string dir;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Structure-of-arrays store of rigid transforms that mirrors itself into a
+// GPU buffer of column-major mat4s, one per entry. Positions, rotations and
+// scales live in separate contiguous arrays, so four entries convert to
+// matrices per SSE pass, and every write marks its block of four dirty.
+// upload() then sends only the dirty runs, merged when they sit close
+// together, so bodies at rest cost nothing.
+//
+//     physics.interpolate(store);         // writes only what moved
+//     store.upload();                     // converts and uploads dirty runs
+//     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, store.buffer());
+class TransformStore
+{
+public:
+    explicit TransformStore(size_t capacity = 0);
+    ~TransformStore();
+
+    // Grow or shrink to count entries; new ones are identity transforms
+    void resize(size_t count);
+    size_t size() const { return count; }
+
+    // Write one entry; writes that change nothing leave it clean
+    void set(size_t index, const glm::vec3& position, const glm::quat& rotation);
+    void setScale(size_t index, const glm::vec3& scale);
+
+    // Convert dirty blocks to matrices and upload them, then mark all clean
+    void upload();
+    GLuint buffer() const { return gpuBuffer; }
+    const glm::mat4* matrices() const { return converted.data(); }
+
+    // Bytes and glBufferSubData calls spent by the last upload()
+    size_t uploadedBytes() const { return lastBytes; }
+    size_t uploadCalls() const { return lastCalls; }
+
+private:
+    static const size_t blockSize = 4;
+
+    // Dirty runs closer than this many blocks are sent as one
+    static const size_t mergeGap = 4;
+
+    void markDirty(size_t index) { dirty[index / blockSize] = 1; }
+    void convert(size_t block);
+
+    size_t count;
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<std::uint8_t> dirty; // One flag per block
+    std::vector<glm::mat4> converted;
+
+    GLuint gpuBuffer;
+    size_t gpuCapacity; // Entries allocated in gpuBuffer
+    size_t lastBytes;
+    size_t lastCalls;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// Fixed binding points shared by every program. Shaders declare the blocks as
+//     layout (std140) uniform Camera { ... };
+// and Shader binds them by name after linking.
+namespace UniformBinding
+{
+    enum : unsigned int
+    {
+        Camera   = 0,
+        Frame    = 1,
+        Material = 2,
+        Object   = 3,
+    };
+}
+
+// Fixed shader storage binding points, declared in GLSL 4.3 as
+//     layout (std430, binding = 0) readonly buffer Draws { ... };
+namespace StorageBinding
+{
+    enum : unsigned int
+    {
+        Draws     = 0,
+        Instances = 1,
+        Commands  = 2, // Indirect draw commands written by compute culling
+        Counts    = 3, // Per-batch draw counts for MultiDraw*IndirectCount
+    };
+}
+
+// std140 layouts. Only vec4/mat4 members and scalars packed in groups of four,
+// so the C++ layout matches std140 without manual padding.
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 position;      // xyz = world position, w unused
+};
+
+struct FrameBlock
+{
+    glm::vec4 color;         // per-frame tint
+    float time;
+    float deltaTime;
+    float frameIndex;
+    float padding;
+};
+
+struct MaterialBlock
+{
+    glm::vec4 diffuse;
+    glm::vec4 specular;      // rgb = color, a = shininess
+};
+
+struct ObjectBlock
+{
+    glm::mat4 model;
+    glm::mat4 normal;
+};
+
+static_assert(sizeof(CameraBlock)   == 208, "CameraBlock must match std140");
+static_assert(sizeof(FrameBlock)    ==  32, "FrameBlock must match std140");
+static_assert(sizeof(MaterialBlock) ==  32, "MaterialBlock must match std140");
+static_assert(sizeof(ObjectBlock)   == 128, "ObjectBlock must match std140");
+
+// Assign the standard block names of a linked program to their binding points
+void bindUniformBlocks(unsigned int program);
+
+
+// Ring of per-frame uniform storage. Each frame gets its own segment that is
+// sub-allocated with push() and bound with bind(). On GL 4.4+ the buffer is
+// persistently mapped and segments are fenced; otherwise the buffer is
+// orphaned and re-mapped every frame.
+//
+//     ring.begin();
+//     auto offset = ring.push(frameBlock);
+//     ring.end();
+//     ring.bind(UniformBinding::Frame, offset, sizeof(FrameBlock));
+class UniformRing
+{
+public:
+    UniformRing(std::size_t segmentSize, unsigned int segments = 3);
+    ~UniformRing();
+
+    // Start writing the next frame's segment; waits if the GPU still reads it
+    void begin();
+
+    // Copy data into the current segment and return its offset in the buffer,
+    // or overflow when the segment is full (or begin() was not called)
+    static const std::size_t overflow = std::size_t(-1);
+    std::size_t push(const void* data, std::size_t size);
+    template<typename T> std::size_t push(const T& block) { return push(&block, sizeof(T)); }
+
+    // Finish writing; must be called before drawing with the pushed data
+    void end();
+
+    // Bind a pushed block to a binding point; an overflow offset binds nothing
+    void bind(unsigned int binding, std::size_t offset, std::size_t size) const;
+
+    bool persistent() const { return persistentMapping; }
+    unsigned int buffer() const { return ID; }
+
+private:
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    unsigned int ID;
+    std::size_t alignment;
+    std::size_t segmentSize;
+    unsigned int segments;
+    unsigned int segment;
+    std::size_t head;
+    bool persistentMapping;
+    unsigned char* mapped;
+    unsigned char* writing;
+    std::vector<GLsync> fences;
+};
+
+#endif
@@ -0,0 +1,9 @@
+#version 330 core
+
+// Colour and Depth Writes are Masked; Only the Samples That Pass Matter
+out vec4 color;
+
+void main()
+{
+    color = vec4(1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// Unit Cube Stretched Over an Occlusion Query's World-Space Box
+layout (location = 0) in vec3 position;
+
+uniform mat4 transform;
+
+void main()
+{
+    gl_Position = transform * vec4(position, 1.0);
+}
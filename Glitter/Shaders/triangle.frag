@@ -0,0 +1,10 @@
+#version 330 core
+
+// Flat Output of the Interpolated Vertex Colour
+out vec4 FragColor;
+in vec3 ourColor;
+
+void main()
+{
+    FragColor = vec4(ourColor, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+// Pass Each Corner's Colour on to be Blended Across the Triangle
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+
+out vec3 ourColor; // output a color to the fragment shader
+
+void main()
+{
+    gl_Position = vec4(aPos, 1.0);
+    ourColor = aColor;
+}
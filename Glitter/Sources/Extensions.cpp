@@ -0,0 +1,24 @@
+#include "Extensions.hpp"
+
+#include <glad/glad.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+bool hasExtension(const char* name)
+{
+    // Filled exactly once, so workers may ask while the render thread does;
+    // afterwards the set is only read
+    static std::unordered_set<std::string> extensions;
+    static std::once_flag filled;
+    std::call_once(filled, []()
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+            if (const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i))
+                extensions.insert(reinterpret_cast<const char*>(extension));
+    });
+    return extensions.count(name) > 0;
+}
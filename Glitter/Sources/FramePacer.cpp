@@ -0,0 +1,114 @@
+#include "FramePacer.hpp"
+#include "Profiler.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+FramePacer::FramePacer(GLFWwindow* window, const PacingOptions& settings)
+    : window(window), options(settings), current(0), previous(0),
+      deadline(0.0), frameStart(0.0), frameTime(0.0), gpuWait(0.0), limiterWait(0.0)
+{
+    options.framesInFlight = std::max(options.framesInFlight, 1u);
+    fences.assign(options.framesInFlight, nullptr);
+    setSwapMode(options.swap);
+    setFrameLimit(options.frameLimit);
+}
+
+FramePacer::~FramePacer()
+{
+    for (GLsync fence : fences)
+        if (fence)
+            glDeleteSync(fence);
+}
+
+double FramePacer::now()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+void FramePacer::setSwapMode(SwapMode mode)
+{
+    // Adaptive needs the tear extension; plain vsync is the closest fallback
+    options.swap = mode;
+    int interval = mode == SwapMode::Immediate ? 0 : 1;
+    if (mode == SwapMode::Adaptive && (glfwExtensionSupported("WGL_EXT_swap_control_tear")
+                                    || glfwExtensionSupported("GLX_EXT_swap_control_tear")))
+        interval = -1;
+    glfwSwapInterval(interval);
+}
+
+void FramePacer::setFrameLimit(double framesPerSecond)
+{
+    options.frameLimit = std::max(framesPerSecond, 0.0);
+    deadline = 0.0;
+}
+
+void FramePacer::wait(GLsync& fence)
+{
+    if (!fence)
+        return;
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void FramePacer::begin()
+{
+    // The slot's own fence bounds how far ahead we run; low latency also
+    // waits for the frame just swapped, so input is read right after it shows
+    double start = now();
+    {
+        PROFILE_SCOPE("Wait GPU");
+        if (options.lowLatency)
+            wait(fences[previous]);
+        wait(fences[current]);
+    }
+    double waited = now();
+    gpuWait = waited - start;
+
+    // Sleep most of the way to the deadline, then spin off the last stretch,
+    // since sleeps overshoot by up to a scheduler tick
+    limiterWait = 0.0;
+    if (options.frameLimit > 0.0)
+    {
+        PROFILE_SCOPE("Frame Limit");
+        double period = 1000.0 / options.frameLimit;
+        if (deadline == 0.0)
+            deadline = waited;
+        for (double remaining = deadline - now(); remaining > 0.0; remaining = deadline - now())
+        {
+            if (remaining > 2.0)
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(remaining - 1.5));
+            else
+                std::this_thread::yield();
+        }
+
+        // Advance from the deadline rather than from now, so the average rate
+        // holds; after a long stall, restart instead of rushing to catch up
+        double time = now();
+        limiterWait = time - waited;
+        deadline = std::max(deadline + period, time - period);
+    }
+
+    double time = now();
+    if (frameStart > 0.0)
+        frameTime = time - frameStart;
+    frameStart = time;
+}
+
+void FramePacer::end()
+{
+    // Fenced after the swap, so waiting on it also covers presentation
+    glfwSwapBuffers(window);
+    if (fences[current])
+        glDeleteSync(fences[current]);
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    previous = current;
+    current = (current + 1) % options.framesInFlight;
+}
@@ -0,0 +1,121 @@
+#include "GLState.hpp"
+
+GLState& GLState::get()
+{
+    static GLState state;
+    return state;
+}
+
+GLState::GLState()
+    : issuedCount(0), skippedCount(0)
+{
+    invalidate();
+}
+
+void GLState::invalidate()
+{
+    // ~0u never matches a real name, so the next bind of each kind is always issued
+    currentProgram = ~0u;
+    currentVertexArray = ~0u;
+    activeUnit = ~0u;
+    for (GLuint i = 0; i < maxUnits; i++)
+        units[i] = { GL_NONE, ~0u };
+    buffers.clear();
+}
+
+void GLState::useProgram(GLuint program)
+{
+    if (program == currentProgram)
+    {
+        skippedCount++;
+        return;
+    }
+    glUseProgram(program);
+    currentProgram = program;
+    issuedCount++;
+}
+
+void GLState::bindVertexArray(GLuint vertexArray)
+{
+    if (vertexArray == currentVertexArray)
+    {
+        skippedCount++;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    currentVertexArray = vertexArray;
+    // The element array binding belongs to the vertex array object
+    buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    issuedCount++;
+}
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    if (unit < maxUnits && units[unit].target == target && units[unit].texture == texture)
+    {
+        skippedCount++;
+        return;
+    }
+    if (unit != activeUnit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+    if (unit < maxUnits)
+        units[unit] = { target, texture };
+    issuedCount++;
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer)
+{
+    auto it = buffers.find(target);
+    if (it != buffers.end() && it->second == buffer)
+    {
+        skippedCount++;
+        return;
+    }
+    glBindBuffer(target, buffer);
+    buffers[target] = buffer;
+    issuedCount++;
+}
+
+void GLState::deleteProgram(GLuint program)
+{
+    glDeleteProgram(program);
+    configured.erase(program);
+    // A deleted program stays in use until replaced, but its name may be reused
+    if (program == currentProgram)
+        currentProgram = ~0u;
+}
+
+void GLState::deleteVertexArray(GLuint vertexArray)
+{
+    glDeleteVertexArrays(1, &vertexArray);
+    if (vertexArray == currentVertexArray)
+    {
+        currentVertexArray = 0;
+        buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    }
+}
+
+void GLState::deleteTexture(GLuint texture)
+{
+    glDeleteTextures(1, &texture);
+    for (GLuint i = 0; i < maxUnits; i++)
+        if (units[i].texture == texture)
+            units[i].texture = 0;
+}
+
+void GLState::deleteBuffer(GLuint buffer)
+{
+    glDeleteBuffers(1, &buffer);
+    for (auto& binding : buffers)
+        if (binding.second == buffer)
+            binding.second = 0;
+}
+
+bool GLState::configure(GLuint program)
+{
+    return configured.insert(program).second;
+}
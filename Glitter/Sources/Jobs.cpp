@@ -0,0 +1,287 @@
+#include "Jobs.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+namespace
+{
+    // Index of the calling thread's own deque; outside threads have none
+    thread_local int workerIndex = -1;
+
+    int64_t nanoseconds()
+    {
+        using namespace std::chrono;
+        return duration_cast<std::chrono::nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+void JobSystem::Queue::pushBack(Job&& job)
+{
+    if (count == jobs.size())
+    {
+        // Unwrap into a larger ring, oldest first
+        std::vector<Job> grown(std::max<size_t>(jobs.size() * 2, 16));
+        for (size_t i = 0; i < count; ++i)
+            grown[i] = std::move(jobs[(first + i) & (jobs.size() - 1)]);
+        jobs.swap(grown);
+        first = 0;
+    }
+    jobs[(first + count++) & (jobs.size() - 1)] = std::move(job);
+}
+
+Job JobSystem::Queue::popBack()
+{
+    return std::move(jobs[(first + --count) & (jobs.size() - 1)]);
+}
+
+Job JobSystem::Queue::popFront()
+{
+    Job job = std::move(jobs[first]);
+    first = (first + 1) & (jobs.size() - 1);
+    --count;
+    return job;
+}
+
+JobSystem& JobSystem::get()
+{
+    static JobSystem jobs;
+    return jobs;
+}
+
+JobSystem::JobSystem()
+    : queued(0), quit(false), mainThread(std::this_thread::get_id())
+{
+    // The main thread helps whenever it waits, so leave its core to it
+    unsigned int count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (unsigned int i = 0; i <= count; ++i)
+        queues.emplace_back(new Queue());
+    for (unsigned int i = 0; i < count; ++i)
+        threads.emplace_back(&JobSystem::loop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    quit = true;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void JobSystem::run(std::function<void()> work, JobCounter* counter, const char* name)
+{
+    if (counter)
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+    Job job = { std::move(work), name, counter, false };
+    push(std::move(job));
+}
+
+void JobSystem::runOnMain(std::function<void()> work, JobCounter* counter, const char* name)
+{
+    if (counter)
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+    Job job = { std::move(work), name, counter, true };
+    pushMain(std::move(job));
+}
+
+void JobSystem::after(JobCounter& dependency, std::function<void()> work, JobCounter* counter,
+                      const char* name, bool onMain)
+{
+    if (counter)
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+    Job job = { std::move(work), name, counter, onMain };
+    {
+        // Parked under the same lock finish() drains with, so none are missed
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if (!dependency.done())
+        {
+            dependency.continuations.push_back(std::move(job));
+            return;
+        }
+    }
+    if (onMain)
+        pushMain(std::move(job));
+    else
+        push(std::move(job));
+}
+
+void JobSystem::push(Job&& job)
+{
+    Queue& queue = *queues[workerIndex >= 0 ? size_t(workerIndex) : queues.size() - 1];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.pushBack(std::move(job));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders this against a worker about to sleep
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+void JobSystem::pushMain(Job&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mainJobs.mutex);
+        mainJobs.pushBack(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    finished.notify_all();
+}
+
+bool JobSystem::take(Job& job)
+{
+    // Newest of our own first, then the oldest of everyone else
+    size_t count = queues.size();
+    size_t self = workerIndex >= 0 ? size_t(workerIndex) : count - 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Queue& queue = *queues[(self + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.count == 0)
+            continue;
+        job = i == 0 && workerIndex >= 0 ? queue.popBack() : queue.popFront();
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::takeMain(Job& job)
+{
+    std::lock_guard<std::mutex> lock(mainJobs.mutex);
+    if (mainJobs.count == 0)
+        return false;
+    job = mainJobs.popFront();
+    return true;
+}
+
+void JobSystem::execute(Job& job)
+{
+    int64_t begin = nanoseconds();
+    {
+        PROFILE_SCOPE(job.name);
+        job.work();
+    }
+    Profiler::get().addBusy(nanoseconds() - begin);
+    finish(job.counter);
+}
+
+void JobSystem::finish(JobCounter* counter)
+{
+    if (counter == nullptr)
+        return;
+
+    // The counter is untouched once its lock is released, since a waiter
+    // that sees zero takes the lock before letting the counter go
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex);
+        if (counter->value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        ready.swap(counter->continuations);
+    }
+    for (auto& job : ready)
+    {
+        if (job.main)
+            pushMain(std::move(job));
+        else
+            push(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    finished.notify_all();
+}
+
+size_t JobSystem::pump(double budget)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t ran = 0;
+    Job job;
+    while (takeMain(job))
+    {
+        execute(job);
+        ++ran;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (budget > 0.0 && elapsed.count() >= budget)
+            break;
+    }
+    return ran;
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    bool main = onMainThread();
+    while (!counter.done())
+    {
+        Job job;
+        if ((main && takeMain(job)) || take(job))
+        {
+            execute(job);
+            continue;
+        }
+
+        // The timeout covers main-thread jobs, which don't raise queued
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        finished.wait_for(lock, std::chrono::milliseconds(1),
+                          [&]() { return counter.done() || queued.load() > 0; });
+    }
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain,
+                            const std::function<void(size_t, size_t)>& body)
+{
+    if (end <= begin)
+        return;
+
+    // A few chunks per thread, so stealing can even out uneven ones
+    size_t count = end - begin;
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = std::min((count + grain - 1) / grain, size_t(workers() + 1) * 4);
+    if (chunks <= 1)
+    {
+        body(begin, end);
+        return;
+    }
+
+    // Jobs capture two words, small enough for std::function to store inline
+    struct Split
+    {
+        const std::function<void(size_t, size_t)>* body;
+        size_t begin, count, chunks;
+        void operator()(size_t i) const { (*body)(begin + count * i / chunks, begin + count * (i + 1) / chunks); }
+    } split = { &body, begin, count, chunks };
+
+    JobCounter counter;
+    for (size_t i = 1; i < chunks; ++i)
+        run([&split, i]() { split(i); }, &counter, "Parallel For");
+    split(0);
+    wait(counter);
+}
+
+void JobSystem::loop(unsigned int index)
+{
+    workerIndex = static_cast<int>(index);
+    Profiler::get().nameThread("Worker " + std::to_string(index));
+    while (!quit)
+    {
+        Job job;
+        if (take(job))
+        {
+            execute(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return queued.load() > 0 || quit; });
+    }
+}
@@ -0,0 +1,197 @@
+#include "Memory.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // Constant-initialised, so they are ready before any static constructor
+    std::atomic<uint64_t> allocationCount(0);
+    std::atomic<uint64_t> byteCount(0);
+
+    uintptr_t alignUp(uintptr_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~uintptr_t(alignment - 1);
+    }
+}
+
+#if GLITTER_COUNT_ALLOCATIONS
+// Every other form of new and delete in the standard library forwards here
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    byteCount.fetch_add(size, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    for (;;)
+    {
+        if (void* block = std::malloc(size))
+            return block;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept
+{
+    std::free(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept
+{
+    std::free(block);
+}
+#endif
+
+uint64_t heapAllocations()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t heapBytes()
+{
+    return byteCount.load(std::memory_order_relaxed);
+}
+
+FrameArena& FrameArena::get()
+{
+    static FrameArena arena;
+    return arena;
+}
+
+FrameArena::FrameArena(size_t capacity)
+    : memory(new unsigned char[capacity]), size(capacity), offset(0), highWater(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    for (void* block : overflow)
+        ::operator delete(block);
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+    // Padding by the alignment leaves room to round any start up
+    size_t padded = bytes + alignment - 1;
+    size_t start = offset.fetch_add(padded, std::memory_order_relaxed);
+    if (start + padded <= size)
+        return reinterpret_cast<void*>(alignUp(reinterpret_cast<uintptr_t>(memory.get()) + start, alignment));
+
+    // Out of room for this frame; reset() frees these and grows the block
+    void* block = ::operator new(padded);
+    {
+        std::lock_guard<std::mutex> lock(overflowMutex);
+        overflow.push_back(block);
+    }
+    return reinterpret_cast<void*>(alignUp(reinterpret_cast<uintptr_t>(block), alignment));
+}
+
+void FrameArena::reset()
+{
+    size_t used = offset.load(std::memory_order_relaxed);
+    highWater = std::max(highWater, used);
+    if (!overflow.empty())
+    {
+        for (void* block : overflow)
+            ::operator delete(block);
+        overflow.clear();
+
+        // Grow in powers of two so a slowly rising peak settles quickly
+        while (size < used)
+            size *= 2;
+        memory.reset(new unsigned char[size]);
+    }
+    offset.store(0, std::memory_order_relaxed);
+}
+
+PoolAllocator::PoolAllocator(size_t blockSize, size_t blockAlignment, size_t blocksPerChunk)
+    : alignment(std::max(blockAlignment, alignof(FreeBlock))),
+      chunkBlocks(std::max<size_t>(blocksPerChunk, 1)), freeList(nullptr), liveCount(0)
+{
+    // Free blocks hold the list link, so every block must fit one
+    stride = alignUp(std::max(blockSize, sizeof(FreeBlock)), alignment);
+}
+
+void PoolAllocator::grow()
+{
+    // Thread the new chunk onto the free list in address order
+    std::unique_ptr<unsigned char[]> chunk(new unsigned char[stride * chunkBlocks + alignment - 1]);
+    unsigned char* first = reinterpret_cast<unsigned char*>(alignUp(reinterpret_cast<uintptr_t>(chunk.get()), alignment));
+    for (size_t i = chunkBlocks; i-- > 0;)
+    {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(first + i * stride);
+        block->next = freeList;
+        freeList = block;
+    }
+    chunks.push_back(std::move(chunk));
+}
+
+void* PoolAllocator::allocate()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (freeList == nullptr)
+        grow();
+    FreeBlock* block = freeList;
+    freeList = block->next;
+    ++liveCount;
+    return block;
+}
+
+void PoolAllocator::deallocate(void* pointer)
+{
+    if (pointer == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    FreeBlock* block = static_cast<FreeBlock*>(pointer);
+    block->next = freeList;
+    freeList = block;
+    --liveCount;
+}
+
+size_t PoolAllocator::live() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return liveCount;
+}
+
+size_t PoolAllocator::reserved() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return chunks.size() * chunkBlocks;
+}
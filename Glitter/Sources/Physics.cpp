@@ -0,0 +1,279 @@
+#include "Physics.hpp"
+#include "Profiler.hpp"
+#include "TransformStore.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    // Both threads read the same clock, in seconds
+    double now()
+    {
+        using namespace std::chrono;
+        return duration<double>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    glm::mat4 toMatrix(const glm::vec3& position, const glm::quat& rotation)
+    {
+        glm::mat4 matrix = glm::mat4_cast(rotation);
+        matrix[3] = glm::vec4(position, 1.0f);
+        return matrix;
+    }
+}
+
+PhysicsWorld::PhysicsWorld(double stepsPerSecond, unsigned maxCatchUp)
+    : dispatcher(&configuration),
+      world(&dispatcher, &broadphase, &solver, &configuration),
+      nextId(0),
+      readySlot(0),
+      writeSlot(1),
+      readSlot(2),
+      quit(false),
+      stepLength(1.0 / stepsPerSecond),
+      catchUp(std::max(maxCatchUp, 1u)),
+      stepCount(0),
+      dropCount(0)
+{
+    world.setGravity(btVector3(0.0f, -9.81f, 0.0f));
+    for (auto& snapshot : snapshots)
+    {
+        snapshot.time = 0.0;
+        snapshot.step = 0;
+    }
+}
+
+PhysicsWorld::~PhysicsWorld()
+{
+    // Edits still queued may add bodies, which are then deleted below
+    stop();
+    apply();
+    for (auto body : bodies)
+    {
+        if (body == nullptr)
+            continue;
+        world.removeRigidBody(body);
+        delete body->getMotionState();
+        delete body;
+    }
+}
+
+int PhysicsWorld::addBody(btRigidBody* body)
+{
+    std::lock_guard<std::mutex> lock(editMutex);
+    int id = nextId;
+    if (freeIds.empty())
+        nextId++;
+    else
+    {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+    if (liveIds.size() <= size_t(id))
+        liveIds.resize(id + 1, false);
+    liveIds[id] = true;
+
+    edits.push_back([this, id, body](btDiscreteDynamicsWorld& dynamics)
+    {
+        if (bodies.size() <= size_t(id))
+            bodies.resize(id + 1, nullptr);
+        bodies[id] = body;
+        dynamics.addRigidBody(body);
+    });
+    return id;
+}
+
+void PhysicsWorld::removeBody(int id)
+{
+    // Claim the removal under the lock, so a second call for the same id,
+    // even before the first edit has run, cannot post another one
+    bool known;
+    {
+        std::lock_guard<std::mutex> lock(editMutex);
+        known = id >= 0 && size_t(id) < liveIds.size() && liveIds[id];
+        if (known)
+            liveIds[id] = false;
+    }
+    if (!known)
+    {
+        std::cerr << "ERROR::PHYSICS::INVALID_BODY " << id << std::endl;
+        return;
+    }
+
+    // The id is only reused once the body is really gone
+    post([this, id](btDiscreteDynamicsWorld& dynamics)
+    {
+        btRigidBody* body = size_t(id) < bodies.size() ? bodies[id] : nullptr;
+        if (body == nullptr)
+            return;
+        dynamics.removeRigidBody(body);
+        delete body->getMotionState();
+        delete body;
+        bodies[id] = nullptr;
+        std::lock_guard<std::mutex> lock(editMutex);
+        freeIds.push_back(id);
+    });
+}
+
+void PhysicsWorld::post(std::function<void(btDiscreteDynamicsWorld&)> edit)
+{
+    std::lock_guard<std::mutex> lock(editMutex);
+    edits.push_back(std::move(edit));
+}
+
+void PhysicsWorld::start()
+{
+    if (running())
+        return;
+    quit = false;
+    worker = std::thread(&PhysicsWorld::run, this);
+}
+
+void PhysicsWorld::stop()
+{
+    if (!running())
+        return;
+    quit = true;
+    worker.join();
+}
+
+const PhysicsWorld::Snapshot* PhysicsWorld::acquire(float& alpha)
+{
+    // Take the newest snapshot if one was published since the last call
+    if (readySlot.load(std::memory_order_relaxed) & freshBit)
+        readSlot = readySlot.exchange(readSlot, std::memory_order_acquire) & ~freshBit;
+
+    const Snapshot& snapshot = snapshots[readSlot];
+    if (snapshot.step == 0)
+        return nullptr;
+
+    // Rendering one step behind means the blend factor is simply how far
+    // the clock has moved past the newest step
+    alpha = float(std::min(std::max((now() - snapshot.time) / stepLength, 0.0), 1.0));
+    return &snapshot;
+}
+
+PhysicsWorld::Pose PhysicsWorld::blend(const Snapshot& snapshot, size_t index, float alpha)
+{
+    // Removed bodies come out as the identity
+    const Pose& current = snapshot.current[index];
+    if (!current.live)
+        return Pose{ glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), false };
+
+    // Bodies new in this step have no earlier pose to blend from, and
+    // resting ones return their pose untouched so it compares equal
+    if (index >= snapshot.previous.size() || !snapshot.previous[index].live)
+        return current;
+    const Pose& previous = snapshot.previous[index];
+    if (previous.position == current.position && previous.rotation.x == current.rotation.x &&
+        previous.rotation.y == current.rotation.y && previous.rotation.z == current.rotation.z &&
+        previous.rotation.w == current.rotation.w)
+        return current;
+    return Pose{ glm::mix(previous.position, current.position, alpha),
+                 glm::slerp(previous.rotation, current.rotation, alpha), true };
+}
+
+bool PhysicsWorld::interpolate(std::vector<glm::mat4>& transforms)
+{
+    float alpha;
+    const Snapshot* snapshot = acquire(alpha);
+    if (snapshot == nullptr)
+        return false;
+
+    transforms.resize(snapshot->current.size());
+    for (size_t i = 0; i < snapshot->current.size(); ++i)
+    {
+        Pose pose = blend(*snapshot, i, alpha);
+        transforms[i] = pose.live ? toMatrix(pose.position, pose.rotation) : glm::mat4(1.0f);
+    }
+    return true;
+}
+
+bool PhysicsWorld::interpolate(TransformStore& store)
+{
+    float alpha;
+    const Snapshot* snapshot = acquire(alpha);
+    if (snapshot == nullptr)
+        return false;
+
+    // Resting bodies blend to the same pose as last frame, which set() ignores
+    if (store.size() != snapshot->current.size())
+        store.resize(snapshot->current.size());
+    for (size_t i = 0; i < snapshot->current.size(); ++i)
+    {
+        Pose pose = blend(*snapshot, i, alpha);
+        store.set(i, pose.position, pose.rotation);
+    }
+    return true;
+}
+
+void PhysicsWorld::run()
+{
+    Profiler::get().nameThread("Physics");
+    double due = now() + stepLength;
+    while (!quit)
+    {
+        double time = now();
+        if (time < due)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(due - time));
+            continue;
+        }
+
+        // Past a few steps behind, give the time up instead of spiralling
+        double behind = std::floor((time - due) / stepLength);
+        if (behind > catchUp)
+        {
+            dropCount += std::uint64_t(behind);
+            due += behind * stepLength;
+        }
+
+        {
+            PROFILE_SCOPE("Physics Step");
+            apply();
+            world.stepSimulation(btScalar(stepLength), 0);
+            ++stepCount;
+            publish(due);
+        }
+        due += stepLength;
+    }
+}
+
+void PhysicsWorld::apply()
+{
+    // Run edits outside the lock so they may queue further edits
+    std::vector<std::function<void(btDiscreteDynamicsWorld&)>> pending;
+    {
+        std::lock_guard<std::mutex> lock(editMutex);
+        pending.swap(edits);
+    }
+    for (auto& edit : pending)
+        edit(world);
+}
+
+void PhysicsWorld::publish(double time)
+{
+    Snapshot& snapshot = snapshots[writeSlot];
+    snapshot.previous = poses;
+    poses.resize(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i)
+    {
+        Pose& pose = poses[i];
+        pose.live = bodies[i] != nullptr;
+        if (!pose.live)
+            continue;
+        const btTransform& transform = bodies[i]->getWorldTransform();
+        const btVector3& origin = transform.getOrigin();
+        btQuaternion rotation = transform.getRotation();
+        pose.position = glm::vec3(origin.x(), origin.y(), origin.z());
+        pose.rotation = glm::quat(rotation.w(), rotation.x(), rotation.y(), rotation.z());
+    }
+    snapshot.current = poses;
+    snapshot.time = time;
+    snapshot.step = stepCount;
+
+    // Hand the filled slot over and take back whichever one was ready
+    writeSlot = readySlot.exchange(writeSlot | freshBit, std::memory_order_acq_rel) & ~freshBit;
+}
@@ -0,0 +1,346 @@
+#include "Profiler.hpp"
+#include "GLState.hpp"
+#include "Memory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const unsigned int gpuThreadId = 9999;
+
+    // Scope names are literals, but quotes would still break the JSON
+    std::string escape(const char* text)
+    {
+        std::string result;
+        for (; *text; ++text)
+        {
+            if (*text == '"' || *text == '\\')
+                result += '\\';
+            result += *text;
+        }
+        return result;
+    }
+}
+
+Profiler& Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : enabled(true), gpuTimers(false), gpuOffset(0), gpuEventHead(0),
+      frameIndex(0), frameBegin(0), bindsAtBegin(0), skipsAtBegin(0), allocationsAtBegin(0)
+{
+    // Full size up front, so resolving GPU scopes never grows it mid-frame
+    gpuEvents.reserve(gpuEventLimit);
+    for (auto& counter : counters)
+        counter = 0;
+    for (auto& stats : history)
+        stats = FrameStats();
+    for (auto& frame : gpuFrames)
+    {
+        frame.used = 0;
+        frame.frame = 0;
+        frame.pending = false;
+    }
+}
+
+int64_t Profiler::now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+    // Registered once per thread and never freed, so traces outlive threads
+    static thread_local ThreadBuffer* local = nullptr;
+    if (local == nullptr)
+    {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        buffer->events.resize(ThreadBuffer::capacity);
+        buffer->head = 0;
+        buffer->busy = 0;
+        buffer->jobs = 0;
+        buffer->busySeen = buffer->jobsSeen = 0;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer->id = static_cast<unsigned int>(threads.size());
+        buffer->name = "Thread " + std::to_string(buffer->id);
+        local = buffer.get();
+        threads.push_back(std::move(buffer));
+    }
+    return *local;
+}
+
+void Profiler::nameThread(const std::string& name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.name = name;
+}
+
+void Profiler::beginScope(const char* name)
+{
+    // The open stack holds begin times; events are written once, complete
+    Event event = { enabled ? name : nullptr, now(), 0 };
+    threadBuffer().open.push_back(event);
+}
+
+void Profiler::endScope()
+{
+    ThreadBuffer& buffer = threadBuffer();
+    if (buffer.open.empty())
+        return;
+    Event event = buffer.open.back();
+    buffer.open.pop_back();
+    if (event.name == nullptr)
+        return;
+
+    // Publish into the ring; readers only look below head
+    event.end = now();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % ThreadBuffer::capacity] = event;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::addBusy(int64_t nanoseconds)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    buffer.busy.fetch_add(static_cast<uint64_t>(nanoseconds), std::memory_order_relaxed);
+    buffer.jobs.fetch_add(1, std::memory_order_relaxed);
+}
+
+unsigned int Profiler::query(GpuFrame& frame)
+{
+    if (frame.used == frame.queries.size())
+    {
+        GLuint id;
+        glGenQueries(1, &id);
+        frame.queries.push_back(id);
+    }
+    return frame.used++;
+}
+
+int Profiler::beginGpu(const char* name)
+{
+    GpuFrame& frame = gpuFrames[frameIndex % framesInFlight];
+    if (!frame.pending)
+        return -1;
+    GpuScope scope = { name, query(frame), 0 };
+    glQueryCounter(frame.queries[scope.beginQuery], GL_TIMESTAMP);
+    frame.scopes.push_back(scope);
+    return static_cast<int>(frame.scopes.size() - 1);
+}
+
+void Profiler::endGpu(int slot)
+{
+    GpuFrame& frame = gpuFrames[frameIndex % framesInFlight];
+    if (slot < 0 || !frame.pending)
+        return;
+    unsigned int index = query(frame);
+    glQueryCounter(frame.queries[index], GL_TIMESTAMP);
+    frame.scopes[slot].endQuery = index;
+}
+
+void Profiler::resolve(GpuFrame& frame)
+{
+    // Timestamps are written in order, so the last one arriving means all have
+    GLint available = 0;
+    if (frame.used == 0)
+    {
+        frame.pending = false;
+        return;
+    }
+    glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+
+    for (const auto& scope : frame.scopes)
+    {
+        if (scope.endQuery == 0)
+            continue;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(frame.queries[scope.beginQuery], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.queries[scope.endQuery], GL_QUERY_RESULT, &end);
+        Event event = { scope.name, int64_t(begin) + gpuOffset, int64_t(end) + gpuOffset };
+        if (gpuEvents.size() < gpuEventLimit)
+            gpuEvents.push_back(event);
+        else
+            gpuEvents[gpuEventHead++ % gpuEventLimit] = event;
+
+        // Scope 0 brackets the whole frame
+        FrameStats& stats = history[frame.frame % historySize];
+        if (&scope == &frame.scopes[0] && stats.frame == frame.frame)
+            stats.gpuMilliseconds = double(end - begin) / 1e6;
+    }
+    frame.pending = false;
+}
+
+void Profiler::beginFrame()
+{
+    // Calibrate once the context exists; the offset maps GPU time onto ours
+    if (!gpuTimers)
+    {
+        GLint64 timestamp = 0;
+        glGetInteger64v(GL_TIMESTAMP, &timestamp);
+        gpuOffset = now() - timestamp;
+        gpuTimers = true;
+    }
+
+    // Collect whatever earlier frames have finished; the slot being reused
+    // is given up if its results are still not back
+    ++frameIndex;
+    for (auto& frame : gpuFrames)
+        if (frame.pending)
+            resolve(frame);
+    GpuFrame& frame = gpuFrames[frameIndex % framesInFlight];
+    frame.pending = enabled;
+    frame.used = 0;
+    frame.scopes.clear();
+    frame.frame = frameIndex;
+
+    frameBegin = now();
+    bindsAtBegin = GLState::get().issued();
+    skipsAtBegin = GLState::get().skipped();
+    allocationsAtBegin = heapAllocations();
+    beginGpu("Frame");
+    beginScope("Frame");
+}
+
+void Profiler::endFrame()
+{
+    endScope();
+    endGpu(0);
+
+    FrameStats& stats = history[frameIndex % historySize];
+    stats.frame = frameIndex;
+    stats.cpuMilliseconds = double(now() - frameBegin) / 1e6;
+    stats.gpuMilliseconds = -1.0;
+    for (unsigned int i = 0; i < ProfileCounter::Count; ++i)
+        stats.counters[i] = counters[i].exchange(0);
+    stats.counters[ProfileCounter::Binds] += GLState::get().issued() - bindsAtBegin;
+    stats.counters[ProfileCounter::SkippedBinds] += GLState::get().skipped() - skipsAtBegin;
+    stats.counters[ProfileCounter::Allocations] += heapAllocations() - allocationsAtBegin;
+    stats.counters[ProfileCounter::FrameBytes] += FrameArena::get().used();
+
+    // Job time since the previous frame, per thread
+    std::lock_guard<std::mutex> lock(registryMutex);
+    workerStats.clear();
+    for (const auto& buffer : threads)
+    {
+        uint64_t busy = buffer->busy.load(std::memory_order_relaxed);
+        uint64_t jobs = buffer->jobs.load(std::memory_order_relaxed);
+        if (jobs == 0)
+            continue;
+        WorkerStats worker = { buffer->name, jobs - buffer->jobsSeen, double(busy - buffer->busySeen) / 1e6, 0.0 };
+        if (stats.cpuMilliseconds > 0.0)
+            worker.utilization = worker.busyMilliseconds / stats.cpuMilliseconds;
+        buffer->busySeen = busy;
+        buffer->jobsSeen = jobs;
+        workerStats.push_back(worker);
+    }
+}
+
+const FrameStats& Profiler::lastFrame() const
+{
+    // Mid-frame, the newest finished frame is the one before
+    const FrameStats& current = history[frameIndex % historySize];
+    if (current.frame == frameIndex)
+        return current;
+    return history[(frameIndex + historySize - 1) % historySize];
+}
+
+FrameStats Profiler::average() const
+{
+    FrameStats mean = FrameStats();
+    unsigned int frames = 0, gpuFrames = 0;
+    double gpuTotal = 0.0;
+    for (const auto& stats : history)
+    {
+        if (stats.frame == 0)
+            continue;
+        ++frames;
+        mean.cpuMilliseconds += stats.cpuMilliseconds;
+        for (unsigned int i = 0; i < ProfileCounter::Count; ++i)
+            mean.counters[i] += stats.counters[i];
+        if (stats.gpuMilliseconds >= 0.0)
+        {
+            ++gpuFrames;
+            gpuTotal += stats.gpuMilliseconds;
+        }
+    }
+    if (frames == 0)
+        return mean;
+    mean.frame = frameIndex;
+    mean.cpuMilliseconds /= frames;
+    mean.gpuMilliseconds = gpuFrames ? gpuTotal / gpuFrames : -1.0;
+    for (auto& counter : mean.counters)
+        counter /= frames;
+    return mean;
+}
+
+void Profiler::report() const
+{
+    FrameStats mean = average();
+    std::cerr << "Frame " << mean.frame << ": " << mean.cpuMilliseconds << " ms CPU, "
+              << mean.gpuMilliseconds << " ms GPU, "
+              << mean.counters[ProfileCounter::DrawCalls] << " draws, "
+              << mean.counters[ProfileCounter::Triangles] << " triangles, "
+              << mean.counters[ProfileCounter::Binds] << " binds ("
+              << mean.counters[ProfileCounter::SkippedBinds] << " skipped), "
+              << mean.counters[ProfileCounter::UploadBytes] << " bytes uploaded, "
+              << mean.counters[ProfileCounter::Allocations] << " allocations, "
+              << mean.counters[ProfileCounter::FrameBytes] << " frame bytes" << std::endl;
+    for (const auto& worker : workerStats)
+        std::cerr << "    " << worker.name << ": " << worker.jobs << " jobs, "
+                  << worker.utilization * 100.0 << "% busy" << std::endl;
+}
+
+bool Profiler::writeTrace(const std::string& path) const
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        std::cerr << "ERROR::PROFILER::TRACE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+
+    // Complete ("X") events in microseconds; threads and the GPU get a row each
+    bool first = true;
+    auto write = [&](unsigned int thread, const Event& event)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+            << thread << ",\"ts\":" << double(event.begin) / 1e3 << ",\"dur\":" << double(event.end - event.begin) / 1e3 << "}";
+        first = false;
+    };
+    auto label = [&](unsigned int thread, const std::string& name)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread
+            << ",\"args\":{\"name\":\"" << escape(name.c_str()) << "\"}}";
+        first = false;
+    };
+
+    out.precision(15);
+    out << "[\n";
+    {
+        // Events older than a full ring may be overwritten while we read
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& buffer : threads)
+        {
+            label(buffer->id, buffer->name);
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t begin = head > ThreadBuffer::capacity ? head - ThreadBuffer::capacity : 0;
+            for (uint64_t i = begin; i < head; ++i)
+                write(buffer->id, buffer->events[i % ThreadBuffer::capacity]);
+        }
+    }
+    label(gpuThreadId, "GPU");
+    for (const auto& event : gpuEvents)
+        write(gpuThreadId, event);
+    out << "\n]\n";
+    return bool(out);
+}
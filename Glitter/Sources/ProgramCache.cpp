@@ -0,0 +1,219 @@
+#include "ProgramCache.hpp"
+#include "Extensions.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#define makeDirectory(path) _mkdir(path)
+#define removeDirectory(path) _rmdir(path)
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define makeDirectory(path) mkdir(path, 0755)
+#define removeDirectory(path) rmdir(path)
+#endif
+
+namespace
+{
+    // Header written in front of every cached binary
+    struct BinaryHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    const uint32_t binaryMagic = 0x42505347; // "GSPB"
+    const uint32_t binaryVersion = 1;
+
+    // 64-bit FNV-1a, chained across several strings
+    uint64_t fnv1a(const std::string& text, uint64_t hash)
+    {
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        // Separate consecutive strings so ("ab", "c") and ("a", "bc") differ
+        hash ^= 0xff;
+        hash *= 1099511628211ull;
+        return hash;
+    }
+
+    // Program binaries are core from 4.1 but Glitter asks for 4.0, where they
+    // need ARB_get_program_binary; glad leaves the entry points null otherwise
+    bool binariesAvailable()
+    {
+        return (GLAD_GL_VERSION_4_1 || hasExtension("GL_ARB_get_program_binary"))
+            && glProgramParameteri && glProgramBinary && glGetProgramBinary;
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+}
+
+ProgramCache& ProgramCache::get()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+ProgramCache::ProgramCache()
+    : dir("ShaderCache"), enabled(true), hitCount(0), missCount(0), rejectCount(0)
+{
+}
+
+void ProgramCache::setDirectory(const std::string& path)
+{
+    dir = path;
+}
+
+bool ProgramCache::supported() const
+{
+    if (!enabled || !binariesAvailable())
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+std::string ProgramCache::key(const std::vector<std::string>& sources, const std::string& defines) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto& source : sources)
+        hash = fnv1a(source, hash);
+    hash = fnv1a(defines, hash);
+    hash = fnv1a(glString(GL_VENDOR), hash);
+    hash = fnv1a(glString(GL_RENDERER), hash);
+    hash = fnv1a(glString(GL_VERSION), hash);
+
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+std::string ProgramCache::path(const std::string& key) const
+{
+    return dir + "/" + key + ".bin";
+}
+
+void ProgramCache::prepare(unsigned int program)
+{
+    if (!binariesAvailable())
+        return;
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool ProgramCache::load(unsigned int program, const std::string& key)
+{
+    if (!supported())
+        return false;
+
+    std::ifstream file(path(key), std::ios::binary);
+    BinaryHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != binaryMagic || header.version != binaryVersion)
+    {
+        missCount++;
+        return false;
+    }
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+    {
+        missCount++;
+        return false;
+    }
+
+    // The driver may still refuse a binary, e.g. after an update that kept the version string
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        missCount++;
+        rejectCount++;
+        std::remove(path(key).c_str());
+        return false;
+    }
+
+    hitCount++;
+    return true;
+}
+
+bool ProgramCache::store(unsigned int program, const std::string& key)
+{
+    if (!supported())
+        return false;
+
+    GLint success = 0, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0)
+        return false;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    makeDirectory(dir.c_str());
+    std::ofstream file(path(key), std::ios::binary);
+    BinaryHeader header = { binaryMagic, binaryVersion, format, static_cast<uint32_t>(length) };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), binary.size());
+    if (!file)
+    {
+        std::cerr << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << path(key) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ProgramCache::clear()
+{
+    // Only the binaries this cache writes; anything else keeps the directory
+    std::vector<std::string> names;
+#ifdef _WIN32
+    _finddata_t entry;
+    intptr_t handle = _findfirst((dir + "/*.bin").c_str(), &entry);
+    if (handle != -1)
+    {
+        do
+            names.push_back(entry.name);
+        while (_findnext(handle, &entry) == 0);
+        _findclose(handle);
+    }
+#else
+    if (DIR* directory = opendir(dir.c_str()))
+    {
+        while (dirent* entry = readdir(directory))
+        {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".bin") == 0)
+                names.push_back(name);
+        }
+        closedir(directory);
+    }
+#endif
+    for (const auto& name : names)
+        std::remove((dir + "/" + name).c_str());
+    removeDirectory(dir.c_str());
+}
+
+void ProgramCache::report() const
+{
+    std::cerr << "Program cache: " << hitCount << " hits, " << missCount << " misses ("
+              << rejectCount << " rejected)" << std::endl;
+}
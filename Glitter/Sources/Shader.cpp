@@ -1,50 +1,45 @@
 #include "Shader.hpp"
+#include "ProgramCache.hpp"
+#include "ShaderLibrary.hpp"
+#include "UniformBuffer.hpp"
 
 #include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
-#include <sstream>
-#include <fstream>
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
 {
-    // 1. Retrieve the vertex/fragment source code from filePath
+    // 1. Retrieve the vertex/fragment source code from filePath, expanding #include directives
     std::string vertexCode;
     std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    // Ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    try
-    {
-        // Open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-
-        // Read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-
-        // Close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-
-        // Convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    }
-    catch(std::ifstream::failure& e)
+    const std::string& includeDirectory = ShaderLibrary::get().directory();
+    ShaderLibrary::preprocess(vertexPath, vertexCode, nullptr, includeDirectory);
+    ShaderLibrary::preprocess(fragmentPath, fragmentCode, nullptr, includeDirectory);
+
+    // 2. Restore the linked program from the binary cache, or build it from source
+    ID = glCreateProgram();
+    ProgramCache& cache = ProgramCache::get();
+    std::string cacheKey = cache.key({ vertexCode, fragmentCode });
+    if (!cache.load(ID, cacheKey))
     {
-        std::cerr << "Error reading shader files:" << std::endl
-                  << e.what() << std::endl;
+        compile(vertexCode, fragmentCode);
+        cache.store(ID, cacheKey);
     }
 
+    // 3. Cache uniform locations so setters don't query the driver by name
+    cacheUniforms();
+
+    // 4. Attach the shared uniform blocks to their fixed binding points
+    bindUniformBlocks(ID);
+}
+
+void Shader::compile(const std::string& vertexCode, const std::string& fragmentCode)
+{
     const char* vertexShaderCode = vertexCode.c_str();
     const char* fragmentShaderCode = fragmentCode.c_str();
 
-    // 2. Compile shaders
+    // Compile shaders
     unsigned int vertex, fragment;
     int success;
     char infoLog[512];
@@ -73,10 +68,10 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
         std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
     };
 
-    // Shader Program
-    ID = glCreateProgram();
+    // Shader Program, kept retrievable so it can be written to the cache
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
+    ProgramCache::prepare(ID);
     glLinkProgram(ID);
     // print linking errors if any
     glGetProgramiv(ID, GL_LINK_STATUS, &success);
@@ -87,29 +82,127 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     }
 
     // delete the shaders as they're linked into our program now and no longer necessary
+    glDetachShader(ID, vertex);
+    glDetachShader(ID, fragment);
     glDeleteShader(vertex);
     glDeleteShader(fragment);
 }
 
+void Shader::cacheUniforms()
+{
+    uniforms.clear();
+    int count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    if (maxLength <= 0)
+        return;
+
+    std::string name(maxLength, '\0');
+    for (int i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+        std::string uniformName = name.substr(0, length);
+
+        // Uniforms inside a uniform block have no location
+        int location = glGetUniformLocation(ID, uniformName.c_str());
+        if (location == -1)
+            continue;
+        uniforms[uniformName] = location;
+
+        // Arrays are reported as "name[0]"; also register "name" and every element
+        auto bracket = uniformName.find('[');
+        if (bracket == std::string::npos)
+            continue;
+        std::string base = uniformName.substr(0, bracket);
+        uniforms[base] = location;
+        for (int element = 1; element < size; element++)
+        {
+            std::string elementName = base + "[" + std::to_string(element) + "]";
+            uniforms[elementName] = glGetUniformLocation(ID, elementName.c_str());
+        }
+    }
+}
+
 void Shader::use() const
 {
     glUseProgram(ID);
 }
 
+int Shader::uniform(const std::string &name) const
+{
+    auto it = uniforms.find(name);
+    return it != uniforms.end() ? it->second : -1;
+}
+
 void Shader::setBool(const std::string &name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    setBool(uniform(name), value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    setInt(uniform(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    setFloat(uniform(name), value);
+}
+
+void Shader::setVec2(const std::string& name, const glm::vec2& value) const
+{
+    setVec2(uniform(name), value);
 }
 
+void Shader::setVec3(const std::string& name, const glm::vec3& value) const
+{
+    setVec3(uniform(name), value);
+}
 
+void Shader::setVec4(const std::string& name, const glm::vec4& value) const
+{
+    setVec4(uniform(name), value);
+}
 
+void Shader::setMat4(const std::string& name, const glm::mat4& value) const
+{
+    setMat4(uniform(name), value);
+}
+
+void Shader::setBool(int location, bool value) const
+{
+    glUniform1i(location, (int)value);
+}
+
+void Shader::setInt(int location, int value) const
+{
+    glUniform1i(location, value);
+}
+
+void Shader::setFloat(int location, float value) const
+{
+    glUniform1f(location, value);
+}
+
+void Shader::setVec2(int location, const glm::vec2& value) const
+{
+    glUniform2fv(location, 1, glm::value_ptr(value));
+}
+
+void Shader::setVec3(int location, const glm::vec3& value) const
+{
+    glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+void Shader::setVec4(int location, const glm::vec4& value) const
+{
+    glUniform4fv(location, 1, glm::value_ptr(value));
+}
+
+void Shader::setMat4(int location, const glm::mat4& value) const
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
@@ -0,0 +1,586 @@
+#include "ShaderLibrary.hpp"
+#include "GLState.hpp"
+#include "Profiler.hpp"
+#include "ProgramCache.hpp"
+#include "UniformBuffer.hpp"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#define statFile _stat
+typedef struct _stat FileStatus;
+#else
+#define statFile stat
+typedef struct stat FileStatus;
+#endif
+
+namespace
+{
+    bool readFile(const std::string& path, std::string& text)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
+    }
+
+    // Modified time in nanoseconds and size, so two saves within a second
+    // that keep the size still differ. Windows only has whole seconds there,
+    // so a hash of the contents stands in for the size.
+    bool fileStamp(const std::string& path, std::pair<long long, long long>& stamp)
+    {
+        FileStatus status;
+        if (statFile(path.c_str(), &status) != 0)
+            return false;
+        long long seconds = static_cast<long long>(status.st_mtime);
+#if defined(_WIN32)
+        std::string text;
+        if (!readFile(path, text))
+            return false;
+        stamp = std::make_pair(seconds * 1000000000ll, static_cast<long long>(std::hash<std::string>()(text)));
+#else
+#if defined(__APPLE__)
+        long long nanoseconds = status.st_mtimespec.tv_nsec;
+#else
+        long long nanoseconds = status.st_mtim.tv_nsec;
+#endif
+        stamp = std::make_pair(seconds * 1000000000ll + nanoseconds, static_cast<long long>(status.st_size));
+#endif
+        return true;
+    }
+
+    std::string directoryOf(const std::string& path)
+    {
+        auto slash = path.find_last_of("/\\");
+        return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    }
+
+    bool isAbsolute(const std::string& path)
+    {
+        return (!path.empty() && (path[0] == '/' || path[0] == '\\'))
+            || (path.size() > 1 && path[1] == ':');
+    }
+
+    GLenum stageType(const std::string& path)
+    {
+        struct { const char* extension; GLenum type; } const types[] =
+        {
+            { ".vert", GL_VERTEX_SHADER          },
+            { ".tesc", GL_TESS_CONTROL_SHADER    },
+            { ".tese", GL_TESS_EVALUATION_SHADER },
+            { ".geom", GL_GEOMETRY_SHADER        },
+            { ".frag", GL_FRAGMENT_SHADER        },
+            { ".comp", GL_COMPUTE_SHADER         },
+        };
+        auto dot = path.find_last_of('.');
+        std::string extension = dot == std::string::npos ? std::string() : path.substr(dot);
+        for (const auto& entry : types)
+            if (extension == entry.extension)
+                return entry.type;
+        return GL_NONE;
+    }
+
+    const char* stageName(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_VERTEX_SHADER:          return "VERTEX";
+        case GL_TESS_CONTROL_SHADER:    return "TESS_CONTROL";
+        case GL_TESS_EVALUATION_SHADER: return "TESS_EVALUATION";
+        case GL_GEOMETRY_SHADER:        return "GEOMETRY";
+        case GL_FRAGMENT_SHADER:        return "FRAGMENT";
+        case GL_COMPUTE_SHADER:         return "COMPUTE";
+        default:                        return "UNKNOWN";
+        }
+    }
+
+    // The name in an #include "name" or #include <name> line, if it is one
+    bool includeName(const std::string& line, std::string& name)
+    {
+        size_t at = line.find_first_not_of(" \t");
+        if (at == std::string::npos || line[at] != '#')
+            return false;
+        at = line.find_first_not_of(" \t", at + 1);
+        if (at == std::string::npos || line.compare(at, 7, "include") != 0)
+            return false;
+        at = line.find_first_not_of(" \t", at + 7);
+        if (at == std::string::npos || (line[at] != '"' && line[at] != '<'))
+            return false;
+        size_t end = line.find(line[at] == '"' ? '"' : '>', at + 1);
+        if (end == std::string::npos)
+            return false;
+        name = line.substr(at + 1, end - at - 1);
+        return true;
+    }
+
+    // Paste file into output, recursing into includes. files holds every file
+    // read so far; its index is the file's #line source string number.
+    bool expand(const std::string& path, const std::string& text, const std::string& includeDirectory,
+                std::vector<std::string>& files, std::string& output)
+    {
+        size_t index = files.size() - 1;
+        std::istringstream lines(text);
+        std::string line, name;
+        bool success = true;
+        for (int number = 1; std::getline(lines, line); number++)
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!includeName(line, name))
+            {
+                output += line;
+                output += '\n';
+                continue;
+            }
+
+            // Beside the including file first, then in the library directory
+            std::string found = isAbsolute(name) ? name : directoryOf(path) + name;
+            std::string included;
+            if (!readFile(found, included) && (isAbsolute(name) || !readFile(found = includeDirectory + name, included)))
+            {
+                std::cerr << "ERROR::SHADER::INCLUDE_NOT_FOUND " << name
+                          << " (" << path << ":" << number << ")" << std::endl;
+                success = false;
+                output += '\n';
+                continue;
+            }
+
+            // Each file once per stage, so include guards are optional; the
+            // blank line keeps the including file's numbering intact
+            if (std::find(files.begin(), files.end(), found) != files.end())
+            {
+                output += '\n';
+                continue;
+            }
+            files.push_back(found);
+            output += "#line 1 " + std::to_string(files.size() - 1) + "\n";
+            success = expand(found, included, includeDirectory, files, output) && success;
+            output += "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+        }
+        return success;
+    }
+
+    // Print the source string numbers after a log so errors can be traced
+    void printFiles(const std::vector<std::string>& files)
+    {
+        if (files.size() < 2)
+            return;
+        for (size_t i = 0; i < files.size(); i++)
+            std::cerr << "  " << i << ": " << files[i] << std::endl;
+    }
+
+    void reflect(GLuint program, std::unordered_map<std::string, int>& uniforms)
+    {
+        uniforms.clear();
+        int count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        if (maxLength <= 0)
+            return;
+
+        std::string name(maxLength, '\0');
+        for (int i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, i, maxLength, &length, &size, &type, &name[0]);
+            std::string uniformName = name.substr(0, length);
+
+            // Uniforms inside a uniform block have no location
+            int location = glGetUniformLocation(program, uniformName.c_str());
+            if (location == -1)
+                continue;
+            uniforms[uniformName] = location;
+
+            // Arrays are reported as "name[0]"; also register "name" and every element
+            auto bracket = uniformName.find('[');
+            if (bracket == std::string::npos)
+                continue;
+            std::string base = uniformName.substr(0, bracket);
+            uniforms[base] = location;
+            for (int element = 1; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                uniforms[elementName] = glGetUniformLocation(program, elementName.c_str());
+            }
+        }
+    }
+}
+
+ShaderLibrary& ShaderLibrary::get()
+{
+    static ShaderLibrary library;
+    return library;
+}
+
+ShaderLibrary::ShaderLibrary()
+    : context(nullptr), pollInterval(0.25), stopping(false)
+#ifdef PROJECT_SOURCE_DIR
+    , dir(PROJECT_SOURCE_DIR "/Glitter/Shaders/")
+#endif
+{
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+    // The context is gone by now, so only the thread can be cleaned up
+    if (worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+}
+
+bool ShaderLibrary::preprocess(const std::string& path, std::string& source,
+                               std::vector<std::string>* files, const std::string& includeDirectory)
+{
+    std::string text;
+    if (!readFile(path, text))
+    {
+        std::cerr << "ERROR::SHADER::FILE_NOT_READ " << path << std::endl;
+        return false;
+    }
+
+    // #version must stay first, so it is the root's own first line
+    std::vector<std::string> read(1, path);
+    source.clear();
+    bool success = expand(path, text, includeDirectory, read, source);
+    if (files)
+        files->swap(read);
+    return success;
+}
+
+size_t ShaderLibrary::addStage(const std::string& name)
+{
+    std::string path = isAbsolute(name) ? name : dir + name;
+    for (size_t i = 0; i < stages.size(); i++)
+        if (stages[i].path == path)
+            return i;
+
+    Stage stage;
+    stage.path = path;
+    stage.type = stageType(path);
+    stage.shader = 0;
+    if (stage.type == GL_NONE)
+        std::cerr << "ERROR::SHADER::UNKNOWN_STAGE " << path << std::endl;
+    preprocess(path, stage.source, &stage.files, dir);
+    if (stage.files.empty())
+        stage.files.push_back(path);
+    track(stage.files);
+    stages.push_back(stage);
+    return stages.size() - 1;
+}
+
+bool ShaderLibrary::compile(Stage& stage)
+{
+    if (stage.type == GL_NONE)
+        return false;
+
+    const char* code = stage.source.c_str();
+    GLuint shader = glCreateShader(stage.type);
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+
+    int success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        int length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(std::max(length, 1), '\0');
+        glGetShaderInfoLog(shader, length, NULL, &infoLog[0]);
+        std::cerr << "ERROR::SHADER::" << stageName(stage.type) << "::COMPILATION_FAILED "
+                  << stage.path << "\n" << infoLog.c_str() << std::endl;
+        printFiles(stage.files);
+        glDeleteShader(shader);
+        return false;
+    }
+    if (stage.shader)
+        glDeleteShader(stage.shader);
+    stage.shader = shader;
+    return true;
+}
+
+GLuint ShaderLibrary::link(const Program& program, bool retrievable)
+{
+    // Stages restored from the binary cache were never compiled
+    for (size_t index : program.stages)
+        if (!stages[index].shader && !compile(stages[index]))
+            return 0;
+
+    // Shader objects are kept after linking, so a relink only compiles what changed
+    GLuint id = glCreateProgram();
+    for (size_t index : program.stages)
+        glAttachShader(id, stages[index].shader);
+    if (retrievable)
+        ProgramCache::prepare(id);
+    glLinkProgram(id);
+    for (size_t index : program.stages)
+        glDetachShader(id, stages[index].shader);
+
+    int success = 0;
+    glGetProgramiv(id, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        int length = 0;
+        glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
+        std::string infoLog(std::max(length, 1), '\0');
+        glGetProgramInfoLog(id, length, NULL, &infoLog[0]);
+        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED";
+        for (size_t index : program.stages)
+            std::cerr << " " << stages[index].path;
+        std::cerr << "\n" << infoLog.c_str() << std::endl;
+        glDeleteProgram(id);
+        return 0;
+    }
+    bindUniformBlocks(id);
+    return id;
+}
+
+unsigned int ShaderLibrary::load(const std::vector<std::string>& names)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Program program;
+    program.current = 0;
+    program.generation = 0;
+    std::vector<std::string> sources;
+    for (const auto& name : names)
+    {
+        program.stages.push_back(addStage(name));
+        sources.push_back(stages[program.stages.back()].source);
+    }
+
+    // Restore from the binary cache like Shader does, or build from source
+    ProgramCache& cache = ProgramCache::get();
+    std::string cacheKey = cache.key(sources);
+    GLuint id = glCreateProgram();
+    if (cache.load(id, cacheKey))
+    {
+        bindUniformBlocks(id);
+    }
+    else
+    {
+        glDeleteProgram(id);
+        id = link(program, true);
+        if (id)
+            cache.store(id, cacheKey);
+    }
+
+    // A program that fails to build is still watched, and appears once fixed
+    program.current = id;
+    if (id)
+        reflect(id, program.uniforms);
+    programs.push_back(program);
+    return static_cast<unsigned int>(programs.size() - 1);
+}
+
+int ShaderLibrary::uniform(unsigned int handle, const std::string& name) const
+{
+    const auto& uniforms = programs[handle].uniforms;
+    auto it = uniforms.find(name);
+    return it != uniforms.end() ? it->second : -1;
+}
+
+void ShaderLibrary::track(const std::vector<std::string>& files)
+{
+    for (const auto& file : files)
+    {
+        std::pair<long long, long long> stamp(0, 0);
+        if (stamps.find(file) == stamps.end())
+        {
+            fileStamp(file, stamp);
+            stamps[file] = stamp;
+        }
+    }
+}
+
+void ShaderLibrary::watch(GLFWwindow* window, double interval)
+{
+    if (worker.joinable())
+        return;
+
+    // A hidden 1x1 window is the portable way to get a second, shared context
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    context = glfwCreateWindow(1, 1, "Shader Watcher", nullptr, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!context)
+    {
+        std::cerr << "ERROR::SHADER::WATCH_CONTEXT_FAILED" << std::endl;
+        return;
+    }
+
+    pollInterval = interval;
+    stopping = false;
+    worker = std::thread(&ShaderLibrary::run, this);
+}
+
+void ShaderLibrary::unwatch()
+{
+    if (!worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    glfwDestroyWindow(context);
+    context = nullptr;
+}
+
+void ShaderLibrary::run()
+{
+    Profiler::get().nameThread("Shaders");
+    glfwMakeContextCurrent(context);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        wake.wait_for(lock, std::chrono::duration<double>(pollInterval));
+        if (!stopping)
+            rebuild();
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+
+void ShaderLibrary::rebuild()
+{
+    // Files whose stamp moved since the last poll. A file that can't be
+    // stat'ed is skipped, as editors often replace files by renaming.
+    std::vector<std::string> changed;
+    for (auto& entry : stamps)
+    {
+        std::pair<long long, long long> stamp;
+        if (fileStamp(entry.first, stamp) && stamp != entry.second)
+        {
+            entry.second = stamp;
+            changed.push_back(entry.first);
+        }
+    }
+    if (changed.empty())
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<bool> dirty(stages.size(), false);
+    std::vector<bool> failed(stages.size(), false);
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        Stage& stage = stages[i];
+        bool affected = false;
+        for (const auto& file : stage.files)
+            affected = affected || std::find(changed.begin(), changed.end(), file) != changed.end();
+        if (!affected)
+            continue;
+
+        // Saving without edits, or touching an include, leaves the text alone
+        Stage next = stage;
+        bool expanded = preprocess(stage.path, next.source, &next.files, dir);
+        track(next.files);
+        if (!expanded)
+        {
+            failed[i] = true;
+            continue;
+        }
+        if (next.source == stage.source)
+            continue;
+
+        // Compile the new text first, so a failure keeps the working shader
+        next.shader = 0;
+        if (!compile(next))
+        {
+            failed[i] = true;
+            continue;
+        }
+        if (stage.shader)
+            glDeleteShader(stage.shader);
+        stage = next;
+        dirty[i] = true;
+    }
+
+    // Relink programs using a recompiled stage, unless another of their stages broke
+    bool built = false;
+    for (size_t i = 0; i < programs.size(); i++)
+    {
+        const Program& program = programs[i];
+        bool relink = false, broken = false;
+        for (size_t index : program.stages)
+        {
+            relink = relink || dirty[index];
+            broken = broken || failed[index];
+        }
+        if (broken)
+        {
+            std::cerr << "ERROR::SHADER::RELOAD_FAILED keeping the previous program for";
+            for (size_t index : program.stages)
+                std::cerr << " " << stages[index].path;
+            std::cerr << std::endl;
+            continue;
+        }
+        if (!relink)
+            continue;
+
+        GLuint id = link(program, false);
+        if (!id)
+            continue;
+
+        // The fence tells update() when the main context may use the program
+        Swap swap;
+        swap.program = i;
+        swap.id = id;
+        swap.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        {
+            std::lock_guard<std::mutex> readyLock(readyMutex);
+            ready.push_back(swap);
+        }
+        built = true;
+    }
+    if (!built)
+        return;
+    glFlush();
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Reloaded shaders in " << milliseconds << " ms" << std::endl;
+}
+
+size_t ShaderLibrary::update()
+{
+    std::lock_guard<std::mutex> lock(readyMutex);
+
+    // Swap in order, so two rebuilds of a program never land backwards
+    size_t swapped = 0;
+    for (; swapped < ready.size(); swapped++)
+    {
+        const Swap& swap = ready[swapped];
+        if (glClientWaitSync(swap.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        glDeleteSync(swap.fence);
+
+        Program& program = programs[swap.program];
+        GLuint previous = program.current;
+        program.current = swap.id;
+        reflect(swap.id, program.uniforms);
+        program.generation++;
+        if (previous)
+            GLState::get().deleteProgram(previous);
+    }
+    ready.erase(ready.begin(), ready.begin() + swapped);
+    return swapped;
+}
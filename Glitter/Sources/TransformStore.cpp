@@ -0,0 +1,177 @@
+#include "TransformStore.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GLITTER_SSE
+#include <xmmintrin.h>
+#endif
+
+TransformStore::TransformStore(size_t capacity)
+    : count(0), gpuCapacity(0), lastBytes(0), lastCalls(0)
+{
+    glGenBuffers(1, &gpuBuffer);
+    resize(capacity);
+}
+
+TransformStore::~TransformStore()
+{
+    glDeleteBuffers(1, &gpuBuffer);
+}
+
+void TransformStore::resize(size_t newCount)
+{
+    // Arrays are padded to whole blocks so conversion never needs a tail case
+    size_t padded = (newCount + blockSize - 1) / blockSize * blockSize;
+    positionX.resize(padded, 0.0f);
+    positionY.resize(padded, 0.0f);
+    positionZ.resize(padded, 0.0f);
+    rotationX.resize(padded, 0.0f);
+    rotationY.resize(padded, 0.0f);
+    rotationZ.resize(padded, 0.0f);
+    rotationW.resize(padded, 1.0f);
+    scaleX.resize(padded, 1.0f);
+    scaleY.resize(padded, 1.0f);
+    scaleZ.resize(padded, 1.0f);
+    converted.resize(padded, glm::mat4(1.0f));
+    dirty.resize(padded / blockSize, 0);
+
+    // Slots past the old count, and padding left over from a shrink, may still
+    // hold old data; reset them so every entry a later grow exposes is identity
+    for (size_t i = std::min(count, newCount); i < padded; i++)
+    {
+        positionX[i] = positionY[i] = positionZ[i] = 0.0f;
+        rotationX[i] = rotationY[i] = rotationZ[i] = 0.0f;
+        rotationW[i] = 1.0f;
+        scaleX[i] = scaleY[i] = scaleZ[i] = 1.0f;
+        converted[i] = glm::mat4(1.0f);
+    }
+    for (size_t i = count; i < newCount; i++)
+        markDirty(i);
+    count = newCount;
+}
+
+void TransformStore::set(size_t index, const glm::vec3& position, const glm::quat& rotation)
+{
+    if (positionX[index] == position.x && positionY[index] == position.y && positionZ[index] == position.z &&
+        rotationX[index] == rotation.x && rotationY[index] == rotation.y &&
+        rotationZ[index] == rotation.z && rotationW[index] == rotation.w)
+        return;
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    rotationW[index] = rotation.w;
+    markDirty(index);
+}
+
+void TransformStore::setScale(size_t index, const glm::vec3& scale)
+{
+    if (scaleX[index] == scale.x && scaleY[index] == scale.y && scaleZ[index] == scale.z)
+        return;
+    scaleX[index] = scale.x;
+    scaleY[index] = scale.y;
+    scaleZ[index] = scale.z;
+    markDirty(index);
+}
+
+void TransformStore::upload()
+{
+    lastBytes = 0;
+    lastCalls = 0;
+
+    // A bigger buffer starts empty, so everything has to be sent again
+    glBindBuffer(GL_COPY_WRITE_BUFFER, gpuBuffer);
+    if (count > gpuCapacity)
+    {
+        gpuCapacity = std::max(count, gpuCapacity * 2);
+        glBufferData(GL_COPY_WRITE_BUFFER, gpuCapacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        std::fill(dirty.begin(), dirty.end(), 1);
+    }
+
+    // Walk dirty runs, bridging short clean gaps so calls stay few
+    size_t blocks = dirty.size();
+    for (size_t first = 0; first < blocks; )
+    {
+        if (!dirty[first])
+        {
+            first++;
+            continue;
+        }
+        size_t last = first;
+        for (size_t next = first; next < blocks && next <= last + mergeGap; next++)
+        {
+            if (!dirty[next])
+                continue;
+            convert(next);
+            dirty[next] = 0;
+            last = next;
+        }
+
+        size_t begin = first * blockSize;
+        size_t end = std::min((last + 1) * blockSize, count);
+        size_t bytes = (end - begin) * sizeof(glm::mat4);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, begin * sizeof(glm::mat4), bytes, &converted[begin]);
+        lastBytes += bytes;
+        lastCalls++;
+        first = last + 1;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    Profiler::get().count(ProfileCounter::UploadBytes, lastBytes);
+}
+
+void TransformStore::convert(size_t block)
+{
+    size_t i = block * blockSize;
+    float* out = &converted[i][0][0];
+
+#ifdef GLITTER_SSE
+    // One lane per entry: build the matrix columns for four entries at once,
+    // then transpose each column set so every entry's column is contiguous
+    __m128 x = _mm_loadu_ps(&rotationX[i]), y = _mm_loadu_ps(&rotationY[i]);
+    __m128 z = _mm_loadu_ps(&rotationZ[i]), w = _mm_loadu_ps(&rotationW[i]);
+    __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+    __m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+    __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+    __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+    __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+    __m128 sx = _mm_loadu_ps(&scaleX[i]), sy = _mm_loadu_ps(&scaleY[i]), sz = _mm_loadu_ps(&scaleZ[i]);
+
+    __m128 columns[4][4] = {
+        { _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx),
+          _mm_mul_ps(_mm_add_ps(xy, wz), sx),
+          _mm_mul_ps(_mm_sub_ps(xz, wy), sx), zero },
+        { _mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+          _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+          _mm_mul_ps(_mm_add_ps(yz, wx), sy), zero },
+        { _mm_mul_ps(_mm_add_ps(xz, wy), sz),
+          _mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+          _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), zero },
+        { _mm_loadu_ps(&positionX[i]), _mm_loadu_ps(&positionY[i]), _mm_loadu_ps(&positionZ[i]), one },
+    };
+    for (int c = 0; c < 4; c++)
+    {
+        _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+        for (int lane = 0; lane < 4; lane++)
+            _mm_storeu_ps(out + lane * 16 + c * 4, columns[c][lane]);
+    }
+#else
+    for (size_t lane = 0; lane < blockSize; lane++, i++, out += 16)
+    {
+        float x = rotationX[i], y = rotationY[i], z = rotationZ[i], w = rotationW[i];
+        float xx = 2 * x * x, yy = 2 * y * y, zz = 2 * z * z;
+        float xy = 2 * x * y, xz = 2 * x * z, yz = 2 * y * z;
+        float wx = 2 * w * x, wy = 2 * w * y, wz = 2 * w * z;
+        const float matrix[16] = {
+            (1 - yy - zz) * scaleX[i], (xy + wz) * scaleX[i], (xz - wy) * scaleX[i], 0,
+            (xy - wz) * scaleY[i], (1 - xx - zz) * scaleY[i], (yz + wx) * scaleY[i], 0,
+            (xz + wy) * scaleZ[i], (yz - wx) * scaleZ[i], (1 - xx - yy) * scaleZ[i], 0,
+            positionX[i], positionY[i], positionZ[i], 1,
+        };
+        std::copy(matrix, matrix + 16, out);
+    }
+#endif
+}
@@ -0,0 +1,134 @@
+#include "UniformBuffer.hpp"
+
+#include <cstring>
+#include <iostream>
+
+void bindUniformBlocks(unsigned int program)
+{
+    struct { const char* name; unsigned int binding; } const blocks[] =
+    {
+        { "Camera",   UniformBinding::Camera   },
+        { "Frame",    UniformBinding::Frame    },
+        { "Material", UniformBinding::Material },
+        { "Object",   UniformBinding::Object   },
+    };
+
+    // Blocks a program doesn't declare (or that were optimized out) are skipped
+    for (const auto& block : blocks)
+    {
+        GLuint index = glGetUniformBlockIndex(program, block.name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, block.binding);
+    }
+}
+
+UniformRing::UniformRing(std::size_t size, unsigned int count)
+    : segments(count), segment(0), head(0),
+      persistentMapping(false), mapped(nullptr), writing(nullptr)
+{
+    // Every pushed block must start on the driver's offset alignment
+    GLint offsetAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    alignment = static_cast<std::size_t>(offsetAlignment);
+    segmentSize = (size + alignment - 1) / alignment * alignment;
+
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_UNIFORM_BUFFER, ID);
+    if (GLAD_GL_VERSION_4_4)
+    {
+        // Map the whole ring once; coherent, so writes need no explicit flush
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, segmentSize * segments, nullptr, flags);
+        mapped = static_cast<unsigned char*>(
+            glMapBufferRange(GL_UNIFORM_BUFFER, 0, segmentSize * segments, flags));
+        persistentMapping = mapped != nullptr;
+        fences.assign(segments, nullptr);
+    }
+
+    if (!persistentMapping)
+    {
+        // Orphaning fallback only ever needs a single segment
+        segments = 1;
+        glBufferData(GL_UNIFORM_BUFFER, segmentSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRing::~UniformRing()
+{
+    for (GLsync fence : fences)
+        if (fence)
+            glDeleteSync(fence);
+    if (persistentMapping)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &ID);
+}
+
+void UniformRing::begin()
+{
+    head = 0;
+    if (persistentMapping)
+    {
+        // Draws reading the previous segment have all been issued by now
+        fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        // Wait until the GPU has finished reading this segment from N frames ago
+        segment = (segment + 1) % segments;
+        GLsync& fence = fences[segment];
+        if (fence)
+        {
+            GLenum result = glClientWaitSync(fence, 0, 0);
+            while (result == GL_TIMEOUT_EXPIRED)
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        writing = mapped + segment * segmentSize;
+    }
+    else
+    {
+        // Orphan the previous storage so the driver can hand back fresh memory
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, segmentSize, nullptr, GL_STREAM_DRAW);
+        writing = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, segmentSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+}
+
+std::size_t UniformRing::push(const void* data, std::size_t size)
+{
+    if (writing == nullptr || head + size > segmentSize)
+    {
+        std::cerr << "ERROR::UNIFORM_RING::SEGMENT_OVERFLOW (" << head + size
+                  << " > " << segmentSize << " bytes)" << std::endl;
+        return overflow;
+    }
+
+    std::memcpy(writing + head, data, size);
+    std::size_t offset = segment * segmentSize + head;
+    head += (size + alignment - 1) / alignment * alignment;
+    return offset;
+}
+
+void UniformRing::end()
+{
+    // Persistent segments are fenced in the next begin(), after their draws
+    if (!persistentMapping)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    writing = nullptr;
+}
+
+void UniformRing::bind(unsigned int binding, std::size_t offset, std::size_t size) const
+{
+    if (offset == overflow) return;
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, ID, offset, size);
+}
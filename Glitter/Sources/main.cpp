@@ -1,5 +1,14 @@
 // Local Headers
 #include "glitter.hpp"
+#include "Extensions.hpp"
+#include "FramePacer.hpp"
+#include "GLState.hpp"
+#include "Jobs.hpp"
+#include "Memory.hpp"
+#include "Physics.hpp"
+#include "Profiler.hpp"
+#include "ShaderLibrary.hpp"
+#include "UniformBuffer.hpp"
 
 // System Headers
 #include <glad/glad.h>
@@ -8,21 +17,19 @@
 // Standard Headers
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
-void renderObjects(unsigned int VAO, unsigned int shaderProgram)
+void renderObjects(unsigned int VAO, unsigned int shaderProgram, unsigned int indexCount)
 {
-    // Rebind VAO
-    glBindVertexArray(VAO);
-
-    // Set shader program
-    glUseProgram(shaderProgram);
-
-    // Finally draw our 2 triangles (square) using the values set in the EBO, which indexes into the VBO
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-    // Unbind VAO so other VAO calls won't unintentionally modify this VAO
-    glBindVertexArray(0);
+    // Bind VAO and shader program; both are skipped when already bound from last frame
+    GLState::get().bindVertexArray(VAO);
+    GLState::get().useProgram(shaderProgram);
+
+    // Finally draw our triangles using the values set in the EBO, which indexes into the VBO
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    Profiler::get().count(ProfileCounter::DrawCalls);
+    Profiler::get().count(ProfileCounter::Triangles, indexCount / 3);
 }
 
 int main(int argc, char * argv[])
@@ -51,6 +58,10 @@ int main(int argc, char * argv[])
     gladLoadGL();
     std::cerr << "OpenGL " << glGetString(GL_VERSION) << std::endl;
 
+    // Read the Extension List While This Thread Has the Context, so Workers
+    // Checking Extensions Later Never Query GL Themselves
+    hasExtension("GL_KHR_parallel_shader_compile");
+
     // Background Fill Color
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -67,6 +78,7 @@ int main(int argc, char * argv[])
         // Note that we start from 0!
         0, 1, 2   // first triangle
     };
+    constexpr unsigned int indexCount = sizeof(indices) / sizeof(indices[0]);
 
     // Generate VAO
     unsigned int VAO;
@@ -108,100 +120,111 @@ int main(int argc, char * argv[])
     // Unbind VAO so other VAO calls won't unintentionally modify this VAO
     glBindVertexArray(0);
 
-    // Source code for vertex shader
-    const char * vertexShaderSource = R"(
-        #version 330 core
-        layout (location = 0) in vec3 aPos;
-        layout (location = 1) in vec3 aColor;
-
-        out vec3 ourColor; // output a color to the fragment shader
-
-        void main()
-        {
-            gl_Position = vec4(aPos, 1.0);
-            ourColor = aColor;
-        }
-    )";
-
-    // Create vertex shader, set source code, and compile
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-    glCompileShader(vertexShader);
-
-    // Check for compilation errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-
-    if (!success)
+    // Build the Program From Glitter/Shaders; With --watch-shaders, Saving
+    // Either File Recompiles it While the App Runs
+    unsigned int triangleShader = ShaderLibrary::get().load({ "triangle.vert", "triangle.frag" });
+
+    // Pace Frames: --immediate, --adaptive, --fps N and --low-latency Adjust the Defaults;
+    // --check-allocations Reports Frames That Still Allocate Once Warmed Up, and
+    // --watch-shaders Rebuilds Library Programs When Their Files are Saved
+    PacingOptions pacing;
+    bool checkAllocations = false;
+    bool watchShaders = false;
+    for (int i = 1; i < argc; i++)
     {
-        glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog);
-        std::cerr << "Error compiling vertex shader:\n" << infoLog << std::endl;
+        if (std::strcmp(argv[i], "--immediate") == 0) pacing.swap = SwapMode::Immediate;
+        else if (std::strcmp(argv[i], "--adaptive") == 0) pacing.swap = SwapMode::Adaptive;
+        else if (std::strcmp(argv[i], "--low-latency") == 0) pacing.lowLatency = true;
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) pacing.frameLimit = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--check-allocations") == 0) checkAllocations = true;
+        else if (std::strcmp(argv[i], "--watch-shaders") == 0) watchShaders = true;
     }
+    FramePacer pacer(mWindow, pacing);
 
-    // Create fragment shader, set source code, and compile
-    const char * fragmentShaderSource = R"(
-        #version 330 core
-        out vec4 FragColor;
-        in vec3 ourColor;
+    // Allocate Per-Frame Storage; the Library Attached the Shared Uniform
+    // Blocks, and the Pacer Keeps the GPU off Each Segment Before it is Rewritten
+    UniformRing frameUniforms(sizeof(FrameBlock), pacer.framesInFlight());
+    FrameBlock frame = {};
 
-        void main()
-        {
-            FragColor = vec4(ourColor, 1.0);
-        }
-    )";
+    // Start the Shared Job Pool From Here, Making This the Main Thread
+    JobSystem::get();
 
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-    glCompileShader(fragmentShader);
+    // Step Physics on Its Own Thread; Bodies are Added Through the World,
+    // and Their Blended Transforms Read Back as in Physics.hpp
+    PhysicsWorld physics;
+    physics.start();
 
-    // Check for compilation errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    // Recompile Edited Shaders on a Hidden Context Sharing This One
+    if (watchShaders)
+        ShaderLibrary::get().watch(mWindow);
 
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog);
-        std::cerr << "Error compiling fragment shader:\n" << infoLog << std::endl;
-    }
-
-    // Create shader program and attach previously compiled vertex and fragment shaders
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // Check for linking errors
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
-        std::cerr << "Error linking shader program:\n" << infoLog << std::endl;
-    }
+    // Frame Timings Go in the Title Once a Second; F12 Writes a Trace
+    Profiler::get().nameThread("Render");
+    double reportTime = glfwGetTime();
+    bool traceKey = false;
 
     // Rendering Loop
     while (glfwWindowShouldClose(mWindow) == false)
     {
+        // Wait for a Free Frame Slot, Then Sample Input as Late as Possible
+        pacer.begin();
+        FrameArena::get().reset();
+        glfwPollEvents();
         if (glfwGetKey(mWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         {
             glfwSetWindowShouldClose(mWindow, true);
         }
+        bool tracePressed = glfwGetKey(mWindow, GLFW_KEY_F12) == GLFW_PRESS;
+        if (tracePressed && !traceKey)
+            Profiler::get().writeTrace("trace.json");
+        traceKey = tracePressed;
+        Profiler::get().beginFrame();
+
+        // Run Jobs That Need the Context, Such as Uploads Queued by Workers
+        JobSystem::get().pump(0.002);
 
-        // Assign
+        // Swap in Shaders Rebuilt Since the Last Frame
+        ShaderLibrary::get().update();
+
+        // Write Per-Frame Uniforms Once and Bind Them for Every Program
         float timeValue = static_cast<float>(glfwGetTime());
         float greenValue = (sin(timeValue) / 2.0f) + 0.5f;
-        int vertexColorLocation = glGetUniformLocation(shaderProgram, "ourColor");
-        // Note that finding the uniform location does not require you to use the shader program first,
-        // but updating a uniform does require you to first use the program (by calling glUseProgram),
-        // because it sets the uniform on the currently active shader program.
-        glUseProgram(shaderProgram);
-        glUniform4f(vertexColorLocation, 0.0f, greenValue, 0.0f, 1.0f); // (location, r, g, b, a)
+        frame.color = glm::vec4(0.0f, greenValue, 0.0f, 1.0f);
+        frame.deltaTime = timeValue - frame.time;
+        frame.time = timeValue;
+        frame.frameIndex += 1.0f;
+        frameUniforms.begin();
+        auto frameOffset = frameUniforms.push(frame);
+        frameUniforms.end();
+        frameUniforms.bind(UniformBinding::Frame, frameOffset, sizeof(FrameBlock));
 
-        renderObjects(VAO, shaderProgram);
+        {
+            PROFILE_SCOPE("Render");
+            PROFILE_GPU("Render");
+            renderObjects(VAO, ShaderLibrary::get().program(triangleShader), indexCount);
+        }
 
-        // Flip Buffers and Draw
-        glfwSwapBuffers(mWindow);
-        glfwPollEvents();
+        Profiler::get().endFrame();
+        const FrameStats& last = Profiler::get().lastFrame();
+        if (checkAllocations && last.frame > 120 && last.counters[ProfileCounter::Allocations] > 0)
+            std::cerr << "ERROR::MEMORY::FRAME_ALLOCATED " << last.counters[ProfileCounter::Allocations]
+                      << " allocations in frame " << last.frame << std::endl;
+        if (glfwGetTime() - reportTime >= 1.0)
+        {
+            FrameStats stats = Profiler::get().average();
+            char title[128];
+            std::snprintf(title, sizeof(title), "OpenGL - %.2f ms frame, %.2f ms CPU, %.2f ms GPU, %llu draws",
+                          pacer.frameMilliseconds(), stats.cpuMilliseconds, stats.gpuMilliseconds,
+                          static_cast<unsigned long long>(stats.counters[ProfileCounter::DrawCalls]));
+            glfwSetWindowTitle(mWindow, title);
+            reportTime = glfwGetTime();
+        }
+
+        // Fence This Frame and Flip Buffers
+        pacer.end();
     }
+    physics.stop();
+    ShaderLibrary::get().unwatch();
     glfwTerminate();
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,222 @@
+// Local Headers
+#include "arena.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+#include "UniformBuffer.hpp"
+
+// Standard Headers
+#include <algorithm>
+#include <numeric>
+
+// Define Namespace
+namespace Mirage
+{
+    MeshArena::MeshArena(std::size_t vertices, std::size_t indices)
+        : mVertexCapacity(vertices), mVertexCount(0)
+        , mIndexCapacity(indices),   mIndexCount(0)
+        , mDrawCapacity(0)
+    {
+        // Allocate the Shared Buffers Up Front; They Grow by Copying if Needed
+        GLuint buffers[5];
+        glGenBuffers(5, buffers);
+        mVertexBuffer    = buffers[0];
+        mElementBuffer   = buffers[1];
+        mDrawIndexBuffer = buffers[2];
+        mCommandBuffer   = buffers[3];
+        mStorageBuffer   = buffers[4];
+
+        // Bind a Single Vertex Array for Everything in the Arena
+        glGenVertexArrays(1, & mVertexArray);
+        GLState::get().bindVertexArray(mVertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, mVertexCapacity * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+        Mesh::attributes(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndexCapacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+
+        // Draw Index Attribute; baseInstance Selects the Element per Draw
+        glBindBuffer(GL_ARRAY_BUFFER, mDrawIndexBuffer);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), (GLvoid *) 0);
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(3);
+        GLState::get().bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    MeshArena::~MeshArena()
+    {
+        GLuint buffers[] = { mVertexBuffer, mElementBuffer, mDrawIndexBuffer, mCommandBuffer, mStorageBuffer };
+        glDeleteBuffers(5, buffers);
+        GLState::get().deleteVertexArray(mVertexArray);
+    }
+
+    MeshArena::Range MeshArena::add(std::vector<Vertex> const & vertices, std::vector<GLuint> const & indices)
+    {
+        // Grow Either Buffer (and Re-Point the Vertex Array) When it Runs Out
+        if (mVertexCount + vertices.size() > mVertexCapacity || mIndexCount + indices.size() > mIndexCapacity)
+        {   grow(mVertexBuffer,  sizeof(Vertex), mVertexCount, mVertexCapacity, mVertexCount + vertices.size());
+            grow(mElementBuffer, sizeof(GLuint), mIndexCount,  mIndexCapacity,  mIndexCount  + indices.size());
+            GLState::get().bindVertexArray(mVertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+            Mesh::attributes(0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBuffer);
+            GLState::get().bindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        // Copy the Data Into the Next Free Ranges
+        Range range = { GLint(mVertexCount), GLuint(mIndexCount), GLuint(indices.size()), GLuint(vertices.size()),
+                        boundingSphere(vertices.data(), vertices.size()) };
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mVertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, mVertexCount * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mElementBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, mIndexCount * sizeof(GLuint), indices.size() * sizeof(GLuint), indices.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        mVertexCount += vertices.size();
+        mIndexCount  += indices.size();
+        return range;
+    }
+
+    void MeshArena::grow(GLuint & buffer, std::size_t stride, std::size_t used, std::size_t & capacity, std::size_t needed)
+    {
+        if (needed <= capacity) return;
+        capacity = std::max(capacity * 2, needed);
+
+        // Copy the Live Contents Into a Bigger Buffer on the GPU
+        GLuint bigger;
+        glGenBuffers(1, & bigger);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * stride, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used * stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, & buffer);
+        buffer = bigger;
+    }
+
+    GLuint MeshArena::material(TextureSet const & textures)
+    {
+        // Sub-Meshes With Identical Texture Sets Share a Material, and a Draw Call
+        Material built = Material::build(textures);
+        auto it = std::find_if(mMaterials.begin(), mMaterials.end(),
+            [&](Material const & m) { return m.id == built.id; });
+        if (it != mMaterials.end()) return GLuint(it - mMaterials.begin());
+        mMaterials.push_back(built);
+        return GLuint(mMaterials.size() - 1);
+    }
+
+    void MeshArena::draw(Range const & range, GLuint material, glm::mat4 const & model)
+    {
+        Draw draw = { material, range, model };
+        mDraws.push_back(draw);
+    }
+
+    void MeshArena::submit(GLuint shader)
+    {
+        if (mDraws.empty()) return;
+        PROFILE_SCOPE("Submit");
+
+        // Group Draws by Material; Each Group Becomes One Multi-Draw
+        std::stable_sort(mDraws.begin(), mDraws.end(),
+            [](Draw const & a, Draw const & b) { return a.material < b.material; });
+        mCommands.clear();
+        mData.clear();
+        std::uint64_t indices = 0;
+        for (auto & draw : mDraws)
+        {   indices += draw.range.indexCount;
+            Command command = { draw.range.indexCount, 1, draw.range.firstIndex,
+                                draw.range.baseVertex, GLuint(mCommands.size()) };
+            DrawData data = { draw.model, glm::uvec4(draw.material, 0, 0, 0) };
+            mCommands.push_back(command);
+            mData.push_back(data);
+        }
+
+        reserve(mDraws.size());
+
+        // Upload Commands and Per-Draw Data, Orphaning Last Frame's Storage
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, mCommands.size() * sizeof(Command), mCommands.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mStorageBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, mData.size() * sizeof(DrawData), mData.data(), GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Draws, mStorageBuffer);
+
+        // Issue One Call per Material
+        GLState::get().bindVertexArray(mVertexArray);
+        for (std::size_t first = 0, last = 0; first < mDraws.size(); first = last)
+        {   GLuint material = mDraws[first].material;
+            while (last < mDraws.size() && mDraws[last].material == material) last++;
+            bind(shader, mMaterials[material]);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (GLvoid *) (first * sizeof(Command)), GLsizei(last - first), 0);
+            Profiler::get().count(ProfileCounter::DrawCalls);
+        }   GLState::get().bindVertexArray(0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        Profiler::get().count(ProfileCounter::Triangles, indices / 3);
+        mDraws.clear();
+    }
+
+    void MeshArena::submit(GLuint shader, CullPass & pass)
+    {
+        if (mDraws.empty()) return;
+        PROFILE_SCOPE("Submit");
+
+        // Each Material is a Batch With One Command Slot per Queued Draw;
+        // the Compute Pass Decides Which Slots are Drawn
+        std::stable_sort(mDraws.begin(), mDraws.end(),
+            [](Draw const & a, Draw const & b) { return a.material < b.material; });
+        FrameVector<std::pair<std::size_t, std::size_t>> batches; // Offset, Capacity
+        mInstances.clear();
+        for (std::size_t i = 0; i < mDraws.size(); i++)
+        {   Draw const & draw = mDraws[i];
+            if (i == 0 || draw.material != mDraws[i - 1].material)
+                batches.push_back(std::make_pair(i, std::size_t(0)));
+            batches.back().second++;
+            CullPass::Instance instance = { draw.model, draw.range.sphere,
+                glm::uvec4(draw.range.indexCount, draw.range.firstIndex, GLuint(draw.range.baseVertex), GLuint(batches.size() - 1)),
+                glm::uvec4(draw.material, GLuint(batches.back().first), 0, 0) };
+            mInstances.push_back(instance);
+        }
+        reserve(mDraws.size());
+
+        // The Shader Fills Both Buffers, so They are Only Sized Here
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, mDraws.size() * sizeof(Command), nullptr, GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Commands, mCommandBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mStorageBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, mDraws.size() * sizeof(DrawData), nullptr, GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Draws, mStorageBuffer);
+        pass.cull(mInstances, batches.size());
+
+        // Issue One Call per Material, Back on the Caller's Program
+        GLState::get().useProgram(shader);
+        GLState::get().bindVertexArray(mVertexArray);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+        for (std::size_t batch = 0; batch < batches.size(); batch++)
+        {   bind(shader, mMaterials[mDraws[batches[batch].first].material]);
+            pass.draw(batch, batches[batch].first, batches[batch].second);
+            Profiler::get().count(ProfileCounter::DrawCalls);
+        }   GLState::get().bindVertexArray(0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        mDraws.clear();
+    }
+
+    void MeshArena::reserve(std::size_t draws)
+    {
+        // Extend the Identity Draw Index Buffer if There are More Draws Than Before
+        if (draws <= mDrawCapacity) return;
+        mDrawCapacity = std::max(draws, mDrawCapacity * 2);
+        std::vector<GLuint> identity(mDrawCapacity);
+        std::iota(identity.begin(), identity.end(), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, mDrawIndexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, identity.size() * sizeof(GLuint), identity.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void MeshArena::bind(GLuint shader, Material const & material)
+    {
+        // Canonical Units, so Samplers are Only Assigned the First Time
+        Material::samplers(shader);
+        material.bind();
+    }
+};
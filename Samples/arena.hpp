@@ -0,0 +1,100 @@
+#pragma once
+
+// Local Headers
+#include "cullpass.hpp"
+#include "mesh.hpp"
+
+// System Headers
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Standard Headers
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Suballocates Many Meshes Into One Vertex and One Index Buffer Behind a
+    // Single Vertex Array, and Submits Queued Draws With One Multi-Draw
+    // Indirect Call per Material. Per-Draw Data Lives in a Storage Buffer
+    // Indexed by a Per-Instance Draw Index Attribute:
+    //
+    //     layout (location = 3) in uint drawIndex;
+    //     struct Draw { mat4 model; uvec4 info; };
+    //     layout (std430, binding = 0) readonly buffer Draws { Draw draws[]; };
+    //
+    // Requires OpenGL 4.3.
+    class MeshArena
+    {
+    public:
+
+        // Location of One Mesh Inside the Arena
+        typedef MeshRange Range;
+
+        // Matches the std430 Draw Struct Above
+        struct DrawData {
+            glm::mat4  model;
+            glm::uvec4 info; // x = Material
+        };
+
+        // Implement Custom Constructor and Destructor
+        MeshArena(std::size_t vertices = 1 << 20, std::size_t indices = 1 << 22);
+        ~MeshArena();
+
+        // Public Member Functions
+        Range  add(std::vector<Vertex> const & vertices, std::vector<GLuint> const & indices);
+        GLuint material(TextureSet const & textures);
+        void   draw(Range const & range, GLuint material, glm::mat4 const & model);
+        void   submit(GLuint shader);
+        void   submit(GLuint shader, CullPass & pass); // Culls and Builds Commands on the GPU
+        GLuint vertexArray() const { return mVertexArray; }
+
+    private:
+
+        // Disable Copying and Assignment
+        MeshArena(MeshArena const &) = delete;
+        MeshArena & operator=(MeshArena const &) = delete;
+
+        // Matches the Layout glMultiDrawElementsIndirect Reads
+        struct Command {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLint  baseVertex;
+            GLuint baseInstance;
+        };
+
+        // One Queued Draw
+        struct Draw {
+            GLuint material;
+            Range  range;
+            glm::mat4 model;
+        };
+
+        // Private Member Functions
+        void grow(GLuint & buffer, std::size_t stride, std::size_t used, std::size_t & capacity, std::size_t needed);
+        void bind(GLuint shader, Material const & material);
+        void reserve(std::size_t draws);
+
+        // Private Member Containers
+        std::vector<Material> mMaterials;
+        std::vector<Draw> mDraws;
+        std::vector<Command> mCommands;
+        std::vector<DrawData> mData;
+        std::vector<CullPass::Instance> mInstances;
+
+        // Private Member Variables
+        GLuint mVertexArray;
+        GLuint mVertexBuffer;
+        GLuint mElementBuffer;
+        GLuint mDrawIndexBuffer;
+        GLuint mCommandBuffer;
+        GLuint mStorageBuffer;
+        std::size_t mVertexCapacity, mVertexCount;
+        std::size_t mIndexCapacity,  mIndexCount;
+        std::size_t mDrawCapacity;
+
+    };
+};
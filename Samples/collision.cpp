@@ -0,0 +1,444 @@
+// Local Headers
+#include "collision.hpp"
+
+// System Headers
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+// Define Namespace
+namespace Mirage
+{
+    // Shape Cache File; Sections Start on Cooked::Alignment Boundaries
+    //
+    //     Header | Hull Ranges (First, Count) | Points (vec3) | Triangle BVH
+    namespace CookedShape
+    {
+        const uint32_t Magic   = 0x50414853; // "SHAP"
+        const uint32_t Version = 2;
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t kind;
+            uint32_t hullCount;
+            uint32_t maxHulls, maxPoints;
+            float    concavity;
+            uint32_t reserved;
+            uint64_t sourceSize; // Stale Once the Model File Changes Size
+            int64_t  sourceTime; // Or is Written Again
+            uint64_t hullOffset;
+            uint64_t pointOffset, pointCount;
+            uint64_t bvhOffset,   bvhSize;
+        };
+    };
+
+    static std::string const Root = PROJECT_SOURCE_DIR "/Mirage/Models/";
+
+    static uint64_t fileSize(std::string const & filename)
+    {
+        std::ifstream fd(filename, std::ios::binary | std::ios::ate);
+        return fd ? uint64_t(fd.tellg()) : 0;
+    }
+
+    static int64_t fileTime(std::string const & filename)
+    {
+    #ifdef _WIN32
+        struct _stat info;
+        return _stat(filename.c_str(), & info) == 0 ? int64_t(info.st_mtime) : 0;
+    #else
+        struct stat info;
+        return stat(filename.c_str(), & info) == 0 ? int64_t(info.st_mtime) : 0;
+    #endif
+    }
+
+    static std::string cachePath(std::string const & filename, ShapeKind kind)
+    {
+        static char const * const names[] = { "triangles", "hull", "decomposed" };
+        return Root + filename.substr(0, filename.find_last_of(".")) + "." + names[int(kind)] + ".shape";
+    }
+
+    // Geometry Already Loaded Beats Importing the Model Again; Falls Back to
+    // the File When the Mesh Kept No CPU Copy
+    static std::unique_ptr<CollisionMesh> source(std::string const & filename, Mesh const * mesh)
+    {
+        if (mesh)
+        {   std::unique_ptr<CollisionMesh> view(new CollisionMesh(*mesh));
+            if (view->size() > 0) return view;
+        }   return CollisionMesh::load(filename);
+    }
+
+    CollisionMesh::CollisionMesh(Mesh const & mesh)
+        : mTriangleCount(0)
+    {
+        add(mesh);
+    }
+
+    CollisionMesh::CollisionMesh(std::vector<MeshData> && meshes)
+        : mMeshes(std::move(meshes)), mTriangleCount(0)
+    {
+        for (auto & mesh : mMeshes)
+            add(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+    }
+
+    CollisionMesh::CollisionMesh(std::unique_ptr<MappedFile> file)
+        : mFile(std::move(file)), mTriangleCount(0)
+    {
+        // Same Checks Mesh::read Makes Before Trusting the Offsets; a Bad File
+        // Leaves the Mesh Empty, Which load() Turns Into a Null Mesh
+        if (!Cooked::validate(*mFile)) return;
+        auto header = mFile->at<Cooked::Header>(0);
+        auto ranges = mFile->at<Cooked::SubMesh>(header->subMeshOffset);
+        for (uint32_t i = 0; i < header->subMeshCount; i++)
+            add(mFile->at<Vertex>(header->vertexOffset) + ranges[i].firstVertex, ranges[i].vertexCount,
+                mFile->at<GLuint>(header->indexOffset)  + ranges[i].firstIndex,  ranges[i].indexCount);
+    }
+
+    std::unique_ptr<CollisionMesh> CollisionMesh::load(std::string const & filename)
+    {
+        // Cooked Models are Used in Place; Anything Else Goes Through Import
+        if (filename.substr(filename.find_last_of(".") + 1) == "mesh")
+        {   std::unique_ptr<MappedFile> file(new MappedFile(Root + filename));
+            if (!file->data()) return nullptr;
+            std::unique_ptr<CollisionMesh> mesh(new CollisionMesh(std::move(file)));
+            if (mesh->size() == 0) return nullptr;
+            return mesh;
+        }
+
+        // Collision Needs Neither LODs Nor a Cache-Friendly Order
+        OptimizeOptions options; options.enabled = false; options.levels = 1;
+        std::vector<MeshData> meshes;
+        if (!Mesh::import(filename, [& meshes](MeshData && data) { meshes.push_back(std::move(data)); }, options))
+            return nullptr;
+        return std::unique_ptr<CollisionMesh>(new CollisionMesh(std::move(meshes)));
+    }
+
+    void CollisionMesh::add(Mesh const & mesh)
+    {
+        for (auto & i : mesh.mSubMeshes) add(*i);
+        if (!mesh.mVertices.empty())
+            add(mesh.mVertices.data(), mesh.mVertices.size(), mesh.mIndices.data(), mesh.mIndices.size());
+    }
+
+    void CollisionMesh::add(Vertex const * vertices, std::size_t vertexCount, GLuint const * indices, std::size_t indexCount)
+    {
+        if (indexCount < 3) return;
+        Part part = { vertices, indices, vertexCount, indexCount };
+        mParts.push_back(part);
+        mTriangleCount += indexCount / 3;
+
+        // Bullet Reads the Position at the Start of Each Interleaved Vertex
+        btIndexedMesh mesh;
+        mesh.m_numTriangles        = int(indexCount / 3);
+        mesh.m_triangleIndexBase   = reinterpret_cast<unsigned char const *>(indices);
+        mesh.m_triangleIndexStride = int(3 * sizeof(GLuint));
+        mesh.m_numVertices         = int(vertexCount);
+        mesh.m_vertexBase          = reinterpret_cast<unsigned char const *>(& vertices->position);
+        mesh.m_vertexStride        = int(sizeof(Vertex));
+        mesh.m_indexType           = PHY_INTEGER;
+        mesh.m_vertexType          = PHY_FLOAT;
+        mTriangles.addIndexedMesh(mesh, PHY_INTEGER);
+    }
+
+    // Keep the Point Farthest Along Each of a Spread of Directions; Cheaper
+    // Than a Full Hull and Close to its Shape for Collision Purposes
+    static std::vector<glm::vec3> extremes(std::vector<glm::vec3> const & points, unsigned count)
+    {
+        std::vector<bool> chosen(points.size(), points.size() <= count);
+        if (points.size() > count)
+        for (unsigned i = 0; i < count; i++)
+        {   // Directions on a Fibonacci Sphere
+            float y = 1.0f - 2.0f * (i + 0.5f) / count, r = std::sqrt(1.0f - y * y);
+            float angle = 2.39996323f * i;
+            glm::vec3 direction(r * std::cos(angle), y, r * std::sin(angle));
+            std::size_t best = 0;
+            for (std::size_t j = 1; j < points.size(); j++)
+                if (glm::dot(points[j], direction) > glm::dot(points[best], direction)) best = j;
+            chosen[best] = true;
+        }
+
+        std::vector<glm::vec3> result;
+        for (std::size_t j = 0; j < points.size(); j++)
+            if (chosen[j] && std::find(result.begin(), result.end(), points[j]) == result.end())
+                result.push_back(points[j]);
+        return result;
+    }
+
+    std::vector<std::vector<glm::vec3>> decompose(CollisionMesh const & mesh, DecomposeOptions const & options)
+    {
+        struct Triangle { glm::vec3 corner[3]; glm::vec3 centroid; };
+        std::vector<Triangle> triangles; Bounds bounds;
+        triangles.reserve(mesh.size());
+        mesh.each([& triangles, & bounds](glm::vec3 const & a, glm::vec3 const & b, glm::vec3 const & c)
+        {   Triangle triangle = { { a, b, c }, (a + b + c) / 3.0f };
+            triangles.push_back(triangle);
+            bounds.add(a); bounds.add(b); bounds.add(c);
+        });
+        if (triangles.empty()) return std::vector<std::vector<glm::vec3>>();
+
+        // Deepest Point in Front of Any Face: Zero for a Convex Cluster. Both
+        // Faces and Points are Sampled, so Large Clusters Stay Cheap.
+        typedef std::vector<uint32_t> Cluster;
+        auto dent = [& triangles](Cluster const & cluster)
+        {   std::size_t step = std::max<std::size_t>(cluster.size() / 128, 1);
+            float deepest = 0.0f;
+            for (std::size_t i = 0; i < cluster.size(); i += step)
+            {   Triangle const & face = triangles[cluster[i]];
+                glm::vec3 normal = glm::cross(face.corner[1] - face.corner[0], face.corner[2] - face.corner[0]);
+                float length = glm::length(normal);
+                if (length < 1e-12f) continue;
+                normal /= length;
+                for (std::size_t j = 0; j < cluster.size(); j += step)
+                for (auto & corner : triangles[cluster[j]].corner)
+                    deepest = std::max(deepest, glm::dot(normal, corner - face.corner[0]));
+            }   return deepest;
+        };
+
+        // Split the Most Concave Cluster Until All are Shallow Enough
+        float tolerance = options.concavity * glm::length(bounds.max - bounds.min);
+        std::vector<Cluster> clusters(1);
+        for (uint32_t i = 0; i < triangles.size(); i++) clusters[0].push_back(i);
+        std::vector<float> dents(1, dent(clusters[0]));
+        while (clusters.size() < std::max(options.maxHulls, 1u))
+        {   std::size_t worst = std::max_element(dents.begin(), dents.end()) - dents.begin();
+            if (dents[worst] <= tolerance || clusters[worst].size() < 2) break;
+
+            // Try Each Axis at the Middle of the Centroids and Keep the Cut
+            // Leaving the Shallowest Halves
+            Cluster & cluster = clusters[worst];
+            Bounds centroids;
+            for (auto i : cluster) centroids.add(triangles[i].centroid);
+            Cluster lower, upper; float lowerDent = 0.0f, upperDent = 0.0f, best = INFINITY;
+            for (int axis = 0; axis < 3; axis++)
+            {   float cut = (centroids.min[axis] + centroids.max[axis]) * 0.5f;
+                auto middle = std::partition(cluster.begin(), cluster.end(),
+                    [& triangles, axis, cut](uint32_t i) { return triangles[i].centroid[axis] < cut; });
+                if (middle == cluster.begin() || middle == cluster.end()) continue;
+                Cluster a(cluster.begin(), middle), b(middle, cluster.end());
+                float da = dent(a), db = dent(b);
+                if (da + db >= best) continue;
+                best = da + db; lowerDent = da; upperDent = db;
+                lower.swap(a); upper.swap(b);
+            }
+            if (lower.empty())
+            {   dents[worst] = 0.0f; // Every Centroid Coincides; Nothing Left to Cut
+                continue;
+            }
+            cluster.swap(lower);
+            dents[worst] = lowerDent;
+            dents.push_back(upperDent);
+            clusters.push_back(std::move(upper));
+        }
+
+        // Cuts Often Land Inside a Convex Part; Merge Back Whichever Pair
+        // Stays Shallow Together, Cheapest First
+        while (clusters.size() > 1)
+        {   std::size_t first = 0, second = 0; float best = INFINITY;
+            for (std::size_t i = 0; i < clusters.size(); i++)
+            for (std::size_t j = i + 1; j < clusters.size(); j++)
+            {   Cluster joined(clusters[i]);
+                joined.insert(joined.end(), clusters[j].begin(), clusters[j].end());
+                float depth = dent(joined);
+                if (depth < best) { best = depth; first = i; second = j; }
+            }
+            if (best > tolerance) break;
+            clusters[first].insert(clusters[first].end(), clusters[second].begin(), clusters[second].end());
+            dents[first] = best;
+            clusters.erase(clusters.begin() + second);
+            dents.erase(dents.begin() + second);
+        }
+
+        // One Hull per Cluster
+        std::vector<std::vector<glm::vec3>> hulls;
+        for (auto & cluster : clusters)
+        {   std::vector<glm::vec3> points;
+            for (auto i : cluster) points.insert(points.end(), triangles[i].corner, triangles[i].corner + 3);
+            hulls.push_back(extremes(points, std::max(options.maxPoints, 4u)));
+        }   return hulls;
+    }
+
+    struct ShapeCache::Holder {
+        Holder() : bvh(nullptr) {}
+        ~Holder()
+        {   // The Root Goes First, Then Its Children, Then What They Point At
+            while (!shapes.empty()) shapes.pop_back();
+            if (bvh) btAlignedFree(bvh);
+        }
+
+        std::unique_ptr<CollisionMesh> mesh;
+        std::vector<std::unique_ptr<btCollisionShape>> shapes; // Root Last
+        void * bvh; // Deserialized In Place, So Never Deleted
+    };
+
+    // Wrap Hulls in One Convex Shape, or a Compound of Them
+    static void assemble(std::vector<std::unique_ptr<btCollisionShape>> & shapes, glm::vec3 const * points,
+                         uint32_t const * ranges, uint32_t hullCount)
+    {
+        btTransform identity; identity.setIdentity();
+        for (uint32_t i = 0; i < hullCount; i++)
+            shapes.push_back(std::unique_ptr<btCollisionShape>(new btConvexHullShape(
+                & points[ranges[i * 2]].x, int(ranges[i * 2 + 1]), int(sizeof(glm::vec3)))));
+        if (hullCount < 2) return;
+        auto compound = new btCompoundShape(true, int(hullCount));
+        for (auto & hull : shapes) compound->addChildShape(identity, hull.get());
+        shapes.push_back(std::unique_ptr<btCollisionShape>(compound));
+    }
+
+    ShapeCache & ShapeCache::get()
+    {
+        static ShapeCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<btCollisionShape> ShapeCache::acquire(std::string const & filename, ShapeKind kind,
+                                                          DecomposeOptions const & options)
+    {
+        return acquire(filename, nullptr, kind, options);
+    }
+
+    std::shared_ptr<btCollisionShape> ShapeCache::acquire(std::string const & filename, Mesh const & mesh, ShapeKind kind,
+                                                          DecomposeOptions const & options)
+    {
+        return acquire(filename, & mesh, kind, options);
+    }
+
+    std::shared_ptr<btCollisionShape> ShapeCache::acquire(std::string const & filename, Mesh const * mesh, ShapeKind kind,
+                                                          DecomposeOptions const & options)
+    {
+        // Shared While Alive; Otherwise From Disk, and Built Only as a Last
+        // Resort. Triangle Shapes Point Into Their Source, so One Built From a
+        // Mesh is Only Shared With Callers Passing That Same Mesh.
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::string key = filename + "#" + std::to_string(int(kind));
+        if (kind != ShapeKind::Triangles)
+            key += "#" + std::to_string(options.maxHulls) + "," + std::to_string(options.maxPoints)
+                 + "," + std::to_string(options.concavity);
+        else if (mesh)
+            key += "@" + std::to_string(reinterpret_cast<std::uintptr_t>(mesh));
+        if (auto shape = mShapes[key].lock()) { mHits++; return shape; }
+        auto holder = restore(filename, mesh, kind, options);
+        if (holder) mHits++;
+        else { mMisses++; holder = build(filename, mesh, kind, options); }
+        if (!holder || holder->shapes.empty()) return nullptr;
+
+        // Aliasing Pointer: Callers See the Root, the Holder Owns Everything
+        std::shared_ptr<btCollisionShape> shape(holder, holder->shapes.back().get());
+        mShapes[key] = shape;
+        return shape;
+    }
+
+    std::shared_ptr<ShapeCache::Holder> ShapeCache::restore(std::string const & filename, Mesh const * mesh, ShapeKind kind,
+                                                            DecomposeOptions const & options)
+    {
+        // Any Mismatch Just Means the Cache is Rebuilt; Every Range is Checked
+        // Against the Mapping, so a Damaged File is Never Read Past its End
+        MappedFile file(cachePath(filename, kind));
+        auto header = file.at<CookedShape::Header>(0);
+        if (!file.data() || file.size() < sizeof(CookedShape::Header)
+            || header->magic      != CookedShape::Magic
+            || header->version    != CookedShape::Version
+            || header->kind       != uint32_t(kind)
+            || header->sourceSize != fileSize(Root + filename)
+            || header->sourceTime != fileTime(Root + filename)
+            || header->hullOffset  % alignof(uint32_t)  != 0 || !Cooked::inside(file, header->hullOffset,  header->hullCount,  2 * sizeof(uint32_t))
+            || header->pointOffset % alignof(glm::vec3) != 0 || !Cooked::inside(file, header->pointOffset, header->pointCount, sizeof(glm::vec3))
+            || !Cooked::inside(file, header->bvhOffset, header->bvhSize, 1)
+            || (kind != ShapeKind::Triangles && (header->maxHulls  != options.maxHulls
+                                              || header->maxPoints != options.maxPoints
+                                              || header->concavity != options.concavity))) return nullptr;
+
+        std::shared_ptr<Holder> holder(new Holder());
+        if (kind != ShapeKind::Triangles)
+        {   auto ranges = file.at<uint32_t>(header->hullOffset);
+            if (header->hullCount == 0) return nullptr;
+            for (uint32_t i = 0; i < header->hullCount; i++)
+                if (ranges[i * 2 + 1] == 0 || uint64_t(ranges[i * 2]) + ranges[i * 2 + 1] > header->pointCount)
+                    return nullptr;
+            assemble(holder->shapes, file.at<glm::vec3>(header->pointOffset), ranges, header->hullCount);
+            return holder;
+        }
+
+        // Triangles Still Need the Mesh, But Not the BVH Build; Pointers in
+        // the Blob are Fixed Up in Place, so it is Copied Out of the Mapping
+        holder->mesh = source(filename, mesh);
+        if (!holder->mesh || header->bvhSize == 0) return nullptr;
+        holder->bvh = btAlignedAlloc(header->bvhSize, 16);
+        std::copy(file.data() + header->bvhOffset, file.data() + header->bvhOffset + header->bvhSize,
+                  static_cast<unsigned char *>(holder->bvh));
+        auto bvh = static_cast<btOptimizedBvh *>(btOptimizedBvh::deSerializeInPlace(holder->bvh, unsigned(header->bvhSize), false));
+        if (!bvh) return nullptr;
+        auto shape = new btBvhTriangleMeshShape(& holder->mesh->triangles(), true, false);
+        shape->setOptimizedBvh(bvh);
+        holder->shapes.push_back(std::unique_ptr<btCollisionShape>(shape));
+        return holder;
+    }
+
+    std::shared_ptr<ShapeCache::Holder> ShapeCache::build(std::string const & filename, Mesh const * model, ShapeKind kind,
+                                                          DecomposeOptions const & options)
+    {
+        auto mesh = source(filename, model);
+        if (!mesh || mesh->size() == 0)
+        {   fprintf(stderr, "%s %s\n", "No Collision Geometry in", filename.c_str());
+            return nullptr;
+        }
+
+        CookedShape::Header header = {};
+        header.magic      = CookedShape::Magic;
+        header.version    = CookedShape::Version;
+        header.kind       = uint32_t(kind);
+        header.maxHulls   = options.maxHulls;
+        header.maxPoints  = options.maxPoints;
+        header.concavity  = options.concavity;
+        header.sourceSize = fileSize(Root + filename);
+        header.sourceTime = fileTime(Root + filename);
+
+        std::shared_ptr<Holder> holder(new Holder());
+        std::vector<uint32_t> ranges;
+        std::vector<glm::vec3> points;
+        std::vector<unsigned char> blob;
+        if (kind == ShapeKind::Triangles)
+        {   // The Shape Keeps its Own BVH; the Cache Gets a Serialized Copy
+            auto shape = new btBvhTriangleMeshShape(& mesh->triangles(), true, true);
+            auto bvh = shape->getOptimizedBvh();
+            void * buffer = btAlignedAlloc(bvh->calculateSerializeBufferSize(), 16);
+            blob.resize(bvh->calculateSerializeBufferSize());
+            bvh->serializeInPlace(buffer, unsigned(blob.size()), false);
+            std::copy(static_cast<unsigned char *>(buffer), static_cast<unsigned char *>(buffer) + blob.size(), blob.begin());
+            btAlignedFree(buffer);
+            holder->mesh = std::move(mesh);
+            holder->shapes.push_back(std::unique_ptr<btCollisionShape>(shape));
+        }
+        else
+        {   // A Single Hull is a Decomposition That May Not Split
+            DecomposeOptions settings = options;
+            if (kind == ShapeKind::Hull) settings.maxHulls = 1;
+            for (auto & hull : decompose(*mesh, settings))
+            {   ranges.push_back(uint32_t(points.size()));
+                ranges.push_back(uint32_t(hull.size()));
+                points.insert(points.end(), hull.begin(), hull.end());
+            }   assemble(holder->shapes, points.data(), ranges.data(), uint32_t(ranges.size() / 2));
+        }
+
+        // Lay Out and Write the Cache; Failing to Write Only Costs the Next Load
+        header.hullCount   = uint32_t(ranges.size() / 2);
+        header.pointCount  = points.size();
+        header.bvhSize     = blob.size();
+        header.hullOffset  = Cooked::align(sizeof(header));
+        header.pointOffset = Cooked::align(header.hullOffset  + ranges.size() * sizeof(uint32_t));
+        header.bvhOffset   = Cooked::align(header.pointOffset + points.size() * sizeof(glm::vec3));
+        std::ofstream fd(cachePath(filename, kind), std::ios::binary);
+        auto write = [& fd](uint64_t offset, void const * data, std::size_t size)
+        {   while (uint64_t(fd.tellp()) < offset) fd.put(0);
+            fd.write((char const *) data, size);
+        };  write(0, & header, sizeof(header));
+        write(header.hullOffset,  ranges.data(), ranges.size() * sizeof(uint32_t));
+        write(header.pointOffset, points.data(), points.size() * sizeof(glm::vec3));
+        write(header.bvhOffset,   blob.data(),   blob.size());
+        return holder;
+    }
+};
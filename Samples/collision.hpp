@@ -0,0 +1,146 @@
+#pragma once
+
+// Local Headers
+#include "cooked.hpp"
+#include "mesh.hpp"
+
+// System Headers
+#include <btBulletDynamicsCommon.h>
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Static Geometry Collides Against its Triangles; Dynamic Bodies Need
+    // Convex Shapes, Either One Hull or an Approximate Decomposition
+    enum class ShapeKind { Triangles, Hull, Decomposed };
+
+    // Approximate Convex Decomposition Settings. The Most Concave Cluster of
+    // Triangles is Cut at the Middle of its Centroids, Along Whichever of the
+    // Three Axes Leaves the Shallowest Halves, Until Every Dent is Within the
+    // Concavity, Measured Against the Whole Mesh's Diagonal. Pairs That Stay
+    // That Shallow Together are Then Merged Back.
+    struct DecomposeOptions {
+        unsigned maxHulls  = 16;
+        unsigned maxPoints = 48;    // Extreme Points Kept per Hull
+        float    concavity = 0.02f;
+    };
+
+    // Collision View of a Model's CPU Geometry. The Triangle Array Points
+    // Straight Into the Vertex and Index Arrays of a Loaded Mesh, Those Import
+    // Produced, or the Mapping of a Cooked File, Reading Positions With the
+    // Vertex Stride, so Nothing is Copied.
+    class CollisionMesh
+    {
+    public:
+
+        // Implement Custom Constructors. A Mesh Must Outlive the Collision
+        // Mesh, and Every Shape Built From it; Sub-Meshes Without CPU Geometry,
+        // Such as Those Read From a Cooked File, are Skipped.
+        CollisionMesh(Mesh const & mesh);
+        CollisionMesh(std::vector<MeshData> && meshes);
+        CollisionMesh(std::unique_ptr<MappedFile> file);
+
+        // Public Member Functions
+        static std::unique_ptr<CollisionMesh> load(std::string const & filename);
+        btTriangleIndexVertexArray & triangles() { return mTriangles; }
+        std::size_t size() const { return mTriangleCount; }
+        template<typename F> void each(F && visit) const
+        {   for (auto & part : mParts)
+            for (std::size_t i = 0; i + 2 < part.indexCount; i += 3)
+                visit(part.vertices[part.indices[i + 0]].position,
+                      part.vertices[part.indices[i + 1]].position,
+                      part.vertices[part.indices[i + 2]].position);
+        }
+
+    private:
+
+        // Disable Copying and Assignment
+        CollisionMesh(CollisionMesh const &) = delete;
+        CollisionMesh & operator=(CollisionMesh const &) = delete;
+
+        // One Sub-Mesh; Indices are Local to its Vertices
+        struct Part {
+            Vertex const * vertices;
+            GLuint const * indices;
+            std::size_t vertexCount, indexCount;
+        };
+
+        // Private Member Functions
+        void add(Mesh const & mesh);
+        void add(Vertex const * vertices, std::size_t vertexCount, GLuint const * indices, std::size_t indexCount);
+
+        // Private Member Containers
+        std::vector<MeshData> mMeshes;
+        std::vector<Part> mParts;
+
+        // Private Member Variables
+        std::unique_ptr<MappedFile> mFile;
+        btTriangleIndexVertexArray mTriangles;
+        std::size_t mTriangleCount;
+
+    };
+
+    // Process-Wide Cache of Collision Shapes Keyed by Model, Kind and Options.
+    // Built Shapes are Written Next to the Model as "<name>.<kind>.shape",
+    // Holding Hull Points or the Triangle BVH, so Later Loads Skip Hull
+    // Building and BVH Construction; the Model's Size and Modified Time, and
+    // the Options, Must Still Match. Shapes Stay Shared While Any Body Holds
+    // Them. Pass the Loaded Mesh When There is One, so a Miss Reads its
+    // Geometry Instead of Importing the Model Again; a Triangle Shape Then
+    // Points Into That Mesh, Which Must Outlive it.
+    //
+    //     auto shape = ShapeCache::get().acquire("crate.obj", crate, ShapeKind::Decomposed);
+    //     btRigidBody::btRigidBodyConstructionInfo info(mass, state, shape.get(), inertia);
+    class ShapeCache
+    {
+    public:
+
+        // Public Member Functions
+        static ShapeCache & get();
+        std::shared_ptr<btCollisionShape> acquire(std::string const & filename, ShapeKind kind,
+                                                  DecomposeOptions const & options = DecomposeOptions());
+        std::shared_ptr<btCollisionShape> acquire(std::string const & filename, Mesh const & mesh, ShapeKind kind,
+                                                  DecomposeOptions const & options = DecomposeOptions());
+
+        // Hit Counts Include Shapes Restored From Disk
+        std::size_t hits() const { return mHits; }
+        std::size_t misses() const { return mMisses; }
+
+    private:
+
+        // Implement Default Constructor
+        ShapeCache() : mHits(0), mMisses(0) {}
+
+        // Everything a Shape Needs to Stay Valid, Released Together
+        struct Holder;
+
+        // Private Member Functions
+        std::shared_ptr<btCollisionShape> acquire(std::string const & filename, Mesh const * mesh, ShapeKind kind,
+                                                  DecomposeOptions const & options);
+        std::shared_ptr<Holder> restore(std::string const & filename, Mesh const * mesh, ShapeKind kind,
+                                        DecomposeOptions const & options);
+        std::shared_ptr<Holder> build(std::string const & filename, Mesh const * mesh, ShapeKind kind,
+                                      DecomposeOptions const & options);
+
+        // Private Member Containers
+        std::map<std::string, std::weak_ptr<btCollisionShape>> mShapes;
+
+        // Private Member Variables
+        std::mutex mMutex;
+        std::size_t mHits;
+        std::size_t mMisses;
+
+    };
+
+    // Approximate Convex Decomposition; Each Hull is a List of Points
+    std::vector<std::vector<glm::vec3>> decompose(CollisionMesh const & mesh, DecomposeOptions const & options);
+};
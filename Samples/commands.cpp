@@ -0,0 +1,124 @@
+// Local Headers
+#include "commands.hpp"
+#include "Profiler.hpp"
+#include "queue.hpp"
+
+// System Headers
+#include <glm/gtc/type_ptr.hpp>
+
+// Standard Headers
+#include <algorithm>
+#include <cstring>
+
+// Define Namespace
+namespace Mirage
+{
+    void CommandBuffer::draw(GLuint program, Material const & material, GLuint vertexArray,
+                             GLsizei count, GLenum type, std::size_t offset, glm::mat4 const & model)
+    {
+        DrawPacket draw = { program, vertexArray, & material, count, type, offset, model };
+        std::memcpy(allocate(RenderQueue::key(program, material.id, vertexArray), CommandOp::Draw, sizeof(draw)),
+                    & draw, sizeof(draw));
+    }
+
+    void * CommandBuffer::allocate(std::uint64_t key, CommandOp op, std::size_t size)
+    {
+        // Packets are Copied in and Out, so Eight-Byte Steps Only Keep Them Tidy
+        std::size_t start = mArena.size();
+        std::size_t padded = (size + 7) & ~std::size_t(7);
+        mArena.resize(start + sizeof(CommandPacket) + padded);
+        CommandPacket packet = { op, std::uint16_t(size), 0 };
+        std::memcpy(& mArena[start], & packet, sizeof(packet));
+        mIndex.push_back(std::make_pair(key, std::uint32_t(start)));
+        return & mArena[start + sizeof(CommandPacket)];
+    }
+
+    void CommandBuffer::sort()
+    {
+        // Offsets Grow With Recording Order, so Equal Keys Keep Their Order
+        std::sort(mIndex.begin(), mIndex.end());
+    }
+
+    CommandQueue::CommandQueue(unsigned int threads) : mCount(0), mVisit(nullptr)
+    {
+        // The Calling Thread Records Too, so it Takes the First Buffer
+        if (threads == 0) threads = JobSystem::get().workers() + 1;
+        mBuffers.resize(threads);
+    }
+
+    std::size_t CommandQueue::size() const
+    {
+        std::size_t total = 0;
+        for (auto & buffer : mBuffers) total += buffer.size();
+        return total;
+    }
+
+    void CommandQueue::record(std::size_t count, std::function<void(CommandBuffer &, std::size_t)> const & visit)
+    {
+        // Shares Map to Buffers, Not Threads, so Whichever Thread Steals a Share
+        // Writes the Same Buffer and Replay Stays Deterministic. The Jobs Only
+        // Capture Two Words so std::function Stores Them Without Allocating.
+        if (count == 0) return;
+        mCount = count; mVisit = & visit;
+        JobCounter recorded;
+        for (unsigned int i = 1; i < mBuffers.size(); i++)
+            JobSystem::get().run([this, i]() { share(i); }, & recorded, "Record");
+        share(0);
+        JobSystem::get().wait(recorded);
+        mVisit = nullptr;
+    }
+
+    void CommandQueue::share(unsigned int index)
+    {
+        PROFILE_SCOPE("Record");
+        std::size_t shares = mBuffers.size();
+        std::size_t begin = mCount * index / shares;
+        std::size_t end   = mCount * (index + 1) / shares;
+        CommandBuffer & buffer = mBuffers[index];
+        for (std::size_t i = begin; i < end; i++) (* mVisit)(buffer, i);
+        buffer.sort();
+    }
+
+    void CommandQueue::submit()
+    {
+        PROFILE_SCOPE("Submit");
+        auto & state = GLState::get();
+        GLuint program = 0; GLint model = -1;
+        mCursors.assign(mBuffers.size(), 0);
+        for (;;)
+        {
+            // Only a Handful of Buffers, so a Linear Scan Finds the Next Packet;
+            // Strict Comparison Lets Earlier Buffers Win Ties
+            std::size_t next = mBuffers.size();
+            for (std::size_t i = 0; i < mBuffers.size(); i++)
+            {   if (mCursors[i] == mBuffers[i].mIndex.size()) continue;
+                if (next == mBuffers.size() || mBuffers[i].mIndex[mCursors[i]].first
+                                             < mBuffers[next].mIndex[mCursors[next]].first) next = i;
+            }   if (next == mBuffers.size()) break;
+
+            CommandBuffer const & buffer = mBuffers[next];
+            unsigned char const * packet = & buffer.mArena[buffer.mIndex[mCursors[next]++].second];
+            CommandPacket header;
+            std::memcpy(& header, packet, sizeof(header));
+            switch (header.op)
+            {
+            case CommandOp::Draw:
+                {   DrawPacket draw;
+                    std::memcpy(& draw, packet + sizeof(CommandPacket), sizeof(draw));
+                    if (draw.program != program)
+                    {   program = draw.program;
+                        state.useProgram(program);
+                        Material::samplers(program);
+                        model = glGetUniformLocation(program, "model");
+                    }
+                    draw.material->bind();
+                    state.bindVertexArray(draw.vertexArray);
+                    if (model != -1) glUniformMatrix4fv(model, 1, GL_FALSE, glm::value_ptr(draw.model));
+                    glDrawElements(GL_TRIANGLES, draw.count, draw.type, (GLvoid *) draw.offset);
+                    Profiler::get().count(ProfileCounter::DrawCalls);
+                    Profiler::get().count(ProfileCounter::Triangles, draw.count / 3);
+                }   break;
+            }
+        }   clear();
+    }
+};
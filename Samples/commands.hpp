@@ -0,0 +1,116 @@
+#pragma once
+
+// Local Headers
+#include "Jobs.hpp"
+#include "mesh.hpp"
+
+// System Headers
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Packet Types; Each is Followed by its Payload in the Arena
+    enum class CommandOp : std::uint16_t { Draw };
+
+    // Fixed-Size Header Ahead of Every Payload
+    struct CommandPacket {
+        CommandOp     op;
+        std::uint16_t size; // Payload Bytes
+        std::uint32_t padding;
+    };
+
+    // Indexed Draw of One Sub-Mesh; Plain Data, Copied With memcpy
+    struct DrawPacket {
+        GLuint           program;
+        GLuint           vertexArray;
+        Material const * material;
+        GLsizei          count;
+        GLenum           type;
+        std::uint64_t    offset;
+        glm::mat4        model;
+    };
+
+    // Packets Recorded by One Thread Into a Linear Arena. The Arena and the
+    // Sort Index Keep Their Capacity Between Frames, so Recording Stops
+    // Allocating Once a Frame's Worth of Packets Has Been Seen. Only Reads
+    // Scene Data and Makes No GL Calls, so Any Thread May Record Into its Own.
+    class CommandBuffer
+    {
+    public:
+
+        // Public Member Functions
+        void draw(GLuint program, Material const & material, GLuint vertexArray,
+                  GLsizei count, GLenum type, std::size_t offset, glm::mat4 const & model);
+        void clear() { mArena.clear(); mIndex.clear(); }
+        std::size_t size() const { return mIndex.size(); }
+        std::size_t bytes() const { return mArena.size(); }
+
+    private:
+
+        // A Frame's Merge Reads the Buffers Directly
+        friend class CommandQueue;
+
+        // Private Member Functions
+        void * allocate(std::uint64_t key, CommandOp op, std::size_t size);
+        void sort();
+
+        // Private Member Containers
+        std::vector<unsigned char> mArena;
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> mIndex; // Key, Packet Offset
+
+    };
+
+    // Builds a Frame Across Threads and Submits it From the GL Thread. A Call
+    // to record() Splits the Items Into One Contiguous Share per Buffer; the
+    // Caller Records the First Share and JobSystem Workers Record the Rest,
+    // Each Sorting its Own Buffer by RenderQueue::key. submit() Then Merges
+    // the Sorted Buffers and Replays the Packets in Key Order, Breaking Ties
+    // by Buffer and Recording Order so Every Frame Replays the Same Way.
+    //
+    //     CommandQueue queue;
+    //     queue.record(objects.size(), [&](CommandBuffer & buffer, std::size_t i)
+    //     {   objects[i].mesh->draw(buffer, shader, objects[i].model); });
+    //     queue.submit();
+    //
+    // Materials and Vertex Arrays are Referenced, so Meshes Must Outlive submit().
+    class CommandQueue
+    {
+    public:
+
+        // Implement Custom Constructor; Defaults to One Share per Pool Thread
+        CommandQueue(unsigned int threads = 0);
+
+        // Public Member Functions
+        void record(std::size_t count, std::function<void(CommandBuffer &, std::size_t)> const & visit);
+        void submit();
+        void clear() { for (auto & buffer : mBuffers) buffer.clear(); }
+        std::size_t size() const;
+        unsigned int threads() const { return unsigned(mBuffers.size()); }
+
+    private:
+
+        // Disable Copying and Assignment
+        CommandQueue(CommandQueue const &) = delete;
+        CommandQueue & operator=(CommandQueue const &) = delete;
+
+        // Private Member Functions
+        void share(unsigned int index);
+
+        // Private Member Containers
+        std::vector<CommandBuffer> mBuffers; // One per Share, Caller's First
+        std::vector<std::size_t> mCursors;
+
+        // Private Member Variables; Only Set During record()
+        std::size_t mCount;
+        std::function<void(CommandBuffer &, std::size_t)> const * mVisit;
+
+    };
+};
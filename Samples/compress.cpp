@@ -0,0 +1,329 @@
+// Local Headers
+#include "compress.hpp"
+#include "Extensions.hpp"
+#include "Jobs.hpp"
+
+// Standard Headers
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+// Define Namespace
+namespace Mirage
+{
+    static BlockInfo const Formats[] = {
+        { BlockFormat::BC1, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,  131,  8, 3 },
+        { BlockFormat::BC3, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 137, 16, 4 },
+        { BlockFormat::BC4, GL_COMPRESSED_RED_RGTC1,          139,  8, 1 },
+        { BlockFormat::BC5, GL_COMPRESSED_RG_RGTC2,           141, 16, 2 },
+        { BlockFormat::BC7, GL_COMPRESSED_RGBA_BPTC_UNORM,    145, 16, 4 },
+    };
+
+    BlockInfo const & blockInfo(BlockFormat format)
+    {
+        return Formats[int(format)];
+    }
+
+    BlockInfo const * blockInfo(uint32_t vkFormat)
+    {
+        for (auto & info : Formats) if (info.vkFormat == vkFormat) return & info;
+        return nullptr;
+    }
+
+    BlockFormat pickFormat(int channels, CompressOptions const & options)
+    {
+        switch (channels)
+        {
+            case 1  : return BlockFormat::BC4;
+            case 2  : return BlockFormat::BC5;
+            case 3  : return options.bc7 ? BlockFormat::BC7 : BlockFormat::BC1;
+            default : return options.bc7 ? BlockFormat::BC7 : BlockFormat::BC3;
+        }
+    }
+
+    bool blockSupported(BlockFormat format)
+    {
+        // RGTC is Core Since 3.0 and BPTC Since 4.2; S3TC Was Never Made Core
+        switch (format)
+        {
+            case BlockFormat::BC1 :
+            case BlockFormat::BC3 : return hasExtension("GL_EXT_texture_compression_s3tc");
+            case BlockFormat::BC7 : return GLAD_GL_VERSION_4_2 || hasExtension("GL_ARB_texture_compression_bptc");
+            default               : return true;
+        }
+    }
+
+    std::size_t compressedSize(int width, int height, BlockFormat format)
+    {
+        return std::size_t((width + 3) / 4) * ((height + 3) / 4) * blockInfo(format).bytes;
+    }
+
+    // One 4x4 Block Expanded to RGBA, Clamped at the Image Edges
+    static void fetch(unsigned char const * pixels, int width, int height, int channels,
+                      int column, int row, unsigned char block[16][4])
+    {
+        for (int y = 0; y < 4; y++)
+        for (int x = 0; x < 4; x++)
+        {   unsigned char const * texel = pixels + (std::size_t(std::min(row * 4 + y, height - 1)) * width
+                                                    + std::min(column * 4 + x, width - 1)) * channels;
+            unsigned char * out = block[y * 4 + x];
+            out[0] = texel[0];
+            out[1] = channels > 1 ? texel[1] : 0;
+            out[2] = channels > 2 ? texel[2] : 0;
+            out[3] = channels > 3 ? texel[3] : 255;
+        }
+    }
+
+    // Mean and Dominant Direction of the Block's First n Channels, by Power
+    // Iteration on Their Covariance; a Flat Block Keeps the Diagonal
+    static void principal(unsigned char const block[16][4], int n, float mean[4], float axis[4])
+    {
+        float covariance[4][4] = {};
+        for (int c = 0; c < n; c++)
+        {   mean[c] = 0.0f;
+            for (int p = 0; p < 16; p++) mean[c] += block[p][c] / 16.0f;
+        }
+        for (int p = 0; p < 16; p++)
+        for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            covariance[i][j] += (block[p][i] - mean[i]) * (block[p][j] - mean[j]);
+        for (int c = 0; c < n; c++) axis[c] = 1.0f;
+        for (int iteration = 0; iteration < 8; iteration++)
+        {   float next[4] = {}, largest = 0.0f;
+            for (int i = 0; i < n; i++)
+            {   for (int j = 0; j < n; j++) next[i] += covariance[i][j] * axis[j];
+                largest = std::max(largest, std::fabs(next[i]));
+            }
+            if (largest < 1e-6f) break;
+            for (int c = 0; c < n; c++) axis[c] = next[c] / largest;
+        }
+        float length = 0.0f;
+        for (int c = 0; c < n; c++) length += axis[c] * axis[c];
+        for (int c = 0; c < n; c++) axis[c] /= std::sqrt(length);
+    }
+
+    // Endpoints Where the Block's Projections Onto the Axis End
+    static void extremes(unsigned char const block[16][4], int n, float first[4], float last[4])
+    {
+        float mean[4], axis[4], low = 0.0f, high = 0.0f;
+        principal(block, n, mean, axis);
+        for (int p = 0; p < 16; p++)
+        {   float t = 0.0f;
+            for (int c = 0; c < n; c++) t += (block[p][c] - mean[c]) * axis[c];
+            low = std::min(low, t); high = std::max(high, t);
+        }
+        for (int c = 0; c < n; c++)
+        {   first[c] = mean[c] + axis[c] * high;
+            last[c]  = mean[c] + axis[c] * low;
+        }
+    }
+
+    static int quantize(float value, int levels)
+    {
+        return std::min(std::max(int(std::lround(value * levels / 255.0f)), 0), levels);
+    }
+
+    static uint16_t pack565(float const colour[3])
+    {
+        return uint16_t(quantize(colour[0], 31) << 11 | quantize(colour[1], 63) << 5 | quantize(colour[2], 31));
+    }
+
+    static void unpack565(uint16_t packed, int colour[3])
+    {
+        int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+        colour[0] = r << 3 | r >> 2;
+        colour[1] = g << 2 | g >> 4;
+        colour[2] = b << 3 | b >> 2;
+    }
+
+    // Nearest of the Four Interpolated Colours per Texel, Texel 0 in the Low
+    // Bits; Returns the Summed Squared Error
+    static int select565(unsigned char const block[16][4], uint16_t first, uint16_t last, uint32_t & indices)
+    {
+        int palette[4][3];
+        unpack565(first, palette[0]);
+        unpack565(last,  palette[1]);
+        for (int c = 0; c < 3; c++)
+        {   palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        int error = 0;
+        indices = 0;
+        for (int p = 15; p >= 0; p--)
+        {   int best = 0, nearest = INT_MAX;
+            for (int i = 0; i < 4; i++)
+            {   int distance = 0;
+                for (int c = 0; c < 3; c++) distance += (block[p][c] - palette[i][c]) * (block[p][c] - palette[i][c]);
+                if (distance < nearest) { nearest = distance; best = i; }
+            }   indices = indices << 2 | uint32_t(best);
+            error += nearest;
+        }   return error;
+    }
+
+    static void put(unsigned char * out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++) out[i] = (unsigned char) (value >> (8 * i));
+    }
+
+    // BC1 Colour Block. The First Endpoint is Kept Larger, Which Selects the
+    // Four Colour Mode; Equal Endpoints Leave Every Index at Zero.
+    static void colour(unsigned char const block[16][4], unsigned char * out)
+    {
+        float first[4], last[4];
+        extremes(block, 3, first, last);
+        uint16_t e0 = pack565(first), e1 = pack565(last);
+        if (e0 < e1) std::swap(e0, e1);
+        uint32_t indices;
+        int error = select565(block, e0, e1, indices);
+
+        // One Least-Squares Pass Fits the Endpoints to the Chosen Indices
+        static float const weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[3] = {}, bx[3] = {};
+        for (int p = 0; p < 16; p++)
+        {   float a = weights[indices >> (2 * p) & 3], b = 1.0f - a;
+            aa += a * a; ab += a * b; bb += b * b;
+            for (int c = 0; c < 3; c++) { ax[c] += a * block[p][c]; bx[c] += b * block[p][c]; }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-3f)
+        {   for (int c = 0; c < 3; c++)
+            {   first[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+                last[c]  = (aa * bx[c] - ab * ax[c]) / determinant;
+            }
+            uint16_t f0 = pack565(first), f1 = pack565(last);
+            if (f0 < f1) std::swap(f0, f1);
+            uint32_t refined;
+            if (select565(block, f0, f1, refined) < error) { e0 = f0; e1 = f1; indices = refined; }
+        }
+        put(out, e0, 2);
+        put(out + 2, e1, 2);
+        put(out + 4, indices, 4);
+    }
+
+    // BC4 Block of One Channel, in the Eight Value Mode: Index 0 is the Top,
+    // 1 the Bottom, and 2 to 7 Step Down From the Top in Sevenths
+    static void single(unsigned char const block[16][4], int channel, unsigned char * out)
+    {
+        int low = 255, high = 0;
+        for (int p = 0; p < 16; p++)
+        {   low  = std::min(low,  int(block[p][channel]));
+            high = std::max(high, int(block[p][channel]));
+        }
+        uint64_t indices = 0;
+        if (high > low)
+        for (int p = 15; p >= 0; p--)
+        {   int step  = ((block[p][channel] - low) * 14 + (high - low)) / (2 * (high - low));
+            int index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+            indices = indices << 3 | uint64_t(index);
+        }
+        out[0] = (unsigned char) high;
+        out[1] = (unsigned char) low;
+        put(out + 2, indices, 6);
+    }
+
+    // Writes Fields Least Significant Bit First, as BC7 Lays Them Out
+    struct BitWriter {
+        unsigned char * out;
+        unsigned position;
+        void write(uint32_t value, unsigned count)
+        {   for (unsigned i = 0; i < count; i++, position++)
+                if (value >> i & 1) out[position >> 3] |= (unsigned char) (1 << (position & 7));
+        }
+    };
+
+    // Seven Bits per Channel Plus a Low Bit Shared by the Whole Endpoint,
+    // Whichever Lands Closer
+    static void endpoint(float const value[4], int out[4])
+    {
+        int best = INT_MAX;
+        for (int bit = 0; bit < 2; bit++)
+        {   int candidate[4], error = 0;
+            for (int c = 0; c < 4; c++)
+            {   int high = std::min(std::max(int(std::lround((value[c] - bit) / 2.0f)), 0), 127);
+                candidate[c] = high << 1 | bit;
+                error += int((candidate[c] - value[c]) * (candidate[c] - value[c]));
+            }
+            if (error < best) { best = error; std::copy(candidate, candidate + 4, out); }
+        }
+    }
+
+    // BC7 Mode 6: One RGBA Line Through the Block With Sixteen Steps. Mode 6
+    // Alone Beats BC1 and BC3 on Most Content; the Partitioned Modes are Left Out.
+    static void bptc(unsigned char const block[16][4], unsigned char * out)
+    {
+        static int const weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        float first[4], last[4];
+        int e0[4], e1[4], palette[16][4], indices[16];
+        extremes(block, 4, first, last);
+        endpoint(first, e0);
+        endpoint(last,  e1);
+        for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            palette[i][c] = ((64 - weights[i]) * e0[c] + weights[i] * e1[c] + 32) >> 6;
+        for (int p = 0; p < 16; p++)
+        {   int nearest = INT_MAX;
+            for (int i = 0; i < 16; i++)
+            {   int distance = 0;
+                for (int c = 0; c < 4; c++) distance += (block[p][c] - palette[i][c]) * (block[p][c] - palette[i][c]);
+                if (distance < nearest) { nearest = distance; indices[p] = i; }
+            }
+        }
+
+        // The First Index is Stored Without its Top Bit, Which Must be Zero
+        if (indices[0] & 8)
+        {   std::swap(e0, e1);
+            for (auto & index : indices) index = 15 - index;
+        }
+        std::memset(out, 0, 16);
+        BitWriter bits = { out, 0 };
+        bits.write(1 << 6, 7);
+        for (int c = 0; c < 4; c++) { bits.write(uint32_t(e0[c] >> 1), 7); bits.write(uint32_t(e1[c] >> 1), 7); }
+        bits.write(uint32_t(e0[0] & 1), 1);
+        bits.write(uint32_t(e1[0] & 1), 1);
+        bits.write(uint32_t(indices[0]), 3);
+        for (int p = 1; p < 16; p++) bits.write(uint32_t(indices[p]), 4);
+    }
+
+    std::vector<unsigned char> compress(unsigned char const * pixels, int width, int height,
+                                        int channels, BlockFormat format)
+    {
+        std::size_t const size = blockInfo(format).bytes;
+        std::size_t const columns = std::size_t(width + 3) / 4, rows = std::size_t(height + 3) / 4;
+        std::vector<unsigned char> blocks(columns * rows * size);
+        JobSystem::get().parallelFor(0, rows, 4, [&](std::size_t begin, std::size_t end)
+        {   unsigned char texels[16][4];
+            for (std::size_t row = begin; row < end; row++)
+            for (std::size_t column = 0; column < columns; column++)
+            {   fetch(pixels, width, height, channels, int(column), int(row), texels);
+                unsigned char * out = & blocks[(row * columns + column) * size];
+                switch (format)
+                {
+                    case BlockFormat::BC1 : colour(texels, out); break;
+                    case BlockFormat::BC3 : single(texels, 3, out); colour(texels, out + 8); break;
+                    case BlockFormat::BC4 : single(texels, 0, out); break;
+                    case BlockFormat::BC5 : single(texels, 0, out); single(texels, 1, out + 8); break;
+                    case BlockFormat::BC7 : bptc(texels, out); break;
+                }
+            }
+        });
+        return blocks;
+    }
+
+    void downsample(unsigned char const * pixels, int width, int height, int channels,
+                    std::vector<unsigned char> & target)
+    {
+        int w = std::max(width >> 1, 1), h = std::max(height >> 1, 1);
+        target.resize(std::size_t(w) * h * channels);
+        unsigned char * out = target.data();
+        for (int y = 0; y < h; y++)
+        {   unsigned char const * row0 = pixels + std::size_t(std::min(2 * y,     height - 1)) * width * channels;
+            unsigned char const * row1 = pixels + std::size_t(std::min(2 * y + 1, height - 1)) * width * channels;
+            for (int x = 0; x < w; x++)
+            {   int x0 = std::min(2 * x, width - 1) * channels, x1 = std::min(2 * x + 1, width - 1) * channels;
+                for (int c = 0; c < channels; c++)
+                    * out++ = (unsigned char) ((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+};
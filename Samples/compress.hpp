@@ -0,0 +1,60 @@
+#pragma once
+
+// System Headers
+#include <glad/glad.h>
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Block-Compressed Formats; Every One Stores 4x4 Texel Blocks
+    enum class BlockFormat {
+        BC1, // RGB, 8 Bytes per Block
+        BC3, // RGBA, BC1 Colour Plus a BC4 Alpha Block, 16 Bytes
+        BC4, // One Channel, 8 Bytes
+        BC5, // Two Channels, Two BC4 Blocks, 16 Bytes
+        BC7, // RGB or RGBA, 16 Bytes; Encoded in Mode 6 Only
+    };
+
+    // How Cooked Textures are Compressed. BC7 Holds Colour Gradients Far
+    // Better Than BC1 and BC3, but Needs GL 4.2 or ARB_texture_compression_bptc
+    // and Spends Twice the Memory of BC1 on Images Without Alpha.
+    struct CompressOptions {
+        bool enabled = true;  // Whether Mesh::cook() Cooks a Model's Textures
+        bool bc7     = false;
+        bool mipmaps = true;
+    };
+
+    // Sizes and Tokens of One Block Format: the GL Internal Format, the Vulkan
+    // Format KTX2 Files Name it By, and the Channels it Decodes To
+    struct BlockInfo {
+        BlockFormat format;
+        GLenum      internal;
+        uint32_t    vkFormat;
+        std::size_t bytes;
+        int         channels;
+    };
+
+    BlockInfo const & blockInfo(BlockFormat format);
+    BlockInfo const * blockInfo(uint32_t vkFormat); // Null for Unknown Formats
+    BlockFormat pickFormat(int channels, CompressOptions const & options);
+
+    // Whether the Current Context Can Sample the Format; GL Thread Only
+    bool blockSupported(BlockFormat format);
+
+    // Compress an Image Whose Rows are Tightly Packed. Partial Blocks at the
+    // Right and Bottom Edges Repeat the Last Column and Row. Rows of Blocks
+    // are Spread Across the JobSystem's Workers.
+    std::vector<unsigned char> compress(unsigned char const * pixels, int width, int height,
+                                        int channels, BlockFormat format);
+    std::size_t compressedSize(int width, int height, BlockFormat format);
+
+    // Build the Next Mip Level With a 2x2 Box Filter; an Odd Last Row or
+    // Column is Averaged With Itself
+    void downsample(unsigned char const * pixels, int width, int height, int channels,
+                    std::vector<unsigned char> & target);
+};
@@ -0,0 +1,87 @@
+// Local Headers
+#include "cooked.hpp"
+#include "vertex.hpp"
+
+// System Headers
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Define Namespace
+namespace Mirage
+{
+    MappedFile::MappedFile(std::string const & filename)
+        : mData(nullptr), mSize(0), mHandle(nullptr)
+    {
+    #ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size; GetFileSizeEx(file, & size);
+        mHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mHandle) return;
+        mData = (unsigned char const *) MapViewOfFile(mHandle, FILE_MAP_READ, 0, 0, 0);
+        if (mData) mSize = std::size_t(size.QuadPart);
+    #else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info;
+        if (fstat(fd, & info) == 0 && info.st_size > 0)
+        {   void * data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {   mData = (unsigned char const *) data;
+                mSize = std::size_t(info.st_size);
+                madvise(data, mSize, MADV_SEQUENTIAL);
+            }
+        }   close(fd);
+    #endif
+    }
+
+    MappedFile::~MappedFile()
+    {
+    #ifdef _WIN32
+        if (mData) UnmapViewOfFile(mData);
+        if (mHandle) CloseHandle(mHandle);
+    #else
+        if (mData) munmap((void *) mData, mSize);
+    #endif
+    }
+
+    bool Cooked::validate(MappedFile const & file)
+    {
+        auto header = file.at<Header>(0);
+        if (!file.data() || file.size() < sizeof(Header)
+            || header->magic        != Magic
+            || header->version      != Version
+            || header->vertexStride != sizeof(Vertex)
+            || header->indexSize    != sizeof(GLuint)
+            || header->vertexOffset  % alignof(Vertex)  != 0 || !inside(file, header->vertexOffset,  header->vertexCount,  sizeof(Vertex))
+            || header->indexOffset   % alignof(GLuint)  != 0 || !inside(file, header->indexOffset,   header->indexCount,   sizeof(GLuint))
+            || header->subMeshOffset % alignof(SubMesh) != 0 || !inside(file, header->subMeshOffset, header->subMeshCount, sizeof(SubMesh))
+            || header->textureOffset % alignof(Texture) != 0 || !inside(file, header->textureOffset, header->textureCount, sizeof(Texture))
+            || !inside(file, header->stringOffset, header->stringSize, 1)) return false;
+
+        // Ranges are Summed in 64 Bits so Large Counts Cannot Wrap Around
+        auto ranges   = file.at<SubMesh>(header->subMeshOffset);
+        auto textures = file.at<Texture>(header->textureOffset);
+        auto indices  = file.at<GLuint>(header->indexOffset);
+        for (uint32_t i = 0; i < header->subMeshCount; i++)
+        {   SubMesh const & range = ranges[i];
+            if (uint64_t(range.firstVertex)  + range.vertexCount  > header->vertexCount
+             || uint64_t(range.firstIndex)   + range.indexCount   > header->indexCount
+             || uint64_t(range.firstTexture) + range.textureCount > header->textureCount) return false;
+            for (uint32_t j = 0; j < range.indexCount; j++)
+                if (indices[range.firstIndex + j] >= range.vertexCount) return false;
+            for (uint32_t j = 0; j < range.textureCount; j++)
+            {   Texture const & texture = textures[range.firstTexture + j];
+                if (uint64_t(texture.nameOffset) + texture.nameLength > header->stringSize) return false;
+            }
+        }   return true;
+    }
+};
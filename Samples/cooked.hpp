@@ -0,0 +1,91 @@
+#pragma once
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Define Namespace
+namespace Mirage
+{
+    // Cooked Mesh Format. Every Section Starts on a 64 Byte Boundary so the
+    // Mapped File can be Handed Straight to glBufferData.
+    //
+    //     Header | Vertices (Interleaved Vertex) | Indices (GLuint, Local to
+    //     Each Sub-Mesh) | Sub-Mesh Ranges | Texture References | Strings
+    namespace Cooked
+    {
+        const uint32_t Magic     = 0x4853454D; // "MESH"
+        const uint32_t Version   = 1;
+        const uint32_t Alignment = 64;
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t vertexStride;
+            uint32_t indexSize;
+            uint32_t subMeshCount;
+            uint32_t textureCount;
+            uint64_t vertexOffset, vertexCount;
+            uint64_t indexOffset,  indexCount;
+            uint64_t subMeshOffset;
+            uint64_t textureOffset;
+            uint64_t stringOffset, stringSize;
+        };
+
+        struct SubMesh {
+            uint32_t firstVertex, vertexCount;
+            uint32_t firstIndex,  indexCount;
+            uint32_t firstTexture, textureCount;
+        };
+
+        struct Texture {
+            uint32_t nameOffset, nameLength; // Relative to the Model Directory
+            uint32_t mode;                   // 0 = Diffuse, 1 = Specular
+            uint32_t reserved;
+        };
+
+        inline uint64_t align(uint64_t offset)
+        { return (offset + Alignment - 1) / Alignment * Alignment; }
+    };
+
+    // Read-Only Memory Mapped File
+    class MappedFile
+    {
+    public:
+
+        // Implement Custom Constructor and Destructor
+        MappedFile(std::string const & filename);
+        ~MappedFile();
+
+        // Public Member Functions
+        unsigned char const * data() const { return mData; }
+        std::size_t size() const { return mSize; }
+        template<typename T> T const * at(uint64_t offset) const
+        { return reinterpret_cast<T const *>(mData + offset); }
+
+    private:
+
+        // Disable Copying and Assignment
+        MappedFile(MappedFile const &) = delete;
+        MappedFile & operator=(MappedFile const &) = delete;
+
+        // Private Member Variables
+        unsigned char const * mData;
+        std::size_t mSize;
+        void * mHandle;
+
+    };
+
+    namespace Cooked
+    {
+        // Whether count Items of size Bytes at offset Lie Inside the File,
+        // Checked Without Overflowing
+        inline bool inside(MappedFile const & file, uint64_t offset, uint64_t count, uint64_t size)
+        { return offset <= file.size() && count <= (file.size() - offset) / size; }
+
+        // Check the Header, Every Section, Sub-Mesh and Texture Range, and
+        // Every Index Against the Mapping Before Anything Reads Through Them
+        bool validate(MappedFile const & file);
+    };
+};
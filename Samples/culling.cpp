@@ -0,0 +1,257 @@
+// Local Headers
+#include "culling.hpp"
+#include "Profiler.hpp"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+
+// Four Boxes per Plane Test Where SSE is Available
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MIRAGE_SSE
+#include <xmmintrin.h>
+#endif
+
+// Define Namespace
+namespace Mirage
+{
+    static std::uint32_t const None = ~0u;
+
+    Frustum::Frustum(glm::mat4 const & m)
+    {
+        // Gribb and Hartmann: Add or Subtract the Fourth Row From the Others
+        for (int i = 0; i < 3; i++)
+        {   glm::vec4 row (m[0][i], m[1][i], m[2][i], m[3][i]);
+            glm::vec4 last(m[0][3], m[1][3], m[2][3], m[3][3]);
+            planes[i * 2    ] = last + row;
+            planes[i * 2 + 1] = last - row;
+        }
+        for (auto & plane : planes)
+            plane = plane * (1.0f / glm::length(glm::vec3(plane)));
+    }
+
+    bool Frustum::visible(glm::vec4 const & sphere) const
+    {
+        for (auto & plane : planes)
+            if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) return false;
+        return true;
+    }
+
+    // Whether Any Part of the Box May Lie Inside
+    static bool intersects(Frustum const & frustum, Bounds const & bounds)
+    {
+        for (auto & plane : frustum.planes)
+        {   glm::vec3 far(plane.x > 0.0f ? bounds.max.x : bounds.min.x,
+                          plane.y > 0.0f ? bounds.max.y : bounds.min.y,
+                          plane.z > 0.0f ? bounds.max.z : bounds.min.z);
+            if (glm::dot(glm::vec3(plane), far) + plane.w < 0.0f) return false;
+        }   return true;
+    }
+
+    Bvh::Handle Bvh::insert(Bounds const & bounds, std::uint32_t value)
+    {
+        Item item = { bounds, value, None, true };
+        Handle handle = Handle(mItems.size());
+        if (mFree.empty()) mItems.push_back(item);
+        else { handle = mFree.back(); mFree.pop_back(); mItems[handle] = item; }
+        mLive++;
+        mRebuild = true;
+        return handle;
+    }
+
+    void Bvh::move(Handle handle, Bounds const & bounds)
+    {
+        mItems[handle].bounds = bounds;
+        if (!mRebuild) mMoved.push_back(handle);
+    }
+
+    void Bvh::remove(Handle handle)
+    {
+        if (!mItems[handle].live) return;
+        mItems[handle].live = false;
+        mFree.push_back(handle);
+        mLive--;
+        mRebuild = true;
+    }
+
+    void Bvh::build()
+    {
+        mOrder.clear();
+        for (Handle i = 0; i < mItems.size(); i++)
+            if (mItems[i].live) mOrder.push_back(i);
+        mNodes.clear();
+        mMoved.clear();
+        mRebuild = false;
+        if (!mOrder.empty()) subdivide(0, std::uint32_t(mOrder.size()), None);
+    }
+
+    std::int32_t Bvh::subdivide(std::uint32_t first, std::uint32_t last, std::uint32_t parent)
+    {
+        // Halve a Range at the Median Centroid Along its Widest Axis
+        auto split = [this](std::uint32_t begin, std::uint32_t end)
+        {   Bounds centroids;
+            for (std::uint32_t i = begin; i < end; i++) centroids.add(mItems[mOrder[i]].bounds.center());
+            glm::vec3 extent = centroids.max - centroids.min;
+            int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+            std::uint32_t middle = (begin + end) / 2;
+            std::nth_element(mOrder.begin() + begin, mOrder.begin() + middle, mOrder.begin() + end,
+                [this, axis](Handle a, Handle b) { return mItems[a].bounds.center()[axis] < mItems[b].bounds.center()[axis]; });
+            return middle;
+        };
+
+        // Up to Four Parts: Halves, Then Quarters Where a Half is Too Big for a Leaf
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> parts;
+        if (last - first <= LeafSize) parts.push_back(std::make_pair(first, last));
+        else
+        {   std::uint32_t middle = split(first, last);
+            std::pair<std::uint32_t, std::uint32_t> const halves[] = { std::make_pair(first, middle), std::make_pair(middle, last) };
+            for (auto & half : halves)
+            {   if (half.second - half.first <= LeafSize) { parts.push_back(half); continue; }
+                std::uint32_t quarter = split(half.first, half.second);
+                parts.push_back(std::make_pair(half.first, quarter));
+                parts.push_back(std::make_pair(quarter, half.second));
+            }
+        }
+
+        // Children are Appended After Their Parent, so Indices Only Grow Downwards
+        std::uint32_t index = std::uint32_t(mNodes.size());
+        mNodes.push_back(Node());
+        mNodes[index].parent = parent;
+        for (unsigned k = 0; k < 4; k++)
+        {   mNodes[index].child[k] = -1;
+            mNodes[index].count[k] = 0;
+            assign(mNodes[index], k, Bounds());
+        }
+        for (unsigned k = 0; k < parts.size(); k++)
+        {   std::uint32_t begin = parts[k].first, count = parts[k].second - parts[k].first;
+            if (count <= LeafSize)
+            {   for (std::uint32_t i = begin; i < begin + count; i++) mItems[mOrder[i]].node = index;
+                mNodes[index].child[k] = ~std::int32_t(begin);
+                mNodes[index].count[k] = count;
+            }   else
+            {   std::int32_t child = subdivide(begin, begin + count, index); // May Reallocate mNodes
+                mNodes[index].child[k] = child;
+            }
+            assign(mNodes[index], k, slot(mNodes[index], k));
+        }   return std::int32_t(index);
+    }
+
+    void Bvh::refit()
+    {
+        if (mRebuild) { build(); return; }
+        if (mMoved.empty()) return;
+
+        // Flag Every Node Between a Moved Item and the Root
+        mDirty.assign(mNodes.size(), false);
+        for (Handle handle : mMoved)
+        for (std::uint32_t n = mItems[handle].node; n != None && !mDirty[n]; n = mNodes[n].parent)
+            mDirty[n] = true;
+        mMoved.clear();
+
+        // Children Follow Parents in the Array, so Walking Backwards Refits Bottom-Up
+        for (std::size_t n = mNodes.size(); n-- > 0;)
+        {   if (!mDirty[n]) continue;
+            for (unsigned k = 0; k < 4; k++) assign(mNodes[n], k, slot(mNodes[n], k));
+        }
+    }
+
+    void Bvh::assign(Node & node, unsigned k, Bounds const & bounds)
+    {
+        node.minX[k] = bounds.min.x; node.minY[k] = bounds.min.y; node.minZ[k] = bounds.min.z;
+        node.maxX[k] = bounds.max.x; node.maxY[k] = bounds.max.y; node.maxZ[k] = bounds.max.z;
+    }
+
+    Bounds Bvh::slot(Node const & node, unsigned k) const
+    {
+        if (node.child[k] < 0) return leaf(std::uint32_t(~node.child[k]), node.count[k]);
+        Bounds bounds; Node const & child = mNodes[node.child[k]];
+        for (unsigned i = 0; i < 4; i++)
+        {   if (child.child[i] < 0 && child.count[i] == 0) continue;
+            bounds.add(glm::vec3(child.minX[i], child.minY[i], child.minZ[i]));
+            bounds.add(glm::vec3(child.maxX[i], child.maxY[i], child.maxZ[i]));
+        }   return bounds;
+    }
+
+    Bounds Bvh::leaf(std::uint32_t first, std::uint32_t count) const
+    {
+        Bounds bounds;
+        for (std::uint32_t i = first; i < first + count; i++) bounds.add(mItems[mOrder[i]].bounds);
+        return bounds;
+    }
+
+    void Bvh::classify(Node const & node, Frustum const & frustum, int & outside, int & inside)
+    {
+#ifdef MIRAGE_SSE
+        // A Box is Outside if its Farthest Corner Along Any Plane Normal is
+        // Behind it, and Inside if its Nearest Corner is in Front of All Six
+        __m128 const minX = _mm_loadu_ps(node.minX), maxX = _mm_loadu_ps(node.maxX);
+        __m128 const minY = _mm_loadu_ps(node.minY), maxY = _mm_loadu_ps(node.maxY);
+        __m128 const minZ = _mm_loadu_ps(node.minZ), maxZ = _mm_loadu_ps(node.maxZ);
+        __m128 const zero = _mm_setzero_ps();
+        __m128 out = zero, in = _mm_cmpeq_ps(zero, zero);
+        for (auto & plane : frustum.planes)
+        {   __m128 px = _mm_set1_ps(plane.x), py = _mm_set1_ps(plane.y);
+            __m128 pz = _mm_set1_ps(plane.z), pw = _mm_set1_ps(plane.w);
+            __m128 far  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, plane.x > 0.0f ? maxX : minX),
+                                                _mm_mul_ps(py, plane.y > 0.0f ? maxY : minY)),
+                                     _mm_add_ps(_mm_mul_ps(pz, plane.z > 0.0f ? maxZ : minZ), pw));
+            __m128 near = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, plane.x > 0.0f ? minX : maxX),
+                                                _mm_mul_ps(py, plane.y > 0.0f ? minY : maxY)),
+                                     _mm_add_ps(_mm_mul_ps(pz, plane.z > 0.0f ? minZ : maxZ), pw));
+            out = _mm_or_ps (out, _mm_cmplt_ps(far,  zero));
+            in  = _mm_and_ps(in,  _mm_cmpge_ps(near, zero));
+        }
+        outside = _mm_movemask_ps(out);
+        inside  = _mm_movemask_ps(in);
+#else
+        outside = 0; inside = 15;
+        for (unsigned k = 0; k < 4; k++)
+        for (auto & plane : frustum.planes)
+        {   float far  = plane.x * (plane.x > 0.0f ? node.maxX[k] : node.minX[k])
+                       + plane.y * (plane.y > 0.0f ? node.maxY[k] : node.minY[k])
+                       + plane.z * (plane.z > 0.0f ? node.maxZ[k] : node.minZ[k]) + plane.w;
+            float near = plane.x * (plane.x > 0.0f ? node.minX[k] : node.maxX[k])
+                       + plane.y * (plane.y > 0.0f ? node.minY[k] : node.maxY[k])
+                       + plane.z * (plane.z > 0.0f ? node.minZ[k] : node.maxZ[k]) + plane.w;
+            if (far  <  0.0f) outside |=  (1 << k);
+            if (near <  0.0f) inside  &= ~(1 << k);
+        }
+#endif
+    }
+
+    void Bvh::cull(Frustum const & frustum, std::vector<std::uint32_t> & visible)
+    {
+        PROFILE_SCOPE("Cull");
+        refit();
+        visible.clear();
+        if (mNodes.empty()) return;
+
+        mStack.assign(1, 0);
+        while (!mStack.empty())
+        {   Node const & node = mNodes[mStack.back()];
+            mStack.pop_back();
+            int outside, inside;
+            classify(node, frustum, outside, inside);
+            for (unsigned k = 0; k < 4; k++)
+            {   std::int32_t child = node.child[k];
+                if ((child < 0 && node.count[k] == 0) || (outside & (1 << k))) continue;
+                if (inside & (1 << k)) collect(child, node.count[k], visible);
+                else if (child >= 0) mStack.push_back(child);
+                else for (std::uint32_t i = ~child; i < ~child + node.count[k]; i++)
+                    if (intersects(frustum, mItems[mOrder[i]].bounds)) visible.push_back(mItems[mOrder[i]].value);
+            }
+        }
+    }
+
+    void Bvh::collect(std::int32_t child, std::uint32_t count, std::vector<std::uint32_t> & visible) const
+    {
+        // Whole Subtree is Inside; Skip the Tests
+        if (child < 0)
+        {   for (std::uint32_t i = ~child; i < ~child + count; i++) visible.push_back(mItems[mOrder[i]].value);
+            return;
+        }
+        Node const & node = mNodes[child];
+        for (unsigned k = 0; k < 4; k++)
+            if (node.child[k] >= 0 || node.count[k] > 0) collect(node.child[k], node.count[k], visible);
+    }
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+// Local Headers
+#include "vertex.hpp"
+
+// System Headers
+#include <glm/glm.hpp>
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // View Frustum as Six Normalized Planes, Positive on the Inside
+    struct Frustum {
+        Frustum(glm::mat4 const & viewProjection);
+        bool visible(glm::vec4 const & sphere) const;
+
+        glm::vec4 planes[6];
+    };
+
+    // Flat Four-Wide Bounding Volume Hierarchy Over Scene Instances. Nodes
+    // Store Their Children's Boxes Side by Side, so Culling Tests Four Boxes
+    // per Plane in One SSE Operation, and are Laid Out Depth-First in One
+    // Array. Moving Instances Only Refits the Boxes Above Them; Inserting
+    // or Removing Rebuilds the Tree on the Next cull().
+    //
+    //     auto handle = bvh.insert(mesh.bounds().transformed(model), index);
+    //     bvh.move(handle, mesh.bounds().transformed(newModel));
+    //     bvh.cull(Frustum(projection * view), visible);
+    class Bvh
+    {
+    public:
+
+        typedef std::uint32_t Handle;
+
+        // Implement Default Constructor
+        Bvh() : mLive(0), mRebuild(false) {}
+
+        // Public Member Functions
+        Handle insert(Bounds const & bounds, std::uint32_t value);
+        void   move(Handle handle, Bounds const & bounds);
+        void   remove(Handle handle);
+        void   build();
+        void   refit();
+        void   cull(Frustum const & frustum, std::vector<std::uint32_t> & visible);
+        std::size_t size() const { return mLive; }
+
+    private:
+
+        // Children Beyond the Items in a Leaf are Split Into Nodes
+        static unsigned const LeafSize = 4;
+
+        // Child k is Node child[k] if Non-Negative, Else a Leaf Holding
+        // count[k] Items From mOrder[~child[k]]; Empty Slots Have count 0
+        struct Node {
+            float minX[4], minY[4], minZ[4];
+            float maxX[4], maxY[4], maxZ[4];
+            std::int32_t  child[4];
+            std::uint32_t count[4];
+            std::uint32_t parent;
+        };
+
+        struct Item {
+            Bounds        bounds;
+            std::uint32_t value;
+            std::uint32_t node; // Node Whose Leaf Slot Holds This Item
+            bool          live;
+        };
+
+        // Private Member Functions
+        std::int32_t subdivide(std::uint32_t first, std::uint32_t last, std::uint32_t parent);
+        void   assign(Node & node, unsigned slot, Bounds const & bounds);
+        Bounds slot(Node const & node, unsigned slot) const;
+        Bounds leaf(std::uint32_t first, std::uint32_t count) const;
+        void   collect(std::int32_t child, std::uint32_t count, std::vector<std::uint32_t> & visible) const;
+        static void classify(Node const & node, Frustum const & frustum, int & outside, int & inside);
+
+        // Private Member Containers
+        std::vector<Node> mNodes;
+        std::vector<Item> mItems;
+        std::vector<Handle> mOrder; // Items in Leaf Order
+        std::vector<Handle> mFree;
+        std::vector<Handle> mMoved;
+        std::vector<bool> mDirty;
+        std::vector<std::int32_t> mStack;
+
+        // Private Member Variables
+        std::size_t mLive;
+        bool mRebuild;
+
+    };
+};
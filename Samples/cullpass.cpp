@@ -0,0 +1,170 @@
+// Local Headers
+#include "cullpass.hpp"
+#include "culling.hpp"
+#include "Extensions.hpp"
+#include "GLState.hpp"
+#include "Profiler.hpp"
+#include "UniformBuffer.hpp"
+
+// System Headers
+#include <GLFW/glfw3.h>
+
+// Standard Headers
+#include <algorithm>
+#include <string>
+
+#ifndef GL_PARAMETER_BUFFER
+#define GL_PARAMETER_BUFFER 0x80EE
+#endif
+
+// Define Namespace
+namespace Mirage
+{
+    // Five GLuints per Command, as glMultiDrawElementsIndirect Reads Them
+    static std::size_t const CommandSize = 5 * sizeof(GLuint);
+
+    typedef void (APIENTRYP MultiDrawCount)(GLenum mode, GLenum type, void const * indirect,
+                                            GLintptr drawCount, GLsizei maxDrawCount, GLsizei stride);
+
+    static MultiDrawCount multiDrawCount()
+    {
+        // Core in 4.6, and the Same Entry Point With a Suffix Before That
+        static MultiDrawCount function = [] {
+            if (!GLAD_GL_VERSION_4_6 && !hasExtension("GL_ARB_indirect_parameters")) return MultiDrawCount(nullptr);
+            auto found = (MultiDrawCount) glfwGetProcAddress("glMultiDrawElementsIndirectCount");
+            if (!found) found = (MultiDrawCount) glfwGetProcAddress("glMultiDrawElementsIndirectCountARB");
+            return found;
+        }();
+        return function;
+    }
+
+    bool CullPass::compacting()
+    {
+        return multiDrawCount() != nullptr;
+    }
+
+    CullPass::CullPass(GLsizei width, GLsizei height)
+        : mPyramid(0), mWidth(0), mHeight(0), mLevels(0)
+        , mView(1.0f), mProjection(1.0f), mPyramidView(1.0f), mPyramidProjection(1.0f)
+        , mOcclusion(true), mBuilt(false)
+    {
+        // Both Programs Ship With Glitter, Not Under Mirage/Shaders
+        mCull.attach("cull.comp", PROJECT_SOURCE_DIR "/Glitter/Shaders/").link();
+        mReduce.attach("pyramid.comp", PROJECT_SOURCE_DIR "/Glitter/Shaders/").link();
+        GLuint buffers[2];
+        glGenBuffers(2, buffers);
+        mInstanceBuffer = buffers[0];
+        mCountBuffer    = buffers[1];
+        resize(width, height);
+    }
+
+    CullPass::~CullPass()
+    {
+        GLuint buffers[] = { mInstanceBuffer, mCountBuffer };
+        glDeleteBuffers(2, buffers);
+        GLState::get().deleteTexture(mPyramid);
+    }
+
+    void CullPass::resize(GLsizei width, GLsizei height)
+    {
+        // Level Zero is Half the Depth Buffer, Rounded Up so Edges are Covered
+        width  = std::max((width  + 1) / 2, 1);
+        height = std::max((height + 1) / 2, 1);
+        if (width == mWidth && height == mHeight) return;
+        mWidth = width; mHeight = height;
+        mLevels = 1;
+        while ((std::max(mWidth, mHeight) >> mLevels) > 0) mLevels++;
+
+        // Immutable Storage, so Resizing Replaces the Texture Outright
+        GLState::get().deleteTexture(mPyramid);
+        glGenTextures(1, & mPyramid);
+        GLState::get().bindTexture(0, GL_TEXTURE_2D, mPyramid);
+        glTexStorage2D(GL_TEXTURE_2D, mLevels, GL_R32F, mWidth, mHeight);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        mBuilt = false;
+    }
+
+    void CullPass::camera(glm::mat4 const & view, glm::mat4 const & projection)
+    {
+        mView = view;
+        mProjection = projection;
+    }
+
+    void CullPass::pyramid(GLuint depth)
+    {
+        // Each Level Keeps the Farthest Depth of the Texels Below it, Edges of
+        // Odd Levels Included; the First Reads the Depth Texture, the Rest the
+        // Level Before
+        mReduce.activate();
+        mReduce.bind("source", 0);
+        for (GLsizei level = 0; level < mLevels; level++)
+        {   GLsizei width  = std::max(mWidth  >> level, 1);
+            GLsizei height = std::max(mHeight >> level, 1);
+            GLState::get().bindTexture(0, GL_TEXTURE_2D, level == 0 ? depth : mPyramid);
+            mReduce.bind("level", int(level == 0 ? 0 : level - 1));
+            mReduce.bind("size", glm::vec2(width, height));
+            glBindImageTexture(0, mPyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            glDispatchCompute(GLuint(width + 7) / 8, GLuint(height + 7) / 8, 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+
+        // Later Culls Test Against This Frame's Camera, Not Their Own
+        mPyramidView = mView;
+        mPyramidProjection = mProjection;
+        mBuilt = true;
+    }
+
+    void CullPass::cull(std::vector<Instance> const & instances, std::size_t batches)
+    {
+        PROFILE_SCOPE("Cull");
+        PROFILE_GPU("Cull");
+        // Last Frame's Storage is Orphaned Rather Than Waited On
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mInstanceBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(Instance), instances.data(), GL_STREAM_DRAW);
+        Profiler::get().count(ProfileCounter::UploadBytes, instances.size() * sizeof(Instance));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Instances, mInstanceBuffer);
+        std::vector<GLuint> zeros(std::max<std::size_t>(batches, 1), 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCountBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, zeros.size() * sizeof(GLuint), zeros.data(), GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding::Counts, mCountBuffer);
+
+        mCull.activate();
+        Frustum frustum(mProjection * mView);
+        for (int i = 0; i < 6; i++)
+            mCull.bind("planes[" + std::to_string(i) + "]", frustum.planes[i]);
+        mCull.bind("instanceCount", int(instances.size()));
+        mCull.bind("compact", int(compacting()));
+
+        // Without a Pyramid Yet (First Frame or Just Resized) Cull by Frustum Only
+        bool occlusion = mOcclusion && mBuilt;
+        mCull.bind("occlusion", int(occlusion));
+        if (occlusion)
+        {   GLState::get().bindTexture(0, GL_TEXTURE_2D, mPyramid);
+            mCull.bind("pyramid", 0);
+            mCull.bind("pyramidSize", glm::vec2(mWidth, mHeight));
+            mCull.bind("view", mPyramidView);
+            mCull.bind("projection", mPyramidProjection);
+        }
+        glDispatchCompute(GLuint(instances.size() + 63) / 64, 1, 1);
+
+        // Commands, Counts, and Draw Data are All Consumed by the Next Draws
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    void CullPass::draw(std::size_t batch, std::size_t offset, std::size_t capacity)
+    {
+        // Expects the Arena's Vertex Array and Command Buffer to be Bound
+        if (auto function = multiDrawCount())
+        {   glBindBuffer(GL_PARAMETER_BUFFER, mCountBuffer);
+            function(GL_TRIANGLES, GL_UNSIGNED_INT, (GLvoid *) (offset * CommandSize),
+                     GLintptr(batch * sizeof(GLuint)), GLsizei(capacity), 0);
+            glBindBuffer(GL_PARAMETER_BUFFER, 0);
+        }
+        else glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                         (GLvoid *) (offset * CommandSize), GLsizei(capacity), 0);
+    }
+};
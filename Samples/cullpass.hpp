@@ -0,0 +1,80 @@
+#pragma once
+
+// Local Headers
+#include "shader.hpp"
+
+// System Headers
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Standard Headers
+#include <cstddef>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // GPU Culling for MeshArena: a Compute Pass Tests Every Queued Draw
+    // Against the View Frustum and a Hi-Z Pyramid Built From the Previous
+    // Frame's Depth, and Writes the Indirect Commands the Arena Then Draws.
+    // With glMultiDrawElementsIndirectCount Survivors are Compacted and the
+    // Draw Count Never Leaves the GPU; Otherwise Culled Commands Keep Their
+    // Slot With No Instances. Render Into a Framebuffer With a Depth Texture:
+    //
+    //     pass.camera(view, projection);
+    //     arena.submit(shader, pass);
+    //     pass.pyramid(depthTexture); // Occluders for the Next Frame
+    //
+    // Requires OpenGL 4.3; Shaders are cull.comp and pyramid.comp.
+    class CullPass
+    {
+    public:
+
+        // Matches the std430 Instance Struct in cull.comp
+        struct Instance {
+            glm::mat4  model;
+            glm::vec4  sphere;  // Model-Space Center, Radius
+            glm::uvec4 command; // Index Count, First Index, Base Vertex, Batch
+            glm::uvec4 info;    // Material, Batch Offset
+        };
+
+        // Implement Custom Constructor and Destructor
+        CullPass(GLsizei width, GLsizei height);
+        ~CullPass();
+
+        // Public Member Functions
+        void camera(glm::mat4 const & view, glm::mat4 const & projection);
+        void pyramid(GLuint depth);
+        void resize(GLsizei width, GLsizei height);
+        void occlusion(bool enabled) { mOcclusion = enabled; }
+
+        // Write Commands for Every Instance Into the Bound Command and Draw
+        // Storage Buffers, With One Counter per Batch When Compacting
+        void cull(std::vector<Instance> const & instances, std::size_t batches);
+
+        // Draw the Surviving Commands of One Batch From the Indirect Buffer
+        void draw(std::size_t batch, std::size_t offset, std::size_t capacity);
+
+        static bool supported() { return GLAD_GL_VERSION_4_3 != 0; }
+        static bool compacting();
+
+    private:
+
+        // Disable Copying and Assignment
+        CullPass(CullPass const &) = delete;
+        CullPass & operator=(CullPass const &) = delete;
+
+        // Private Member Variables
+        Shader mCull;
+        Shader mReduce;
+        GLuint mInstanceBuffer;
+        GLuint mCountBuffer;
+        GLuint mPyramid;
+        GLsizei mWidth, mHeight, mLevels;
+        glm::mat4 mView, mProjection;             // This Frame
+        glm::mat4 mPyramidView, mPyramidProjection; // Frame the Pyramid Came From
+        bool mOcclusion;
+        bool mBuilt;
+
+    };
+};
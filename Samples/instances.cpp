@@ -0,0 +1,129 @@
+// Local Headers
+#include "instances.hpp"
+#include "GLState.hpp"
+#include "Profiler.hpp"
+
+// Standard Headers
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// Define Namespace
+namespace Mirage
+{
+    InstanceBatch::InstanceBatch(std::size_t capacity)
+        : mCapacity(capacity), mCount(0)
+    {
+        glGenBuffers(1, & mInstanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    InstanceBatch::~InstanceBatch()
+    {
+        glDeleteBuffers(1, & mInstanceBuffer);
+    }
+
+    void InstanceBatch::add(Mesh const & mesh, Instance const & instance)
+    {
+        // Groups Only Live Until the Next submit(), so a Mesh Freed Later and
+        // Another Allocated at its Address Never Share One
+        auto it = mGroups.find(& mesh);
+        if (it == mGroups.end())
+        {   it = mGroups.insert(std::make_pair(& mesh, mInstances.size())).first;
+            mInstances.push_back(std::make_pair(& mesh, std::vector<Instance>()));
+        }   mInstances[it->second].second.push_back(instance);
+        mCount++;
+    }
+
+    void InstanceBatch::submit(GLuint shader)
+    {
+        if (mCount == 0) return;
+        PROFILE_SCOPE("Submit");
+        Profiler::get().count(ProfileCounter::UploadBytes, mCount * sizeof(Instance));
+
+        // Orphan the Instance Buffer and Stream Every Group Into it Back to Back
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+        if (mCount > mCapacity) mCapacity = std::max(mCount, mCapacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+        auto mapped = static_cast<Instance *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, mCount * sizeof(Instance),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        mDraws.clear();
+        std::size_t first = 0;
+        if (mapped)
+        {   for (auto & group : mInstances)
+            {   std::memcpy(mapped + first, group.second.data(), group.second.size() * sizeof(Instance));
+                collect(* group.first, first, GLsizei(group.second.size()));
+                first += group.second.size();
+            }   glUnmapBuffer(GL_ARRAY_BUFFER);
+        }   else fprintf(stderr, "%s\n", "Failed to Map Instance Buffer; Dropping This Frame's Instances");
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mGroups.clear();
+        mInstances.clear();
+        mCount = 0;
+
+        // Share Texture Binds Across Meshes Using the Same Material
+        std::sort(mDraws.begin(), mDraws.end(), [](Draw const & a, Draw const & b)
+        {   return a.node->mMaterial.id != b.node->mMaterial.id
+                 ? a.node->mMaterial.id < b.node->mMaterial.id
+                 : a.node->mVertexArray < b.node->mVertexArray;
+        });
+
+        auto & state = GLState::get();
+        state.useProgram(shader);
+        Material::samplers(shader);
+        for (auto & draw : mDraws)
+        {   // Every Instance of a Node Shares the Level Kept on the Mesh
+            Mesh::Level level = draw.node->range(nullptr, 0);
+            draw.node->mMaterial.bind();
+            state.bindVertexArray(draw.node->mVertexArray);
+            attributes(draw.first);
+            glDrawElementsInstanced(GL_TRIANGLES, level.count, draw.node->mIndexType,
+                                    (GLvoid *) level.offset, draw.count);
+            detach();
+            Profiler::get().count(ProfileCounter::DrawCalls);
+            Profiler::get().count(ProfileCounter::Triangles, std::uint64_t(level.count / 3) * draw.count);
+        }
+    }
+
+    void InstanceBatch::collect(Mesh const & node, std::size_t first, GLsizei count)
+    {
+        for (auto & i : node.mSubMeshes) collect(* i, first, count);
+        if (node.mIndexCount > 0)
+        {   Draw draw = { & node, first, count };
+            mDraws.push_back(draw);
+        }
+    }
+
+    void InstanceBatch::attributes(std::size_t first)
+    {
+        // Point the Bound Vertex Array at This Group's Instances; Re-Pointing
+        // per Draw Avoids Tracking Which (Possibly Recycled) Arrays Were Set Up
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+        std::size_t base = first * sizeof(Instance);
+        for (GLuint column = 0; column < 4; column++)
+        {   glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                                  (GLvoid *) (base + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(4 + column, 1);
+            glEnableVertexAttribArray(4 + column);
+        }
+        glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (GLvoid *) (base + offsetof(Instance, tint)));
+        glVertexAttribDivisor(8, 1);
+        glEnableVertexAttribArray(8);
+        glVertexAttribIPointer(9, 1, GL_UNSIGNED_INT, sizeof(Instance), (GLvoid *) (base + offsetof(Instance, id)));
+        glVertexAttribDivisor(9, 1);
+        glEnableVertexAttribArray(9);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void InstanceBatch::detach()
+    {
+        // The Vertex Array is the Mesh's Own, so Leave it as Ordinary Draws
+        // Expect: Instance Attributes Off and Every Divisor Back to Zero
+        for (GLuint location = 4; location < 10; location++)
+        {   glVertexAttribDivisor(location, 0);
+            glDisableVertexAttribArray(location);
+        }
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+// Local Headers
+#include "mesh.hpp"
+
+// System Headers
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Standard Headers
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Draws Many Copies of a Mesh With One glDrawElementsInstanced per
+    // Sub-Mesh. Instances are Grouped by Mesh, Streamed Into One Buffer Each
+    // Frame, and the Resulting Draws are Ordered by Material so Texture Binds
+    // are Shared. Meshes Must Outlive the submit() Their Instances Were Added
+    // For. Per-Instance Attributes Follow the Vertex Attributes, and are Only
+    // Enabled on a Mesh's Vertex Array for the Length of its Draw:
+    //
+    //     layout (location = 4) in mat4 instanceModel; // Uses 4 to 7
+    //     layout (location = 8) in vec4 instanceTint;
+    //     layout (location = 9) in uint instanceId;
+    class InstanceBatch
+    {
+    public:
+
+        // Per-Instance Data, as Laid Out in the Instance Buffer
+        struct Instance {
+            glm::mat4 model;
+            glm::vec4 tint;
+            GLuint    id;
+            GLuint    padding[3];
+        };
+
+        // Implement Custom Constructor and Destructor
+        InstanceBatch(std::size_t capacity = 1 << 16);
+        ~InstanceBatch();
+
+        // Public Member Functions
+        void add(Mesh const & mesh, Instance const & instance);
+        void submit(GLuint shader);
+        std::size_t size() const { return mCount; }
+
+    private:
+
+        // Disable Copying and Assignment
+        InstanceBatch(InstanceBatch const &) = delete;
+        InstanceBatch & operator=(InstanceBatch const &) = delete;
+
+        // One Instanced Draw of a Single Sub-Mesh
+        struct Draw {
+            Mesh const * node;
+            std::size_t  first;
+            GLsizei      count;
+        };
+
+        // Private Member Functions
+        void collect(Mesh const & node, std::size_t first, GLsizei count);
+        void attributes(std::size_t first);
+        void detach();
+
+        // Private Member Containers
+        std::unordered_map<Mesh const *, std::size_t> mGroups; // Mesh, Index Into mInstances
+        std::vector<std::pair<Mesh const *, std::vector<Instance>>> mInstances;
+        std::vector<Draw> mDraws;
+
+        // Private Member Variables
+        GLuint mInstanceBuffer;
+        std::size_t mCapacity;
+        std::size_t mCount;
+
+    };
+};
@@ -0,0 +1,121 @@
+// Local Headers
+#include "ktx.hpp"
+#include "cooked.hpp"
+#include "texture.hpp"
+
+// Standard Headers
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// Define Namespace
+namespace Mirage
+{
+    namespace Ktx
+    {
+        // Basic Data Format Descriptor: the Block's Colour Model and Size,
+        // Then One Sample per Channel Naming the Bits That Hold it
+        static std::vector<uint32_t> descriptor(BlockInfo const & info)
+        {
+            // Model, and Channel, Bit Offset, Bit Length per Sample
+            struct Sample { uint32_t channel, offset, length; };
+            uint32_t model = 0;
+            std::vector<Sample> samples;
+            switch (info.format)
+            {
+                case BlockFormat::BC1 : model = 128; samples = { { 0, 0, 64 } }; break;
+                case BlockFormat::BC3 : model = 130; samples = { { 15, 0, 64 }, { 0, 64, 64 } }; break;
+                case BlockFormat::BC4 : model = 131; samples = { { 0, 0, 64 } }; break;
+                case BlockFormat::BC5 : model = 132; samples = { { 0, 0, 64 }, { 1, 64, 64 } }; break;
+                case BlockFormat::BC7 : model = 134; samples = { { 0, 0, 128 } }; break;
+            }
+            std::vector<uint32_t> words = {
+                0,                                                // Total Size, Filled in Below
+                0,                                                // Khronos Vendor, Basic Descriptor Type
+                2u | uint32_t(24 + 16 * samples.size()) << 16,    // Version 2, Block Size
+                model | 1u << 8 | 1u << 16,                       // BT.709 Primaries, Linear Transfer
+                3u | 3u << 8,                                     // 4x4 Texel Blocks, Stored Minus One
+                uint32_t(info.bytes),                             // Bytes in Plane 0
+                0 };
+            for (auto & sample : samples)
+            {   words.push_back(sample.offset | (sample.length - 1) << 16 | sample.channel << 24);
+                words.push_back(0);          // Sample Position
+                words.push_back(0);          // Lower and Upper Bounds of Unsigned Normalized Data
+                words.push_back(0xFFFFFFFF);
+            }   words[0] = uint32_t(words.size() * sizeof(uint32_t));
+            return words;
+        }
+
+        bool write(std::string const & filename, int width, int height, BlockFormat format,
+                   std::vector<std::vector<unsigned char>> const & levels)
+        {
+            BlockInfo const & info = blockInfo(format);
+            std::vector<uint32_t> dfd = descriptor(info);
+            Header header = {};
+            std::memcpy(header.identifier, Identifier, sizeof(Identifier));
+            header.vkFormat      = info.vkFormat;
+            header.typeSize      = 1;
+            header.pixelWidth    = uint32_t(width);
+            header.pixelHeight   = uint32_t(height);
+            header.faceCount     = 1;
+            header.levelCount    = uint32_t(levels.size());
+            header.dfdByteOffset = uint32_t(sizeof(Header) + levels.size() * sizeof(Level));
+            header.dfdByteLength = uint32_t(dfd.size() * sizeof(uint32_t));
+
+            // Lay Out the Smallest Level First, Aligned to the Block Size
+            std::vector<Level> index(levels.size());
+            uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+            for (std::size_t i = levels.size(); i-- > 0;)
+            {   offset = (offset + info.bytes - 1) / info.bytes * info.bytes;
+                index[i].byteOffset = offset;
+                index[i].byteLength = index[i].uncompressedByteLength = levels[i].size();
+                offset += levels[i].size();
+            }
+
+            // Write Sections, Padding With Zeros up to Each Offset
+            std::ofstream fd(filename, std::ios::binary);
+            auto put = [& fd](uint64_t offset, void const * data, std::size_t size)
+            {   while (uint64_t(fd.tellp()) < offset) fd.put(0);
+                fd.write((char const *) data, size);
+            };  put(0, & header, sizeof(header));
+            put(sizeof(header), index.data(), index.size() * sizeof(Level));
+            put(header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+            for (std::size_t i = levels.size(); i-- > 0;)
+                put(index[i].byteOffset, levels[i].data(), levels[i].size());
+            return bool(fd);
+        }
+
+        bool read(MappedFile const & file, Image & image)
+        {
+            // Validate the Header Before Trusting Any Offsets
+            auto header = file.at<Header>(0);
+            if (file.size() < sizeof(Header)
+                || std::memcmp(header->identifier, Identifier, sizeof(Identifier)) != 0
+                || !blockInfo(header->vkFormat)
+                || header->typeSize    != 1
+                || header->pixelWidth  == 0 || header->pixelHeight == 0 || header->pixelDepth != 0
+                || header->layerCount  >  1 || header->faceCount   != 1
+                || header->levelCount  == 0
+                || header->levelCount  >  uint32_t(TextureUploader::levels(int(header->pixelWidth), int(header->pixelHeight)))
+                || header->supercompressionScheme != 0
+                || sizeof(Header) + header->levelCount * sizeof(Level) > file.size()) return false;
+
+            // Every Level Must Hold at Least its Blocks and Lie Inside the File
+            BlockInfo const * info = blockInfo(header->vkFormat);
+            auto levels = file.at<Level>(sizeof(Header));
+            image.levels.clear();
+            for (uint32_t i = 0; i < header->levelCount; i++)
+            {   std::size_t size = compressedSize(std::max(int(header->pixelWidth  >> i), 1),
+                                                  std::max(int(header->pixelHeight >> i), 1), info->format);
+                if (levels[i].byteLength < size || levels[i].byteOffset > file.size()
+                    || levels[i].byteLength > file.size() - levels[i].byteOffset) return false;
+                image.levels.push_back(std::make_pair(std::size_t(levels[i].byteOffset), size));
+            }
+            image.width    = int(header->pixelWidth);
+            image.height   = int(header->pixelHeight);
+            image.channels = info->channels;
+            image.block    = info;
+            return true;
+        }
+    };
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+// Local Headers
+#include "compress.hpp"
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Forward Declarations
+    class MappedFile;
+    struct Image;
+
+    // KTX2 Container for Block-Compressed 2D Textures With Pre-Built Mips,
+    // Written by Image::cook() and Mapped Directly by Image::decode(). Only
+    // What This Loader Needs is Supported: One Face, One Layer, No
+    // Supercompression, and the Formats in compress.hpp.
+    //
+    //     Header | Level Index (Finest First) | Data Format Descriptor |
+    //     Level Data (Coarsest First, Each on a Block Boundary)
+    namespace Ktx
+    {
+        unsigned char const Identifier[12] = {
+            0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        struct Header {
+            unsigned char identifier[12];
+            uint32_t vkFormat;
+            uint32_t typeSize;
+            uint32_t pixelWidth, pixelHeight, pixelDepth;
+            uint32_t layerCount, faceCount, levelCount;
+            uint32_t supercompressionScheme;
+            uint32_t dfdByteOffset, dfdByteLength;
+            uint32_t kvdByteOffset, kvdByteLength;
+            uint64_t sgdByteOffset, sgdByteLength;
+        };
+
+        struct Level {
+            uint64_t byteOffset;
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;
+        };
+
+        // Write Compressed Levels, Given Finest First
+        bool write(std::string const & filename, int width, int height, BlockFormat format,
+                   std::vector<std::vector<unsigned char>> const & levels);
+
+        // Validate a Mapped File and Point image at its Levels; Sets
+        // Everything but image.pixels, Which the Caller Ties to the Mapping
+        bool read(MappedFile const & file, Image & image);
+    };
+};
@@ -0,0 +1,124 @@
+// Local Headers
+#include "loader.hpp"
+
+// Standard Headers
+#include <algorithm>
+#include <chrono>
+
+// Define Namespace
+namespace Mirage
+{
+    Loader::Loader(std::size_t capacity)
+        : mCapacity(std::max<std::size_t>(capacity, 1))
+        , mInFlight(0)
+        , mLoading(0)
+        , mStopping(false)
+    {}
+
+    Loader::~Loader()
+    {
+        // Jobs Already Queued Still Run, but Skip Their Work; Wait so None Outlive Us
+        {   std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+            mDecodes.clear();
+        }   JobSystem::get().wait(mJobs);
+
+        // Workers Have Let Go, so Unfinished Models are Released Here on the
+        // Context Thread, Along With Their GL Objects
+        mUploads.clear();
+        mRequests.clear();
+    }
+
+    std::shared_future<std::shared_ptr<Mesh>> Loader::load(std::string const & filename)
+    {
+        // The Root Mesh Owns GL Objects, so Create it Here on the Context Thread
+        // and Keep a Reference Until update() or the Destructor Drops it There;
+        // Whichever Job Lets Go Last Then Never Destroys the Mesh
+        auto request = std::make_shared<Request>();
+        request->mesh = std::make_shared<Mesh>();
+        mRequests.push_back(request);
+        std::shared_future<std::shared_ptr<Mesh>> future = request->promise.get_future().share();
+
+        // Import in One Job; Each Sub-Mesh Then Gets its Own Decode Job, so
+        // Texture Decoding for One Model Spreads Across the Whole Pool
+        request->remaining = 1;
+        JobSystem::get().run([this, request, filename]() mutable
+        {   if (!mStopping) Mesh::import(filename, [this, & request](MeshData && data)
+            {   Upload upload;
+                upload.request = request;
+                upload.data = std::make_shared<MeshData>(std::move(data));
+                request->remaining++;
+                std::lock_guard<std::mutex> lock(mMutex);
+                mDecodes.push_back(std::move(upload));
+                schedule();
+            }); finish(request);
+        }, & mJobs, "Load");
+
+        mLoading++;
+        return future;
+    }
+
+    std::size_t Loader::update(double budget)
+    {
+        // Upload Until the Time Budget is Spent, but Always Make Some Progress
+        auto start = std::chrono::steady_clock::now();
+        std::size_t uploaded = 0;
+        for (;;)
+        {
+            Upload upload;
+            {   std::lock_guard<std::mutex> lock(mMutex);
+                if (mUploads.empty()) break;
+                upload = std::move(mUploads.front());
+                mUploads.pop_front();
+                if (upload.data)
+                {   mInFlight--;
+                    schedule();
+                }
+            }
+
+            // Attach the Sub-Mesh, or Hand the Finished Model to the Caller
+            auto & request = upload.request;
+            if (upload.data)
+                request->mesh->mSubMeshes.push_back(std::unique_ptr<Mesh>(new Mesh(*upload.data)));
+            else
+            {   request->promise.set_value(request->mesh);
+                mRequests.erase(std::find(mRequests.begin(), mRequests.end(), request));
+                mLoading--;
+            }   uploaded++;
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budget) break;
+        }   return uploaded;
+    }
+
+    void Loader::schedule()
+    {
+        // Called With mMutex Held. Decoded Images are the Bulk of a Sub-Mesh,
+        // so Only as Many are Decoded as the Upload Queue Can Hold.
+        while (mInFlight < mCapacity && !mDecodes.empty())
+        {   Upload upload = std::move(mDecodes.front());
+            mDecodes.pop_front();
+            mInFlight++;
+            JobSystem::get().run([this, upload]() mutable
+            {   if (!mStopping) upload.data->decode();
+                std::shared_ptr<Request> request = upload.request;
+                {   std::lock_guard<std::mutex> lock(mMutex);
+                    if (!mStopping) mUploads.push_back(std::move(upload));
+                }   finish(request);
+            }, & mJobs, "Decode");
+        }
+    }
+
+    void Loader::finish(std::shared_ptr<Request> & request)
+    {
+        // The Last Job Queues the Completion Marker; Everyone Else Just Lets Go
+        // of the Request, Which mRequests Keeps Alive on the Context Thread
+        if (--request->remaining > 0) request.reset();
+        else
+        {   Upload done;
+            done.request = std::move(request);
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mStopping) mUploads.push_back(std::move(done));
+        }
+    }
+};
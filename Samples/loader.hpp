@@ -0,0 +1,86 @@
+#pragma once
+
+// Local Headers
+#include "Jobs.hpp"
+#include "mesh.hpp"
+
+// Standard Headers
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Streams Models in Without Stalling the Render Thread. Assimp Import,
+    // Vertex/Index Building and Texture Decoding Run as Jobs on the Shared
+    // JobSystem; Finished Sub-Meshes Wait in a Bounded Queue Until update()
+    // Uploads Them on the Context Thread. Decode Jobs are Only Started While
+    // the Queue Has Room, so a Full Queue Never Blocks a Worker.
+    //
+    //     Loader loader;
+    //     auto model = loader.load("nanosuit/nanosuit.obj");
+    //     while (running)
+    //     {   loader.update(0.002);
+    //         if (ready(model)) model.get()->draw(shader);
+    //     }
+    class Loader
+    {
+    public:
+
+        // Implement Custom Constructor and Destructor
+        Loader(std::size_t capacity = 64);
+        ~Loader();
+
+        // Public Member Functions
+        std::shared_future<std::shared_ptr<Mesh>> load(std::string const & filename);
+        std::size_t update(double budget);
+        std::size_t pending() const { return mLoading; }
+
+    private:
+
+        // Disable Copying and Assignment
+        Loader(Loader const &) = delete;
+        Loader & operator=(Loader const &) = delete;
+
+        // One Model Being Streamed In
+        struct Request {
+            std::shared_ptr<Mesh> mesh;
+            std::promise<std::shared_ptr<Mesh>> promise;
+            std::atomic<int> remaining; // Import Task Plus Outstanding Decode Tasks
+        };
+
+        // One Unit of Upload Work; a Request Without Data Marks Completion
+        struct Upload {
+            std::shared_ptr<Request> request;
+            std::shared_ptr<MeshData> data;
+        };
+
+        // Private Member Functions
+        void schedule();
+        void finish(std::shared_ptr<Request> & request);
+
+        // Private Member Containers
+        std::deque<Upload> mDecodes; // Imported, Waiting for Room to Decode
+        std::deque<Upload> mUploads;
+        std::vector<std::shared_ptr<Request>> mRequests; // Context Thread Only
+
+        // Private Member Variables
+        std::mutex mMutex;
+        JobCounter mJobs;
+        std::size_t mCapacity;
+        std::size_t mInFlight; // Decoding or Waiting for Upload
+        std::atomic<std::size_t> mLoading; // Read by pending() Without the Lock
+        std::atomic<bool> mStopping;
+
+    };
+
+    // Check a Future Without Blocking
+    template<typename T> bool ready(std::shared_future<T> const & future)
+    { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+};
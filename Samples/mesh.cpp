@@ -1,16 +1,112 @@
-// Preprocessor Directives
-#define STB_IMAGE_IMPLEMENTATION
-
 // Local Headers
+#include "arena.hpp"
+#include "commands.hpp"
+#include "cooked.hpp"
+#include "instances.hpp"
 #include "mesh.hpp"
+#include "queue.hpp"
+#include "residency.hpp"
 
-// System Headers
-#include <stb_image.h>
+// Standard Headers
+#include <fstream>
+#include <map>
 
 // Define Namespace
 namespace Mirage
 {
-    Mesh::Mesh(std::string const & filename) : Mesh()
+    Mesh::Mesh(std::string const & filename, VertexFormat format) : Mesh()
+    {
+        // Cooked Models are Mapped and Uploaded Without Per-Vertex Work
+        if (filename.substr(filename.find_last_of(".") + 1) == "mesh")
+        {   MappedFile file(PROJECT_SOURCE_DIR "/Mirage/Models/" + filename);
+            if (!read(file)) fprintf(stderr, "%s %s\n", "Invalid Cooked Mesh", filename.c_str());
+            return;
+        }
+
+        // Load a Model from File and Upload Each Sub-Mesh as it is Built
+        if (format == VertexFormat::Float)
+        {   import(filename, [this](MeshData && data)
+            {   data.decode();
+                mSubMeshes.push_back(std::unique_ptr<Mesh>(new Mesh(data)));
+            }); return;
+        }
+
+        // Packed Formats Need the Bounds of Every Sub-Mesh Before Uploading
+        std::vector<MeshData> meshes; Bounds bounds;
+        import(filename, [& meshes, & bounds](MeshData && data)
+        {   bounds.add(data.vertices);
+            meshes.push_back(std::move(data));
+        });
+        for (auto & data : meshes)
+        {   data.decode();
+            mSubMeshes.push_back(std::unique_ptr<Mesh>(new Mesh(data, format, bounds)));
+        }   mFormat = format;
+            mUnpack = bounds.unpack();
+    }
+
+    Mesh::Mesh(std::string const & filename, MeshArena & arena) : Mesh()
+    {
+        // Append Each Sub-Mesh to the Arena and Remember Where it Went
+        import(filename, [this, & arena](MeshData && data)
+        {   TextureSet textures;
+            data.decode();
+            process(data, textures);
+            auto range = arena.add(data.vertices, data.indices);
+            mBounds.add(data.bounds);
+            mRanges.push_back(std::make_pair(range, arena.material(textures)));
+        });
+    }
+
+    Mesh::Mesh(std::string const & filename, Scene & scene, Scene::Node parent) : Mesh()
+    {
+        // Sub-Meshes Keep Their Node-Local Vertices; the Scene Places Them
+        import(filename, scene, parent, [this, & scene](MeshData && data, std::vector<Scene::Node> const & nodes)
+        {   data.decode();
+            mSubMeshes.push_back(std::unique_ptr<Mesh>(new Mesh(data)));
+            for (auto node : nodes) scene.attach(node, * mSubMeshes.back());
+        });
+    }
+
+    Mesh::Mesh(MeshData const & data, VertexFormat format, Bounds const & bounds)
+        : Mesh(data.vertices, data.indices, TextureSet(), format, bounds, data.lods)
+    {
+        process(data, mTextures);
+        mMaterial = Material::build(mTextures);
+    }
+
+    PoolAllocator & Mesh::pool()
+    {
+        // Never Freed, so Meshes Owned by Other Statics Can Still Return Their Node
+        static PoolAllocator * nodes = new PoolAllocator(sizeof(Mesh), alignof(Mesh), 64);
+        return * nodes;
+    }
+
+    void * Mesh::operator new(std::size_t size)
+    {
+        if (size != sizeof(Mesh)) return ::operator new(size);
+        return pool().allocate();
+    }
+
+    void Mesh::operator delete(void * pointer, std::size_t size)
+    {
+        if (size != sizeof(Mesh)) ::operator delete(pointer);
+        else pool().deallocate(pointer);
+    }
+
+    void MeshData::decode()
+    {
+        // Skip Files Another Mesh Already Uploaded; Share In-Flight Decodes
+        auto & cache = TextureCache::get();
+        for (auto i = images.size(); i < textures.size(); i++)
+        {   auto key = cache.key(textures[i].first, TextureOptions());
+            Image image; image.filename = textures[i].first;
+            images.push_back(cache.resident(key) ? image : cache.decode(key, image.filename));
+        }
+    }
+
+    bool Mesh::import(std::string const & filename,
+                      std::function<void(MeshData &&)> const & emit,
+                      OptimizeOptions const & options)
     {
         // Load a Model from File
         Assimp::Importer loader;
@@ -23,147 +119,499 @@ namespace Mirage
         // Walk the Tree of Scene Nodes
         auto index = filename.find_last_of("/");
         if (!scene) fprintf(stderr, "%s\n", loader.GetErrorString());
-        else parse(filename.substr(0, index), scene->mRootNode, scene);
+        else parse(filename.substr(0, index), scene->mRootNode, scene, [& filename, & options, & emit](MeshData && data)
+        {   refine(filename, options, data);
+            emit(std::move(data));
+        });
+        return scene != nullptr;
+    }
+
+    bool Mesh::import(std::string const & filename, Scene & scene, Scene::Node parent,
+                      std::function<void(MeshData &&, std::vector<Scene::Node> const &)> const & emit,
+                      OptimizeOptions const & options)
+    {
+        // Same Import, Less aiProcess_OptimizeGraph, Which Bakes Node Transforms
+        // Into the Vertices and Merges the Nodes Away
+        Assimp::Importer loader;
+        aiScene const * model = loader.ReadFile(
+            PROJECT_SOURCE_DIR "/Mirage/Models/" + filename,
+            aiProcessPreset_TargetRealtime_MaxQuality |
+            aiProcess_FlipUVs);
+        if (!model) { fprintf(stderr, "%s\n", loader.GetErrorString()); return false; }
+
+        // Mirror the Node Tree Depth-First; a Node is Only Queued Once its
+        // Parent Exists, so the Scene Stays in Topological Order
+        std::vector<std::vector<Scene::Node>> users(model->mNumMeshes);
+        std::vector<std::pair<aiNode const *, Scene::Node>> pending(1, std::make_pair(model->mRootNode, parent));
+        while (!pending.empty())
+        {   aiNode const * node = pending.back().first;
+            Scene::Node under   = pending.back().second;
+            pending.pop_back();
+            aiVector3D scaling, position; aiQuaternion rotation;
+            node->mTransformation.Decompose(scaling, rotation, position);
+            Scene::Node added = scene.add(under, node->mName.C_Str(),
+                                          glm::vec3(position.x, position.y, position.z),
+                                          glm::quat(rotation.w, rotation.x, rotation.y, rotation.z),
+                                          glm::vec3(scaling.x, scaling.y, scaling.z));
+            for (unsigned int i = 0; i < node->mNumMeshes; i++) users[node->mMeshes[i]].push_back(added);
+            for (unsigned int i = node->mNumChildren; i-- > 0;) pending.push_back(std::make_pair(node->mChildren[i], added));
+        }
+
+        // Build Each Referenced Mesh Once; Nodes Sharing it Share the Upload
+        auto index = filename.find_last_of("/");
+        for (unsigned int i = 0; i < model->mNumMeshes; i++)
+        {   if (users[i].empty()) continue;
+            MeshData data = parse(filename.substr(0, index), model->mMeshes[i], model);
+            refine(filename, options, data);
+            emit(std::move(data), users[i]);
+        }   return true;
+    }
+
+    void Mesh::refine(std::string const & filename, OptimizeOptions const & options, MeshData & data)
+    {
+        optimize(data.vertices, data.indices, options, filename);
+        data.lods = lods(data.vertices, data.indices, options);
+        if (options.report)
+        for (auto & lod : data.lods)
+            fprintf(stderr, "%s: LOD %zu Triangles, Error %g\n", filename.c_str(), lod.indices.size() / 3, lod.error);
     }
 
     Mesh::Mesh(std::vector<Vertex> const & vertices,
                std::vector<GLuint> const & indices,
-               std::map<GLuint, std::string> const & textures)
+               TextureSet const & textures,
+               VertexFormat format, Bounds const & bounds,
+               std::vector<Lod> const & lods)
                     : mIndices(indices)
                     , mVertices(vertices)
                     , mTextures(textures)
+                    , mSphere(boundingSphere(vertices.data(), vertices.size()))
+                    , mFormat(format)
+                    , mUnpack(1.0f)
+                    , mIndexType(vertices.size() <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT)
+                    , mIndexCount(GLsizei(indices.size()))
+                    , mIndexOffset(0)
+                    , mLevel(0)
+                    , mUvDensity(uvDensity(vertices.data(), indices.data(), indices.size()))
     {
         // Bind a Vertex Array Object
         glGenVertexArrays(1, & mVertexArray);
-        glBindVertexArray(mVertexArray);
+        GLState::get().bindVertexArray(mVertexArray);
 
-        // Copy Vertex Buffer Data
+        // Pack Positions Inside the Bounds for the Quantized Formats
+        Bounds packing = bounds;
+        if (packing.empty()) packing.add(mVertices);
+        if (format != VertexFormat::Float) mUnpack = packing.unpack();
+
+        // Copy Vertex Buffer Data and Set Shader Attributes From the Layout
         glGenBuffers(1, & mVertexBuffer);
         glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER,
-                     mVertices.size() * sizeof(Vertex),
-                   & mVertices.front(), GL_STATIC_DRAW);
+        switch (format)
+        {
+            case VertexFormat::Float   : upload<FloatVertex>  (mVertices, packing); break;
+            case VertexFormat::Half    : upload<HalfVertex>   (mVertices, packing); break;
+            case VertexFormat::Compact : upload<CompactVertex>(mVertices, packing); break;
+        }
+
+        // Append Coarser Levels After Full Detail in the Same Element Buffer
+        std::size_t const stride = mIndexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+        std::vector<GLuint> combined(mIndices);
+        Level full = { mIndexCount, 0, 0.0f };
+        mLevels.push_back(full);
+        for (auto & lod : lods)
+        {   Level level = { GLsizei(lod.indices.size()), combined.size() * stride, lod.error };
+            combined.insert(combined.end(), lod.indices.begin(), lod.indices.end());
+            mLevels.push_back(level);
+        }   mBounds.add(mVertices);
 
-        // Copy Index Buffer Data
+        // Copy Index Buffer Data, Halving it When Every Index Fits in 16 Bits
         glGenBuffers(1, & mElementBuffer);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     mIndices.size() * sizeof(GLuint),
-                   & mIndices.front(), GL_STATIC_DRAW);
-
-        // Set Shader Attributes
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *) offsetof(Vertex, position));
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *) offsetof(Vertex, normal));
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid *) offsetof(Vertex, uv));
-        glEnableVertexAttribArray(0); // Vertex Positions
-        glEnableVertexAttribArray(1); // Vertex Normals
-        glEnableVertexAttribArray(2); // Vertex UVs
+        if (mIndexType == GL_UNSIGNED_SHORT)
+        {   std::vector<GLushort> shorts(combined.begin(), combined.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                         shorts.size() * sizeof(GLushort),
+                         shorts.data(), GL_STATIC_DRAW);
+        }
+        else glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                          combined.size() * sizeof(GLuint),
+                          combined.data(), GL_STATIC_DRAW);
 
         // Cleanup Buffers
-        glBindVertexArray(0);
+        GLState::get().bindVertexArray(0);
         glDeleteBuffers(1, & mVertexBuffer);
         glDeleteBuffers(1, & mElementBuffer);
+        mMaterial = Material::build(mTextures);
+    }
+
+    bool Mesh::cook(std::string const & filename, std::string const & output,
+                    OptimizeOptions const & options, CompressOptions const & compression)
+    {
+        // Run the Full Import Once, Offline
+        std::vector<MeshData> meshes;
+        if (!import(filename, [& meshes](MeshData && data) { meshes.push_back(std::move(data)); }, options))
+            return false;
+
+        // Compress Each Texture Once, Next to its Source, and Refer to That
+        // Instead; Textures That Fail to Cook Keep Their Original Name
+        std::map<std::string, std::string> cooked;
+        for (auto & mesh : meshes)
+        for (auto & texture : mesh.textures)
+        {   auto & name = cooked[texture.first];
+            if (!name.empty()) continue;
+            name = texture.first.substr(0, texture.first.find_last_of(".")) + ".ktx2";
+            if (!compression.enabled || !Image::cook(texture.first, name, compression)) name = texture.first;
+        }
+
+        // Flatten Sub-Mesh Ranges and Texture References
+        std::string const root = PROJECT_SOURCE_DIR "/Mirage/Models/";
+        std::vector<Cooked::SubMesh> ranges;
+        std::vector<Cooked::Texture> textures;
+        std::string strings;
+        Cooked::Header header = {};
+        for (auto & mesh : meshes)
+        {   Cooked::SubMesh range = {
+                uint32_t(header.vertexCount), uint32_t(mesh.vertices.size()),
+                uint32_t(header.indexCount),  uint32_t(mesh.indices.size()),
+                uint32_t(textures.size()),    uint32_t(mesh.textures.size()) };
+            for (auto & texture : mesh.textures)
+            {   std::string name = cooked[texture.first];
+                if (name.compare(0, root.size(), root) == 0) name = name.substr(root.size());
+                Cooked::Texture ref = { uint32_t(strings.size()), uint32_t(name.size()),
+                                        uint32_t(texture.second == "specular"), 0 };
+                textures.push_back(ref);
+                strings += name;
+            }   ranges.push_back(range);
+            header.vertexCount += mesh.vertices.size();
+            header.indexCount  += mesh.indices.size();
+        }
+
+        // Lay Out Every Section on an Aligned Boundary
+        header.magic         = Cooked::Magic;
+        header.version       = Cooked::Version;
+        header.vertexStride  = sizeof(Vertex);
+        header.indexSize     = sizeof(GLuint);
+        header.subMeshCount  = uint32_t(ranges.size());
+        header.textureCount  = uint32_t(textures.size());
+        header.vertexOffset  = Cooked::align(sizeof(header));
+        header.indexOffset   = Cooked::align(header.vertexOffset  + header.vertexCount * sizeof(Vertex));
+        header.subMeshOffset = Cooked::align(header.indexOffset   + header.indexCount  * sizeof(GLuint));
+        header.textureOffset = Cooked::align(header.subMeshOffset + ranges.size()   * sizeof(Cooked::SubMesh));
+        header.stringOffset  = Cooked::align(header.textureOffset + textures.size() * sizeof(Cooked::Texture));
+        header.stringSize    = strings.size();
+
+        // Write Sections, Padding With Zeros up to Each Offset
+        std::ofstream fd(PROJECT_SOURCE_DIR "/Mirage/Models/" + output, std::ios::binary);
+        auto write = [& fd](uint64_t offset, void const * data, std::size_t size)
+        {   while (uint64_t(fd.tellp()) < offset) fd.put(0);
+            fd.write((char const *) data, size);
+        };  write(0, & header, sizeof(header));
+        for (auto & mesh : meshes) write(header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+        for (auto & mesh : meshes) write(header.indexOffset,  mesh.indices.data(),  mesh.indices.size()  * sizeof(GLuint));
+        write(header.subMeshOffset, ranges.data(),   ranges.size()   * sizeof(Cooked::SubMesh));
+        write(header.textureOffset, textures.data(), textures.size() * sizeof(Cooked::Texture));
+        write(header.stringOffset,  strings.data(),  strings.size());
+        return bool(fd);
+    }
+
+    bool Mesh::read(MappedFile const & file)
+    {
+        // Validate Every Offset and Range Before Trusting Any of Them
+        if (!Cooked::validate(file)) return false;
+        auto header = file.at<Cooked::Header>(0);
+
+        // Upload Every Sub-Mesh's Data Straight From the Mapping
+        GLuint buffers[2];
+        glGenBuffers(2, buffers);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        glBufferData(GL_ARRAY_BUFFER, header->vertexCount * sizeof(Vertex),
+                     file.at<Vertex>(header->vertexOffset), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+        glBufferData(GL_COPY_WRITE_BUFFER, header->indexCount * sizeof(GLuint),
+                     file.at<GLuint>(header->indexOffset), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        // Create One Node per Range; Attribute Offsets Absorb the First Vertex
+        auto ranges   = file.at<Cooked::SubMesh>(header->subMeshOffset);
+        auto textures = file.at<Cooked::Texture>(header->textureOffset);
+        auto strings  = file.at<char>(header->stringOffset);
+        for (uint32_t i = 0; i < header->subMeshCount; i++)
+        {   std::unique_ptr<Mesh> node(new Mesh());
+            GLState::get().bindVertexArray(node->mVertexArray);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+            node->attributes(ranges[i].firstVertex * sizeof(Vertex));
+            node->mIndexCount  = GLsizei(ranges[i].indexCount);
+            node->mIndexOffset = ranges[i].firstIndex * sizeof(GLuint);
+            auto vertices = file.at<Vertex>(header->vertexOffset) + ranges[i].firstVertex;
+            for (uint32_t j = 0; j < ranges[i].vertexCount; j++) node->mBounds.add(vertices[j].position);
+            node->mSphere = boundingSphere(vertices, ranges[i].vertexCount);
+            node->mUvDensity = uvDensity(vertices, file.at<GLuint>(header->indexOffset) + ranges[i].firstIndex,
+                                         ranges[i].indexCount);
+
+            // Resolve Texture References Through the Shared Cache
+            MeshData data;
+            for (uint32_t j = 0; j < ranges[i].textureCount; j++)
+            {   auto & ref = textures[ranges[i].firstTexture + j];
+                std::string name(strings + ref.nameOffset, ref.nameLength);
+                data.textures.push_back(std::make_pair(PROJECT_SOURCE_DIR "/Mirage/Models/" + name,
+                                                       std::string(ref.mode ? "specular" : "diffuse")));
+            }   data.decode();
+            node->process(data, node->mTextures);
+            node->mMaterial = Material::build(node->mTextures);
+            mSubMeshes.push_back(std::move(node));
+        }
+
+        // The Vertex Arrays Keep the Buffers Alive
+        GLState::get().bindVertexArray(0);
+        glDeleteBuffers(2, buffers);
+        return true;
     }
 
     void Mesh::draw(GLuint shader)
+    {   std::size_t node = 0;
+        draw(shader, nullptr, node);
+    }
+
+    void Mesh::draw(GLuint shader, LodSelection const & selection)
+    {   std::size_t node = 0;
+        draw(shader, & selection, node);
+    }
+
+    void Mesh::draw(GLuint shader, LodSelection const * selection, std::size_t & node)
+    {
+        // Nodes Without Geometry Only Hold Children
+        Level level = range(selection, node++);
+        for (auto &i : mSubMeshes) i->draw(shader, selection, node);
+        if (mIndexCount == 0) return;
+
+        // Bind Textures and Vertex Array, Skipping Anything Already Bound
+        Material::samplers(shader);
+        mMaterial.bind();
+        GLState::get().bindVertexArray(mVertexArray);
+        glDrawElements(GL_TRIANGLES, level.count, mIndexType, (GLvoid *) level.offset);
+    }
+
+    void Mesh::draw(RenderQueue & queue, GLuint shader, glm::mat4 const & model)
+    {   std::size_t node = 0;
+        draw(queue, shader, model, nullptr, node);
+    }
+
+    void Mesh::draw(RenderQueue & queue, GLuint shader, glm::mat4 const & model, LodSelection const & selection)
+    {   std::size_t node = 0;
+        draw(queue, shader, model, & selection, node);
+    }
+
+    void Mesh::draw(RenderQueue & queue, GLuint shader, glm::mat4 const & model,
+                    LodSelection const * selection, std::size_t & node)
+    {
+        Level level = range(selection, node++);
+        for (auto &i : mSubMeshes) i->draw(queue, shader, model, selection, node);
+        if (mIndexCount > 0)
+            queue.push(shader, mMaterial, mVertexArray, level.count, mIndexType, level.offset, model * mUnpack);
+    }
+
+    void Mesh::draw(CommandBuffer & buffer, GLuint shader, glm::mat4 const & model)
+    {   std::size_t node = 0;
+        draw(buffer, shader, model, nullptr, node);
+    }
+
+    void Mesh::draw(CommandBuffer & buffer, GLuint shader, glm::mat4 const & model, LodSelection const & selection)
+    {   std::size_t node = 0;
+        draw(buffer, shader, model, & selection, node);
+    }
+
+    void Mesh::draw(CommandBuffer & buffer, GLuint shader, glm::mat4 const & model,
+                    LodSelection const * selection, std::size_t & node)
+    {
+        // Reads Only, so Threads May Record Different Meshes at Once
+        Level level = range(selection, node++);
+        for (auto &i : mSubMeshes) i->draw(buffer, shader, model, selection, node);
+        if (mIndexCount > 0)
+            buffer.draw(shader, mMaterial, mVertexArray, level.count, mIndexType, level.offset, model * mUnpack);
+    }
+
+    Mesh::Level Mesh::range(LodSelection const * selection, std::size_t node) const
+    {
+        // Nodes Read From a Cooked File Have One Range and No Level List
+        unsigned level = selection && node < selection->levels.size() ? selection->levels[node] : mLevel;
+        if (level < mLevels.size()) return mLevels[level];
+        Level whole = { mIndexCount, mIndexOffset, 0.0f };
+        return whole;
+    }
+
+    void Mesh::select(LodView const & view, glm::mat4 const & model)
+    {
+        for (auto &i : mSubMeshes) i->select(view, model);
+        pick(view, model, mLevel, nullptr);
+    }
+
+    void Mesh::select(LodView const & view, glm::mat4 const & model, LodSelection & selection) const
+    {   std::size_t node = 0;
+        selection.textures.clear();
+        select(view, model, selection, node);
+    }
+
+    void LodSelection::request() const
     {
-        unsigned int unit = 0, diffuse = 0, specular = 0;
-        for (auto &i : mSubMeshes) i->draw(shader);
-        for (auto &i : mTextures)
-        {   // Set Correct Uniform Names Using Texture Type (Omit ID for 0th Texture)
-            std::string uniform = i.second;
-                 if (i.second == "diffuse")  uniform += (diffuse++  > 0) ? std::to_string(diffuse)  : "";
-            else if (i.second == "specular") uniform += (specular++ > 0) ? std::to_string(specular) : "";
+        auto & residency = TextureResidency::get();
+        for (auto & texture : textures) residency.request(texture.first, texture.second);
+    }
+
+    void Mesh::select(LodView const & view, glm::mat4 const & model, LodSelection & selection, std::size_t & node) const
+    {
+        // New Copies Start at Full Detail
+        if (selection.levels.size() <= node) selection.levels.resize(node + 1, 0);
+        pick(view, model, selection.levels[node], & selection);
+        node++;
+        for (auto &i : mSubMeshes) i->select(view, model, selection, node);
+    }
+
+    void Mesh::pick(LodView const & view, glm::mat4 const & model, unsigned & level, LodSelection * selection) const
+    {
+        if (mIndexCount == 0) return;
+
+        // Distance to the Bounding Sphere; Errors Scale With the Model
+        float scale = std::sqrt(std::max(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                                std::max(glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                                         glm::dot(glm::vec3(model[2]), glm::vec3(model[2])))));
+        glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(mSphere), 1.0f));
+        float distance = glm::length(center - view.camera) - mSphere.w * scale;
+
+        // The Nearest Point Samples Its Textures Most Finely: One Pixel There
+        // Spans This Many UV Units, Taking the Texture Level it Asks For.
+        // Selections Keep the Requests, Since Workers Must Not Post Them.
+        auto & residency = TextureResidency::get();
+        if (residency.enabled() && mUvDensity > 0.0f)
+        {   float uvPerPixel = mUvDensity / view.pixels(scale, std::max(distance, 1e-2f));
+            for (auto & texture : mTextureRefs)
+                if (selection) selection->textures.push_back(std::make_pair(texture->id(), uvPerPixel));
+                else residency.request(texture->id(), uvPerPixel);
+        }
+        if (mLevels.size() < 2) return;
+
+        // Refine While the Current Level is Clearly Too Coarse, Else Coarsen
+        // While the Next Level is Clearly Fine Enough
+        auto pixels = [&](unsigned i) { return view.pixels(mLevels[i].error * scale, distance); };
+        level = std::min<unsigned>(level, unsigned(mLevels.size() - 1));
+        while (level > 0 && pixels(level) > view.threshold * (1.0f + view.hysteresis)) level--;
+        while (level + 1 < mLevels.size() && pixels(level + 1) < view.threshold * (1.0f - view.hysteresis)) level++;
+    }
+
+    Bounds Mesh::bounds() const
+    {
+        Bounds bounds = mBounds;
+        for (auto &i : mSubMeshes) bounds.add(i->bounds());
+        return bounds;
+    }
+
+    void Mesh::draw(InstanceBatch & batch, glm::mat4 const & model, glm::vec4 const & tint, GLuint id)
+    {
+        InstanceBatch::Instance instance = { model * mUnpack, tint, id, { 0, 0, 0 } };
+        batch.add(*this, instance);
+    }
 
-            // Bind Correct Textures and Vertex Array Before Drawing
-            glActiveTexture(GL_TEXTURE0 + unit);
-            glBindTexture(GL_TEXTURE_2D, i.first);
-            glUniform1f(glGetUniformLocation(shader, uniform.c_str()), ++unit);
-        }   glBindVertexArray(mVertexArray);
-            glDrawElements(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0);
+    void Mesh::draw(MeshArena & arena, glm::mat4 const & model)
+    {
+        for (auto & i : mSubMeshes) i->draw(arena, model);
+        for (auto & i : mRanges) arena.draw(i.first, i.second, model);
     }
 
-    void Mesh::parse(std::string const & path, aiNode const * node, aiScene const * scene)
+    void Mesh::parse(std::string const & path, aiNode const * node, aiScene const * scene,
+                     std::function<void(MeshData &&)> const & emit)
     {
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
-            parse(path, scene->mMeshes[node->mMeshes[i]], scene);
+            emit(parse(path, scene->mMeshes[node->mMeshes[i]], scene));
         for (unsigned int i = 0; i < node->mNumChildren; i++)
-            parse(path, node->mChildren[i], scene);
+            parse(path, node->mChildren[i], scene, emit);
     }
 
-    void Mesh::parse(std::string const & path, aiMesh const * mesh, aiScene const * scene)
+    MeshData Mesh::parse(std::string const & path, aiMesh const * mesh, aiScene const * scene)
     {
         // Create Vertex Data from Mesh Node
-        std::vector<Vertex> vertices; Vertex vertex;
+        MeshData data; Vertex vertex;
+        data.vertices.reserve(mesh->mNumVertices);
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {   if (mesh->mTextureCoords[0])
             vertex.uv       = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
             vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
             vertex.normal   = glm::vec3(mesh->mNormals[i].x,  mesh->mNormals[i].y,  mesh->mNormals[i].z);
-            vertices.push_back(vertex);
+            data.vertices.push_back(vertex);
         }
 
-        // Create Mesh Indices for Indexed Drawing
-        std::vector<GLuint> indices;
+        // Bound the Sub-Mesh for Culling and Detail Selection
+        data.bounds.add(data.vertices);
+        data.sphere = boundingSphere(data.vertices.data(), data.vertices.size());
+
+        // Create Mesh Indices for Indexed Drawing; Triangulated, so Three per Face
+        data.indices.reserve(std::size_t(mesh->mNumFaces) * 3);
         for (unsigned int i = 0; i < mesh->mNumFaces; i++)
         for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++)
-            indices.push_back(mesh->mFaces[i].mIndices[j]);
+            data.indices.push_back(mesh->mFaces[i].mIndices[j]);
 
-        // Load Mesh Textures into VRAM
-        std::map<GLuint, std::string> textures;
-        auto diffuse  = process(path, scene->mMaterials[mesh->mMaterialIndex], aiTextureType_DIFFUSE);
-        auto specular = process(path, scene->mMaterials[mesh->mMaterialIndex], aiTextureType_SPECULAR);
-        textures.insert(diffuse.begin(), diffuse.end());
-        textures.insert(specular.begin(), specular.end());
+        // Collect Texture Filenames; Images are Loaded When the Mesh is Uploaded
+        aiMaterial const * material = scene->mMaterials[mesh->mMaterialIndex];
+        std::pair<aiTextureType, std::string> const types[] = {
+            std::make_pair(aiTextureType_DIFFUSE,  std::string("diffuse")),
+            std::make_pair(aiTextureType_SPECULAR, std::string("specular")) };
+        for (auto & type : types)
+        for (unsigned int i = 0; i < material->GetTextureCount(type.first); i++)
+        {   aiString str; material->GetTexture(type.first, i, & str);
+            std::string filename = PROJECT_SOURCE_DIR "/Mirage/Models/" + path + "/" + str.C_Str();
+            data.textures.push_back(std::make_pair(filename, type.second));
+        }   return data;
+    }
 
-        // Create New Mesh Node
-        mSubMeshes.push_back(std::unique_ptr<Mesh>(new Mesh(vertices, indices, textures)));
+    void Mesh::process(MeshData const & data, TextureSet & textures)
+    {
+        // Share Textures Through the Cache; Refs Keep the GL Textures Alive
+        auto & cache = TextureCache::get();
+        textures.reserve(textures.size() + data.images.size());
+        for (std::size_t i = 0; i < data.images.size(); i++)
+        {   auto key = cache.key(data.textures[i].first, TextureOptions());
+            auto texture = cache.acquire(key, data.images[i]);
+            if (!texture) continue;
+            auto at = std::lower_bound(textures.begin(), textures.end(), texture->id(),
+                [](std::pair<GLuint, std::string> const & entry, GLuint id) { return entry.first < id; });
+            if (at == textures.end() || at->first != texture->id())
+                textures.insert(at, std::make_pair(texture->id(), data.textures[i].second));
+            mTextureRefs.push_back(texture);
+        }
     }
 
-    std::map<GLuint, std::string> Mesh::process(std::string const & path,
-                                                aiMaterial * material,
-                                                aiTextureType type)
+    Material Material::build(TextureSet const & textures)
     {
-        std::map<GLuint, std::string> textures;
-        for(unsigned int i = 0; i < material->GetTextureCount(type); i++)
-        {
-            // Define Some Local Variables
-            GLenum format;
-            GLuint texture;
-            std::string mode;
-
-            // Load the Texture Image from File
-            aiString str; material->GetTexture(type, i, & str);
-            std::string filename = str.C_Str(); int width, height, channels;
-            filename = PROJECT_SOURCE_DIR "/Mirage/Models/" + path + "/" + filename;
-            unsigned char * image = stbi_load(filename.c_str(), & width, & height, & channels, 0);
-            if (!image) fprintf(stderr, "%s %s\n", "Failed to Load Texture", filename.c_str());
-
-            // Set the Correct Channel Format
-            switch (channels)
-            {
-                case 1 : format = GL_ALPHA;     break;
-                case 2 : format = GL_LUMINANCE; break;
-                case 3 : format = GL_RGB;       break;
-                case 4 : format = GL_RGBA;      break;
-            }
-
-            // Bind Texture and Set Filtering Levels
-            glGenTextures(1, & texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexImage2D(GL_TEXTURE_2D, 0, format,
-                         width, height, 0, format, GL_UNSIGNED_BYTE, image);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            // Release Image Pointer and Store the Texture
-            stbi_image_free(image);
-                 if (type == aiTextureType_DIFFUSE)  mode = "diffuse";
-            else if (type == aiTextureType_SPECULAR) mode = "specular";
-            textures.insert(std::make_pair(texture, mode));
-        }   return textures;
+        // Place Each Texture on the Unit Reserved for its Name
+        Material material; unsigned int diffuse = 0, specular = 0;
+        for (auto & i : textures)
+        {        if (i.second == "diffuse"  && diffuse  < 8) material.textures.push_back(std::make_pair(    diffuse++,  i.first));
+            else if (i.second == "specular" && specular < 8) material.textures.push_back(std::make_pair(8 + specular++, i.first));
+            else fprintf(stderr, "%s %s\n", "Too Many Textures of Type", i.second.c_str());
+        }
+
+        // Intern the Texture Set so Identical Sets Sort Together
+        static std::map<std::vector<std::pair<GLuint, GLuint>>, GLuint> ids;
+        auto it = ids.insert(std::make_pair(material.textures, GLuint(ids.size() + 1))).first;
+        material.id = it->second;
+        return material;
+    }
+
+    void Material::samplers(GLuint shader)
+    {
+        // Runs Once per Program. glUniform Writes the Bound Program, so Bind
+        // This One First; Callers Draw With it Next Anyway
+        if (!GLState::get().configure(shader)) return;
+        GLState::get().useProgram(shader);
+        static char const * const diffuse[]  = { "diffuse",  "diffuse2",  "diffuse3",  "diffuse4",
+                                                 "diffuse5", "diffuse6",  "diffuse7",  "diffuse8" };
+        static char const * const specular[] = { "specular",  "specular2", "specular3", "specular4",
+                                                 "specular5", "specular6", "specular7", "specular8" };
+        for (int i = 0; i < 8; i++)
+        {   glUniform1i(glGetUniformLocation(shader, diffuse[i]),  i);
+            glUniform1i(glGetUniformLocation(shader, specular[i]), 8 + i);
+        }
+    }
+
+    void Material::bind() const
+    {
+        for (auto & i : textures) GLState::get().bindTexture(i.first, GL_TEXTURE_2D, i.second);
     }
 };
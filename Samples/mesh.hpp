@@ -7,19 +7,94 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+// Local Headers
+#include "GLState.hpp"
+#include "Memory.hpp"
+#include "optimize.hpp"
+#include "scene.hpp"
+#include "texture.hpp"
+#include "vertex.hpp"
+
 // Standard Headers
-#include <map>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 // Define Namespace
 namespace Mirage
 {
-    // Vertex Format
-    struct Vertex {
-        glm::vec3 position;
-        glm::vec3 normal;
-        glm::vec2 uv;
+    // Forward Declarations
+    class CollisionMesh;
+    class CommandBuffer;
+    class MappedFile;
+    class InstanceBatch;
+    class MeshArena;
+    class RenderQueue;
+
+    // CPU-Side Sub-Mesh; Built Without a GL Context and Uploaded Later
+    struct MeshData {
+        void decode(); // Decode Any Texture Images Not Yet Loaded
+
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        std::vector<std::pair<std::string, std::string>> textures; // Filename, Mode
+        std::vector<Image> images; // Decoded Textures, Empty if Already Resident
+        std::vector<Lod> lods;     // Coarser Detail Levels, Finest First
+        Bounds    bounds;
+        glm::vec4 sphere;          // Center, Radius
+    };
+
+    // Texture Names Paired With "diffuse" or "specular", Sorted by Name and
+    // Held in One Block Rather Than a Tree Node per Texture
+    typedef std::vector<std::pair<GLuint, std::string>> TextureSet;
+
+    // Texture Bindings on Fixed Units, so Sampler Uniforms are Set Once per
+    // Program: "diffuseN" Samples Unit N - 1 and "specularN" Unit 8 + N - 1
+    struct Material {
+        static Material build(TextureSet const & textures);
+        static void samplers(GLuint shader);
+        void bind() const;
+
+        GLuint id = 0; // Equal for Identical Texture Sets
+        std::vector<std::pair<GLuint, GLuint>> textures; // Unit, Texture
+    };
+
+    // Location of a Sub-Mesh Inside a Shared MeshArena
+    struct MeshRange {
+        GLint  baseVertex;
+        GLuint firstIndex;
+        GLuint indexCount;
+        GLuint vertexCount;
+        glm::vec4 sphere; // Center, Radius; Used for GPU Culling
+    };
+
+    // Camera Terms for Picking Detail Levels by Projected Error: the Coarsest
+    // Level Whose Error Covers Less Than threshold Pixels is Used, and Levels
+    // Only Change Once the Error Crosses the Threshold by the Hysteresis
+    // Fraction, so Meshes Near a Boundary Do Not Pop Back and Forth.
+    struct LodView {
+        LodView(glm::vec3 const & eye, float fovy, float height, float pixels = 1.0f, float band = 0.25f)
+            : camera(eye), projection(height / (2.0f * std::tan(fovy * 0.5f))), threshold(pixels), hysteresis(band) {}
+        float pixels(float error, float distance) const { return error * projection / std::max(distance, 1e-4f); }
+
+        glm::vec3 camera;
+        float projection; // Pixels per Unit at Distance One
+        float threshold;
+        float hysteresis;
+    };
+
+    // Detail Levels Picked for One Drawn Copy of a Mesh, One per Node in
+    // Depth-First Order; Each Copy Keeps its Own so Hysteresis Holds per Copy.
+    // Texture Requests are Collected Rather Than Sent, so Selections may be
+    // Made on Workers; request() Posts Them, on the GL Thread Only.
+    struct LodSelection {
+        std::vector<unsigned> levels;
+        std::vector<std::pair<GLuint, float>> textures; // Texture, UV Units per Pixel
+        void request() const;
     };
 
     class Mesh
@@ -27,41 +102,148 @@ namespace Mirage
     public:
 
         // Implement Default Constructor and Destructor
-         Mesh() { glGenVertexArrays(1, & mVertexArray); }
-        ~Mesh() { glDeleteVertexArrays(1, & mVertexArray); }
+         Mesh() : mSphere(0.0f), mFormat(VertexFormat::Float), mUnpack(1.0f)
+                , mIndexType(GL_UNSIGNED_INT), mIndexCount(0), mIndexOffset(0), mLevel(0), mUvDensity(0.0f)
+         { glGenVertexArrays(1, & mVertexArray); }
+        ~Mesh() { GLState::get().deleteVertexArray(mVertexArray); }
 
-        // Implement Custom Constructors
-        Mesh(std::string const & filename);
+        // Implement Custom Constructors. Packed Formats Store Positions
+        // Inside the Bounds (Computed From the Vertices if Empty); Sub-Meshes
+        // of a Model Loaded From File Share the Bounds of the Whole Model.
+        Mesh(std::string const & filename, VertexFormat format = VertexFormat::Float);
+        Mesh(MeshData const & data, VertexFormat format = VertexFormat::Float, Bounds const & bounds = Bounds());
         Mesh(std::vector<Vertex> const & vertices,
              std::vector<GLuint> const & indices,
-             std::map<GLuint, std::string> const & textures);
+             TextureSet const & textures,
+             VertexFormat format = VertexFormat::Float, Bounds const & bounds = Bounds(),
+             std::vector<Lod> const & lods = std::vector<Lod>());
+
+        // Suballocate Every Sub-Mesh Into a Shared Arena Instead of Per-Node
+        // Buffers; Such Meshes are Drawn by Queueing Them on the Arena
+        Mesh(std::string const & filename, MeshArena & arena);
+
+        // Keep the Model's Node Hierarchy: Every Assimp Node Becomes a Scene
+        // Node Under parent, With its Transform, and Each Sub-Mesh is Attached
+        // to Every Node Using it. Draw Through the Scene, Not This Mesh.
+        Mesh(std::string const & filename, Scene & scene, Scene::Node parent = Scene::None);
+
+        // Nodes Come From a Shared Pool Rather Than the General Heap
+        static void * operator new(std::size_t size);
+        static void operator delete(void * pointer, std::size_t size);
 
         // Public Member Functions
         void draw(GLuint shader);
+        void draw(MeshArena & arena, glm::mat4 const & model);
+        void draw(RenderQueue & queue, GLuint shader, glm::mat4 const & model);
+        void draw(CommandBuffer & buffer, GLuint shader, glm::mat4 const & model);
+        void draw(InstanceBatch & batch, glm::mat4 const & model,
+                  glm::vec4 const & tint = glm::vec4(1.0f), GLuint id = 0);
+        void draw(GLuint shader, LodSelection const & selection);
+        void draw(RenderQueue & queue, GLuint shader, glm::mat4 const & model, LodSelection const & selection);
+        void draw(CommandBuffer & buffer, GLuint shader, glm::mat4 const & model, LodSelection const & selection);
+
+        // Pick Each Sub-Mesh's Detail Level From the Same Model Matrix the
+        // Draws Use, Starting From the Levels Picked Last Time. Without a
+        // Selection the Levels are Kept on the Mesh for Draws and Instance
+        // Batches Without One, so That Suits a Mesh Drawn Once per Frame;
+        // Copies Drawn With Different Matrices Each Need Their Own Selection.
+        // While TextureResidency is Enabled, This Also Requests Texture Levels;
+        // Without a Selection That Happens at Once, so Only on the GL Thread.
+        void select(LodView const & view, glm::mat4 const & model);
+        void select(LodView const & view, glm::mat4 const & model, LodSelection & selection) const;
+        unsigned level() const { return mLevel; }
+
+        // Model-Space Box Around Every Sub-Mesh, and This Node's Own Sphere
+        Bounds bounds() const;
+        glm::vec4 const & sphere() const { return mSphere; }
+
+        // Maps Packed Positions Back to Model Space; Multiply it Into the Model
+        // Matrix When Drawing Directly. Identity for VertexFormat::Float.
+        glm::mat4 const & unpack() const { return mUnpack; }
+        VertexFormat format() const { return mFormat; }
+
+        // Set Vertex Attribute Pointers for the Bound Vertex Buffer of Vertex
+        static void attributes(std::size_t offset) { FloatVertex::attributes(offset); }
+
+        // Import a Model and Emit Each Sub-Mesh, Reordered for the Vertex Cache
+        // and Overdraw (See optimize.hpp); Makes No GL Calls, so it is Safe to
+        // Run on a Worker Thread. Returns False if Assimp Fails.
+        static bool import(std::string const & filename,
+                           std::function<void(MeshData &&)> const & emit,
+                           OptimizeOptions const & options = OptimizeOptions());
+
+        // Import Without Flattening the Node Graph: Nodes are Added to scene
+        // in Topological Order, and Each Mesh is Emitted Once Along With the
+        // Nodes That Reference it
+        static bool import(std::string const & filename, Scene & scene, Scene::Node parent,
+                           std::function<void(MeshData &&, std::vector<Scene::Node> const &)> const & emit,
+                           OptimizeOptions const & options = OptimizeOptions());
+
+        // Import a Model Offline and Write it in the Cooked Format (See cooked.hpp),
+        // Which Mesh(filename) Loads Directly When the Name Ends in ".mesh".
+        // Its Textures are Cooked to KTX2 Beside Their Sources (See ktx.hpp).
+        static bool cook(std::string const & filename, std::string const & output,
+                         OptimizeOptions const & options = OptimizeOptions(),
+                         CompressOptions const & compression = CompressOptions());
 
     private:
 
         // Disable Copying and Assignment
         Mesh(Mesh const &) = delete;
         Mesh & operator=(Mesh const &) = delete;
+        friend class CollisionMesh;
+        friend class InstanceBatch;
+        friend class Loader;
 
         // Private Member Functions
-        void parse(std::string const & path, aiNode const * node, aiScene const * scene);
-        void parse(std::string const & path, aiMesh const * mesh, aiScene const * scene);
-        std::map<GLuint, std::string> process(std::string const & path,
-                                              aiMaterial * material,
-                                              aiTextureType type);
+        static PoolAllocator & pool();
+        bool read(MappedFile const & file);
+        static void parse(std::string const & path, aiNode const * node, aiScene const * scene,
+                          std::function<void(MeshData &&)> const & emit);
+        static MeshData parse(std::string const & path, aiMesh const * mesh, aiScene const * scene);
+        static void refine(std::string const & filename, OptimizeOptions const & options, MeshData & data);
+        void process(MeshData const & data, TextureSet & textures);
+
+        // One Detail Level in the Element Buffer
+        struct Level {
+            GLsizei     count;
+            std::size_t offset;
+            float       error;
+        };
+
+        // Walk the Nodes in Selection Order; Without a Selection, Nodes Use mLevel
+        void pick(LodView const & view, glm::mat4 const & model, unsigned & level, LodSelection * selection) const;
+        void select(LodView const & view, glm::mat4 const & model, LodSelection & selection, std::size_t & node) const;
+        void draw(GLuint shader, LodSelection const * selection, std::size_t & node);
+        void draw(RenderQueue & queue, GLuint shader, glm::mat4 const & model,
+                  LodSelection const * selection, std::size_t & node);
+        void draw(CommandBuffer & buffer, GLuint shader, glm::mat4 const & model,
+                  LodSelection const * selection, std::size_t & node);
+        Level range(LodSelection const * selection, std::size_t node) const;
 
         // Private Member Containers
         std::vector<std::unique_ptr<Mesh>> mSubMeshes;
+        std::vector<Level> mLevels;
         std::vector<GLuint> mIndices;
         std::vector<Vertex> mVertices;
-        std::map<GLuint, std::string> mTextures;
+        TextureSet mTextures;
+        Material mMaterial;
+        Bounds mBounds;
+        glm::vec4 mSphere;
+        VertexFormat mFormat;
+        glm::mat4 mUnpack;
+        std::vector<std::shared_ptr<Texture>> mTextureRefs;
+        std::vector<std::pair<MeshRange, GLuint>> mRanges; // Arena Range, Material
 
         // Private Member Variables
         GLuint mVertexArray;
         GLuint mVertexBuffer;
         GLuint mElementBuffer;
+        GLenum  mIndexType; // GL_UNSIGNED_SHORT for Sub-Meshes Under 64k Vertices
+        GLsizei mIndexCount;
+        std::size_t mIndexOffset;
+        unsigned    mLevel;
+        float       mUvDensity; // UV Units per Model Unit, for Texture Requests
 
     };
 };
@@ -0,0 +1,143 @@
+// Local Headers
+#include "occlusion.hpp"
+#include "GLState.hpp"
+
+// System Headers
+#include <glm/gtc/matrix_transform.hpp>
+
+// Define Namespace
+namespace Mirage
+{
+    Occlusion::Occlusion(unsigned interval)
+        : mViewProjection(1.0f), mInterval(interval > 0 ? interval : 1), mFrame(0), mHidden(0)
+    {
+        mShader.attach("box.vert", PROJECT_SOURCE_DIR "/Glitter/Shaders/")
+               .attach("box.frag", PROJECT_SOURCE_DIR "/Glitter/Shaders/").link();
+        mTransform = mShader.uniform("transform");
+
+        // Conservative Queries May Over-Report, Which Only Costs a Draw
+        mTarget = GLAD_GL_VERSION_4_3 ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+        // Unit Cube; Corner i Has x, y, z Taken From Bits 0, 1, 2 of i
+        GLfloat corners[24];
+        for (int i = 0; i < 8; i++)
+        {   corners[i * 3 + 0] = GLfloat(i & 1);
+            corners[i * 3 + 1] = GLfloat((i >> 1) & 1);
+            corners[i * 3 + 2] = GLfloat((i >> 2) & 1);
+        }
+        GLubyte const faces[] = { 0, 6, 2, 0, 4, 6, 1, 3, 7, 1, 7, 5, 0, 1, 5, 0, 5, 4,
+                                  2, 7, 3, 2, 6, 7, 0, 3, 1, 0, 2, 3, 4, 5, 7, 4, 7, 6 };
+        glGenVertexArrays(1, & mVertexArray);
+        GLState::get().bindVertexArray(mVertexArray);
+        glGenBuffers(1, & mVertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid *) 0);
+        glEnableVertexAttribArray(0);
+        glGenBuffers(1, & mElementBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+        GLState::get().bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    Occlusion::~Occlusion()
+    {
+        for (auto & object : mObjects)
+            if (object.live) glDeleteQueries(1, & object.query);
+        GLuint buffers[] = { mVertexBuffer, mElementBuffer };
+        glDeleteBuffers(2, buffers);
+        GLState::get().deleteVertexArray(mVertexArray);
+    }
+
+    Occlusion::Handle Occlusion::insert()
+    {
+        // New Objects Start Visible, so They Draw Before Their First Answer
+        Object object = { 0, false, false, true };
+        glGenQueries(1, & object.query);
+        if (!mFree.empty())
+        {   Handle handle = mFree.back();
+            mFree.pop_back();
+            mObjects[handle] = object;
+            return handle;
+        }   mObjects.push_back(object);
+        return Handle(mObjects.size() - 1);
+    }
+
+    void Occlusion::remove(Handle handle)
+    {
+        // A Stale Handle's Query Name and Slot May Already Belong to Another
+        // Object, so Removing Twice Must Not Free Them Again
+        if (handle >= mObjects.size() || !mObjects[handle].live) return;
+        Object & object = mObjects[handle];
+        glDeleteQueries(1, & object.query);
+        object.live = false;
+        mFree.push_back(handle);
+    }
+
+    void Occlusion::frame(glm::mat4 const & viewProjection)
+    {
+        mViewProjection = viewProjection;
+        mFrame++;
+
+        // Read Whatever Results Have Arrived; Anything Else Waits a Frame
+        mHidden = 0;
+        for (auto & object : mObjects)
+        {   if (!object.live) continue;
+            if (object.pending)
+            {   GLuint available = 0, samples = 0;
+                glGetQueryObjectuiv(object.query, GL_QUERY_RESULT_AVAILABLE, & available);
+                if (available)
+                {   glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, & samples);
+                    object.hidden  = samples == 0;
+                    object.pending = false;
+                }
+            }   if (object.hidden) mHidden++;
+        }
+    }
+
+    bool Occlusion::begin(Handle handle, Bounds const & box)
+    {
+        Object & object = mObjects[handle];
+
+        // A Box Reaching Past the Near Plane Would be Clipped Open; Draw it
+        glm::mat4 transform = mViewProjection * glm::scale(glm::translate(glm::mat4(1.0f), box.min), box.max - box.min);
+        for (int i = 0; i < 8; i++)
+        {   glm::vec4 clip = transform * glm::vec4(GLfloat(i & 1), GLfloat((i >> 1) & 1), GLfloat((i >> 2) & 1), 1.0f);
+            if (clip.z < -clip.w)
+            {   object.hidden = false;
+                return false;
+            }
+        }
+
+        // Visible Objects Re-Test on Their Own Frame of Each Interval; the Box
+        // Goes First, so the Object's Own Depth Cannot Make it Pass
+        if (!object.hidden)
+        {   if (!object.pending && (mFrame + handle) % mInterval == 0) query(object, transform);
+            return false;
+        }
+
+        // Hidden Objects Test Every Frame, and the GPU Skips the Draw Itself
+        query(object, transform);
+        glBeginConditionalRender(object.query, GL_QUERY_NO_WAIT);
+        return true;
+    }
+
+    void Occlusion::query(Object & object, glm::mat4 const & transform)
+    {
+        // Test Against Depth Without Writing Anything, Then Restore the Caller's Program
+        GLuint program = GLState::get().program();
+        mShader.activate();
+        mShader.bind(mTransform, transform);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        GLState::get().bindVertexArray(mVertexArray);
+        glBeginQuery(mTarget, object.query);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, (GLvoid *) 0);
+        glEndQuery(mTarget);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+        GLState::get().useProgram(program);
+        object.pending = true;
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+// Local Headers
+#include "shader.hpp"
+#include "vertex.hpp"
+
+// System Headers
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Hardware Occlusion Culling for Whole Mesh Sub-Trees. Objects Last Seen
+    // Visible are Drawn Outright, Re-Testing Their Box Once Every Few Frames
+    // (Staggered so Tests Spread Evenly) and Reading the Answer a Frame or
+    // More Later. Objects Last Seen Hidden Draw Their Box Under a Query and
+    // Then Render Conditionally on it With GL_QUERY_NO_WAIT, so the GPU Skips
+    // Them Without the CPU Ever Waiting. Draw Large Occluders First, Front
+    // to Back, so Later Boxes Have Depth to Fail Against:
+    //
+    //     occlusion.frame(projection * view);
+    //     occlusion.draw(handle, mesh.bounds().transformed(model), [&] {
+    //         shader.bind("model", model); mesh.draw(shader.get()); });
+    class Occlusion
+    {
+    public:
+
+        typedef std::uint32_t Handle;
+
+        // Implement Custom Constructor and Destructor
+        Occlusion(unsigned interval = 8);
+        ~Occlusion();
+
+        // Public Member Functions
+        Handle insert();
+        void   remove(Handle handle); // Ignores Handles Already Removed
+        void   frame(glm::mat4 const & viewProjection);
+        template<typename F> void draw(Handle handle, Bounds const & box, F && render)
+        {
+            bool conditional = begin(handle, box);
+            render();
+            if (conditional) glEndConditionalRender();
+        }
+
+        // Objects Whose Latest Result Found Them Hidden
+        std::size_t hidden() const { return mHidden; }
+
+    private:
+
+        // Disable Copying and Assignment
+        Occlusion(Occlusion const &) = delete;
+        Occlusion & operator=(Occlusion const &) = delete;
+
+        struct Object {
+            GLuint   query;
+            bool     hidden;   // Latest Result Was Zero Samples
+            bool     pending;  // Query Issued But Not Yet Read
+            bool     live;
+        };
+
+        // Private Member Functions
+        bool begin(Handle handle, Bounds const & box);
+        void query(Object & object, glm::mat4 const & transform);
+
+        // Private Member Containers
+        std::vector<Object> mObjects;
+        std::vector<Handle> mFree;
+
+        // Private Member Variables
+        Shader mShader;
+        GLint  mTransform;
+        GLuint mVertexArray;
+        GLuint mVertexBuffer;
+        GLuint mElementBuffer;
+        GLenum mTarget;
+        glm::mat4 mViewProjection;
+        unsigned mInterval;
+        unsigned mFrame;
+        std::size_t mHidden;
+
+    };
+};
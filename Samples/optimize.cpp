@@ -0,0 +1,359 @@
+// Local Headers
+#include "optimize.hpp"
+
+// Standard Headers
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <numeric>
+#include <tuple>
+
+// Define Namespace
+namespace Mirage
+{
+    // Forsyth's Scoring Constants
+    static float const cacheDecayPower   = 1.5f;
+    static float const lastTriangleScore = 0.75f;
+    static float const valenceBoostScale = 2.0f;
+    static float const valenceBoostPower = 0.5f;
+
+    static float score(int position, unsigned remaining, unsigned cacheSize)
+    {
+        // Vertices With No Triangles Left Should Never Attract Work
+        if (remaining == 0) return -1.0f;
+        float value = 0.0f;
+        if (position >= 0)
+        {   if (position < 3) value = lastTriangleScore;
+            else value = std::pow(1.0f - float(position - 3) / float(cacheSize - 3), cacheDecayPower);
+        }   // Boost Vertices With Few Triangles Left so They Finish Early
+        return value + valenceBoostScale * std::pow(float(remaining), -valenceBoostPower);
+    }
+
+    CacheStats analyze(std::vector<GLuint> const & indices, std::size_t vertexCount, unsigned cacheSize)
+    {
+        // A Vertex Hits if it Was Transformed Within the Last cacheSize Misses
+        std::vector<unsigned> stamps(vertexCount, 0);
+        unsigned time = cacheSize + 1, misses = 0, used = 0;
+        for (GLuint index : indices)
+        {   if (stamps[index] == 0) used++;
+            if (time - stamps[index] > cacheSize)
+            {   stamps[index] = time++;
+                misses++;
+            }
+        }
+
+        CacheStats stats;
+        if (indices.empty()) return stats;
+        stats.acmr = float(misses) / float(indices.size() / 3);
+        stats.atvr = float(misses) / float(used);
+        return stats;
+    }
+
+    void optimizeVertexCache(std::vector<GLuint> & indices, std::size_t vertexCount, unsigned cacheSize)
+    {
+        std::size_t const triangles = indices.size() / 3;
+        if (triangles == 0 || cacheSize < 4) return;
+
+        // Build Vertex to Triangle Adjacency; remaining[v] Entries Stay Live
+        std::vector<unsigned> remaining(vertexCount, 0), offsets(vertexCount + 1, 0);
+        for (GLuint index : indices) remaining[index]++;
+        for (std::size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+        std::vector<unsigned> adjacency(indices.size()), fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t t = 0; t < triangles; t++)
+        for (std::size_t k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = unsigned(t);
+
+        // Initial Scores
+        std::vector<int>   positions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        std::vector<float> triangleScores(triangles);
+        std::vector<bool>  emitted(triangles, false);
+        for (std::size_t v = 0; v < vertexCount; v++) vertexScores[v] = score(-1, remaining[v], cacheSize);
+        for (std::size_t t = 0; t < triangles; t++)
+            triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+        std::vector<GLuint> output, cache, next;
+        output.reserve(indices.size());
+        std::size_t best = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+        std::size_t cursor = 0;
+        while (output.size() < indices.size())
+        {
+            // Nothing Useful in the Cache; Restart From the Next Unemitted Triangle
+            if (best == triangles)
+            {   while (emitted[cursor]) cursor++;
+                best = cursor;
+            }
+
+            // Emit the Triangle and Retire it From its Vertices' Adjacency
+            emitted[best] = true;
+            next.clear();
+            for (std::size_t k = 0; k < 3; k++)
+            {   GLuint v = indices[best * 3 + k];
+                output.push_back(v);
+                next.push_back(v);
+                unsigned * begin = & adjacency[offsets[v]], * end = begin + remaining[v];
+                std::swap(* std::find(begin, end, unsigned(best)), * (end - 1));
+                remaining[v]--;
+            }
+
+            // Move its Vertices to the Front of the Cache; Some Fall Off the End
+            for (GLuint v : cache)
+                if (v != next[0] && v != next[1] && v != next[2]) next.push_back(v);
+            for (std::size_t i = 0; i < next.size(); i++)
+            {   positions[next[i]] = i < cacheSize ? int(i) : -1;
+                vertexScores[next[i]] = score(positions[next[i]], remaining[next[i]], cacheSize);
+            }   if (next.size() > cacheSize) next.resize(cacheSize);
+            cache.swap(next);
+
+            // Rescore Triangles Touching the Cache and Pick the Best
+            best = triangles; float highest = -1.0f;
+            for (GLuint v : cache)
+            for (unsigned i = offsets[v]; i < offsets[v] + remaining[v]; i++)
+            {   unsigned t = adjacency[i];
+                float value = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                triangleScores[t] = value;
+                if (value > highest) { highest = value; best = t; }
+            }
+        }   indices.swap(output);
+    }
+
+    void optimizeOverdraw(std::vector<GLuint> & indices, std::vector<Vertex> const & vertices,
+                          unsigned cacheSize, float threshold)
+    {
+        std::size_t const triangles = indices.size() / 3;
+        if (triangles < 2) return;
+        float const baseline = analyze(indices, vertices.size(), cacheSize).acmr;
+
+        // Split Wherever the Cache Order Jumps: Triangles That Miss on All Three Vertices
+        std::vector<std::size_t> clusters(1, 0);
+        std::vector<unsigned> stamps(vertices.size(), 0);
+        unsigned time = cacheSize + 1;
+        for (std::size_t t = 0; t < triangles; t++)
+        {   unsigned misses = 0;
+            for (std::size_t k = 0; k < 3; k++)
+            {   GLuint v = indices[t * 3 + k];
+                if (time - stamps[v] > cacheSize) { stamps[v] = time++; misses++; }
+            }   if (misses == 3 && t > clusters.back()) clusters.push_back(t);
+        }   clusters.push_back(triangles);
+
+        // Score Each Cluster by How Far it Faces Away From the Mesh Center
+        glm::vec3 center(0.0f);
+        for (auto & vertex : vertices) center += vertex.position;
+        center /= float(vertices.size());
+        std::vector<std::pair<float, std::size_t>> order;
+        for (std::size_t c = 0; c + 1 < clusters.size(); c++)
+        {   glm::vec3 centroid(0.0f), normal(0.0f); float area = 0.0f;
+            for (std::size_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {   glm::vec3 const & a = vertices[indices[t * 3    ]].position;
+                glm::vec3 const & b = vertices[indices[t * 3 + 1]].position;
+                glm::vec3 const & d = vertices[indices[t * 3 + 2]].position;
+                glm::vec3 face = glm::cross(b - a, d - a);
+                float weight = glm::length(face);
+                centroid += (a + b + d) * (weight / 3.0f);
+                normal   += face;
+                area     += weight;
+            }
+            float length = glm::length(normal);
+            float facing = (area > 0.0f && length > 0.0f)
+                ? glm::dot(centroid / area - center, normal / length) : 0.0f;
+            order.push_back(std::make_pair(-facing, c));
+        }
+        std::stable_sort(order.begin(), order.end());
+
+        // Keep the Cache Order if Sorting Costs Too Many Extra Transforms
+        std::vector<GLuint> sorted;
+        sorted.reserve(indices.size());
+        for (auto & i : order)
+            sorted.insert(sorted.end(), indices.begin() + clusters[i.second] * 3, indices.begin() + clusters[i.second + 1] * 3);
+        if (analyze(sorted, vertices.size(), cacheSize).acmr <= baseline * threshold)
+            indices.swap(sorted);
+    }
+
+    void optimizeVertexFetch(std::vector<Vertex> & vertices, std::vector<GLuint> & indices)
+    {
+        std::vector<GLuint> remap(vertices.size(), GLuint(-1));
+        std::vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+        for (GLuint & index : indices)
+        {   if (remap[index] == GLuint(-1))
+            {   remap[index] = GLuint(ordered.size());
+                ordered.push_back(vertices[index]);
+            }   index = remap[index];
+        }   vertices.swap(ordered);
+    }
+
+    // Symmetric 4x4 Error Quadric, Plus the Total Weight of its Planes so the
+    // Error Comes Out as a Mean Squared Distance
+    struct Quadric {
+        Quadric() { std::fill(q, q + 11, 0.0); }
+        void add(glm::vec3 const & n, float d, float weight)
+        {   double p[] = { n.x, n.y, n.z, d };
+            for (int i = 0, k = 0; i < 4; i++)
+            for (int j = i; j < 4; j++) q[k++] += weight * p[i] * p[j];
+            q[10] += weight;
+        }
+        Quadric & operator+=(Quadric const & other) { for (int i = 0; i < 11; i++) q[i] += other.q[i]; return *this; }
+        double error(glm::vec3 const & v) const
+        {   double p[] = { v.x, v.y, v.z, 1.0 }, sum = 0.0;
+            for (int i = 0, k = 0; i < 4; i++)
+            for (int j = i; j < 4; j++, k++) sum += (i == j ? 1.0 : 2.0) * q[k] * p[i] * p[j];
+            return q[10] > 0.0 ? std::fabs(sum) / q[10] : 0.0;
+        }
+        double q[11];
+    };
+
+    std::vector<GLuint> simplify(std::vector<Vertex> const & vertices, std::vector<GLuint> const & indices,
+                                 std::size_t target, float & error)
+    {
+        std::size_t const count = vertices.size();
+        std::vector<GLuint> result(indices);
+        double worst = 0.0;
+
+        // Lock Vertices That Share a Position With Another (Attribute Seams)
+        std::map<std::tuple<float, float, float>, unsigned> positions;
+        for (auto & vertex : vertices)
+            positions[std::make_tuple(vertex.position.x, vertex.position.y, vertex.position.z)]++;
+        std::vector<bool> locked(count);
+        for (std::size_t v = 0; v < count; v++)
+        {   glm::vec3 const & p = vertices[v].position;
+            locked[v] = positions[std::make_tuple(p.x, p.y, p.z)] > 1;
+        }
+
+        // Accumulate Area-Weighted Face Planes, Plus Perpendicular Planes Along
+        // Open Edges so Borders Resist Shrinking
+        std::vector<Quadric> quadrics(count);
+        std::map<std::pair<GLuint, GLuint>, int> edges;
+        for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+        for (std::size_t k = 0; k < 3; k++)
+        {   GLuint a = result[t + k], b = result[t + (k + 1) % 3];
+            edges[std::make_pair(std::min(a, b), std::max(a, b))]++;
+        }
+        for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+        {   glm::vec3 const & p0 = vertices[result[t]].position;
+            glm::vec3 normal = glm::cross(vertices[result[t + 1]].position - p0, vertices[result[t + 2]].position - p0);
+            float area = glm::length(normal);
+            if (area <= 0.0f) continue;
+            normal = normal / area;
+            for (std::size_t k = 0; k < 3; k++)
+            {   GLuint a = result[t + k], b = result[t + (k + 1) % 3];
+                quadrics[a].add(normal, -glm::dot(normal, p0), area);
+                if (edges[std::make_pair(std::min(a, b), std::max(a, b))] != 1) continue;
+                glm::vec3 edge = vertices[b].position - vertices[a].position;
+                float length = glm::length(edge);
+                if (length <= 0.0f) continue;
+                glm::vec3 side = glm::normalize(glm::cross(edge, normal));
+                float d = -glm::dot(side, vertices[a].position);
+                quadrics[a].add(side, d, area * 10.0f);
+                quadrics[b].add(side, d, area * 10.0f);
+            }
+        }
+
+        // Each Pass Collapses the Cheapest Independent Edges, Then Rebuilds
+        std::vector<unsigned> offsets(count + 1), adjacency;
+        for (int pass = 0; pass < 64 && result.size() > target; pass++)
+        {
+            // Vertex to Triangle Adjacency for Flip Checks
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (GLuint index : result) offsets[index + 1]++;
+            for (std::size_t v = 0; v < count; v++) offsets[v + 1] += offsets[v];
+            adjacency.resize(result.size());
+            std::vector<unsigned> fill(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < result.size(); i++) adjacency[fill[result[i]]++] = unsigned(i / 3);
+
+            // Cheapest Direction for Every Edge
+            std::vector<std::pair<GLuint, GLuint>> unique;
+            for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+            for (std::size_t k = 0; k < 3; k++)
+            {   GLuint a = result[t + k], b = result[t + (k + 1) % 3];
+                unique.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+            }
+            std::sort(unique.begin(), unique.end());
+            unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+            std::vector<std::tuple<double, GLuint, GLuint>> candidates;
+            for (auto & edge : unique)
+            {   GLuint a = edge.first, b = edge.second;
+                Quadric sum = quadrics[a]; sum += quadrics[b];
+                double ab = locked[a] ? INFINITY : sum.error(vertices[b].position);
+                double ba = locked[b] ? INFINITY : sum.error(vertices[a].position);
+                if (ab < ba) candidates.push_back(std::make_tuple(ab, a, b));
+                else if (ba < INFINITY) candidates.push_back(std::make_tuple(ba, b, a));
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            // Collapse Until the Estimate Reaches the Target; Neighbourhoods of
+            // Collapsed Vertices are Frozen so Flip Checks Stay Valid
+            std::vector<GLuint> remap(count);
+            std::iota(remap.begin(), remap.end(), 0);
+            std::vector<bool> touched(count, false);
+            std::size_t remaining = result.size(), collapsed = 0;
+            for (auto & candidate : candidates)
+            {   if (remaining <= target) break;
+                GLuint from = std::get<1>(candidate), to = std::get<2>(candidate);
+                if (touched[from] || touched[to]) continue;
+
+                bool flips = false; unsigned shared = 0;
+                for (unsigned i = offsets[from]; i < offsets[from + 1] && !flips; i++)
+                {   std::size_t t = adjacency[i] * 3;
+                    GLuint corners[] = { result[t], result[t + 1], result[t + 2] };
+                    if (corners[0] == to || corners[1] == to || corners[2] == to) { shared++; continue; }
+                    glm::vec3 before = glm::cross(vertices[corners[1]].position - vertices[corners[0]].position,
+                                                  vertices[corners[2]].position - vertices[corners[0]].position);
+                    for (auto & corner : corners) if (corner == from) corner = to;
+                    glm::vec3 after  = glm::cross(vertices[corners[1]].position - vertices[corners[0]].position,
+                                                  vertices[corners[2]].position - vertices[corners[0]].position);
+                    flips = glm::dot(before, after) <= 0.0f;
+                }   if (flips) continue;
+
+                for (unsigned i = offsets[from]; i < offsets[from + 1]; i++)
+                for (std::size_t k = 0; k < 3; k++) touched[result[adjacency[i] * 3 + k]] = true;
+                remap[from] = to;
+                quadrics[to] += quadrics[from];
+                worst = std::max(worst, std::get<0>(candidate));
+                remaining -= shared * 3;
+                collapsed++;
+            }
+            if (collapsed == 0) break;
+
+            // Apply the Collapses and Drop Triangles That Became Degenerate
+            std::size_t write = 0;
+            for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+            {   GLuint a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+                if (a == b || b == c || a == c) continue;
+                result[write++] = a; result[write++] = b; result[write++] = c;
+            }   result.resize(write);
+        }
+        error = float(std::sqrt(worst));
+        return result;
+    }
+
+    std::vector<Lod> lods(std::vector<Vertex> const & vertices, std::vector<GLuint> const & indices,
+                          OptimizeOptions const & options)
+    {
+        std::vector<Lod> levels;
+        std::vector<GLuint> const * previous = & indices;
+        for (unsigned level = 1; level < options.levels; level++)
+        {   std::size_t target = std::size_t(previous->size() / 3 * options.reduction) * 3;
+            Lod lod; lod.indices = simplify(vertices, indices, target, lod.error);
+            if (lod.indices.empty() || lod.indices.size() > previous->size() * 9 / 10) break;
+            optimizeVertexCache(lod.indices, vertices.size(), options.cacheSize);
+            levels.push_back(std::move(lod));
+            previous = & levels.back().indices;
+        }   return levels;
+    }
+
+    CacheStats optimize(std::vector<Vertex> & vertices, std::vector<GLuint> & indices,
+                        OptimizeOptions const & options, std::string const & name)
+    {
+        if (!options.enabled || indices.size() % 3 != 0) return analyze(indices, vertices.size(), options.cacheSize);
+        CacheStats before = analyze(indices, vertices.size(), options.cacheSize);
+        optimizeVertexCache(indices, vertices.size(), options.cacheSize);
+        optimizeOverdraw(indices, vertices, options.cacheSize, options.threshold);
+        optimizeVertexFetch(vertices, indices);
+        CacheStats after = analyze(indices, vertices.size(), options.cacheSize);
+        if (options.report)
+            fprintf(stderr, "%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%zu Triangles)\n", name.c_str(),
+                    before.acmr, after.acmr, before.atvr, after.atvr, indices.size() / 3);
+        return after;
+    }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+// Local Headers
+#include "vertex.hpp"
+
+// System Headers
+#include <glad/glad.h>
+
+// Standard Headers
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Import-Time Mesh Optimization Settings
+    struct OptimizeOptions {
+        bool     enabled   = true;
+        unsigned cacheSize = 16;    // Simulated Post-Transform Cache Entries
+        float    threshold = 1.05f; // Largest ACMR Increase the Overdraw Pass May Cost
+        bool     report    = false; // Print Statistics for Every Sub-Mesh
+        unsigned levels    = 4;     // Detail Levels Including Full Detail; 1 Disables LODs
+        float    reduction = 0.5f;  // Triangle Count of Each Level Relative to the Last
+    };
+
+    // One Coarser Detail Level, Indexing the Same Vertices as Full Detail
+    struct Lod {
+        std::vector<GLuint> indices;
+        float error; // Largest Deviation From Full Detail, in Model Units
+    };
+
+    // Post-Transform Cache Efficiency Under a FIFO Cache: Average Cache Miss
+    // Ratio (Misses per Triangle, 0.5 at Best) and Average Transform to
+    // Vertex Ratio (Misses per Referenced Vertex, 1.0 at Best)
+    struct CacheStats {
+        float acmr = 0.0f;
+        float atvr = 0.0f;
+    };
+
+    CacheStats analyze(std::vector<GLuint> const & indices, std::size_t vertexCount, unsigned cacheSize = 16);
+
+    // Reorder Triangles for Vertex Cache Hits (Forsyth's Linear-Speed Algorithm)
+    void optimizeVertexCache(std::vector<GLuint> & indices, std::size_t vertexCount, unsigned cacheSize = 16);
+
+    // Reorder Clusters of Cache-Optimized Triangles Outside-In so Occluders
+    // Tend to Draw First (Sander et al.), Unless the ACMR Grows Past the Threshold
+    void optimizeOverdraw(std::vector<GLuint> & indices, std::vector<Vertex> const & vertices,
+                          unsigned cacheSize = 16, float threshold = 1.05f);
+
+    // Renumber Vertices in First-Use Order and Drop Unreferenced Ones
+    void optimizeVertexFetch(std::vector<Vertex> & vertices, std::vector<GLuint> & indices);
+
+    // Quadric Edge Collapse (Garland and Heckbert) Onto Existing Vertices, so
+    // the Result Shares the Vertex Buffer. Vertices on UV or Normal Seams Stay
+    // Put, and Collapses That Would Flip a Triangle are Skipped. Stops at the
+    // Target Index Count or When Nothing More Can Collapse; Sets the Error.
+    std::vector<GLuint> simplify(std::vector<Vertex> const & vertices, std::vector<GLuint> const & indices,
+                                 std::size_t target, float & error);
+
+    // Build Coarser Levels of an Optimized Mesh, Finest First. Stops Early
+    // Once a Level Fails to Remove a Meaningful Share of Triangles.
+    std::vector<Lod> lods(std::vector<Vertex> const & vertices, std::vector<GLuint> const & indices,
+                          OptimizeOptions const & options);
+
+    // Run All Passes in Order; Reports "name: ACMR before -> after" if Asked
+    CacheStats optimize(std::vector<Vertex> & vertices, std::vector<GLuint> & indices,
+                        OptimizeOptions const & options, std::string const & name);
+};
@@ -0,0 +1,60 @@
+// Local Headers
+#include "queue.hpp"
+#include "GLState.hpp"
+#include "Profiler.hpp"
+
+// System Headers
+#include <glm/gtc/type_ptr.hpp>
+
+// Standard Headers
+#include <algorithm>
+
+// Define Namespace
+namespace Mirage
+{
+    void RenderQueue::push(GLuint program, Material const & material, GLuint vertexArray,
+                           GLsizei count, GLenum type, std::size_t offset, glm::mat4 const & model)
+    {
+        Command command = { key(program, material.id, vertexArray), program,
+                            vertexArray, & material, count, type, offset, model };
+        mCommands.push_back(command);
+    }
+
+    std::uint64_t RenderQueue::key(GLuint program, GLuint material, GLuint vertexArray)
+    {
+        // Names Beyond a Field's Width Only Cost Sorting Quality, Not Correctness
+        return (std::uint64_t(program     & 0xFFFF)   << 48)
+             | (std::uint64_t(material    & 0xFFFFFF) << 24)
+             |  std::uint64_t(vertexArray & 0xFFFFFF);
+    }
+
+    void RenderQueue::submit()
+    {
+        PROFILE_SCOPE("Submit");
+        // Sort Small Key-Index Pairs Rather Than Whole Commands
+        mOrder.clear();
+        mOrder.reserve(mCommands.size());
+        for (std::size_t i = 0; i < mCommands.size(); i++)
+            mOrder.push_back(std::make_pair(mCommands[i].key, std::uint32_t(i)));
+        std::sort(mOrder.begin(), mOrder.end());
+
+        // Only Look Up the Model Uniform When the Program Changes
+        auto & state = GLState::get();
+        GLuint program = 0; GLint model = -1;
+        for (auto & i : mOrder)
+        {   Command const & command = mCommands[i.second];
+            if (command.program != program)
+            {   program = command.program;
+                state.useProgram(program);
+                Material::samplers(program);
+                model = glGetUniformLocation(program, "model");
+            }
+            command.material->bind();
+            state.bindVertexArray(command.vertexArray);
+            if (model != -1) glUniformMatrix4fv(model, 1, GL_FALSE, glm::value_ptr(command.model));
+            glDrawElements(GL_TRIANGLES, command.count, command.type, (GLvoid *) command.offset);
+            Profiler::get().count(ProfileCounter::DrawCalls);
+            Profiler::get().count(ProfileCounter::Triangles, command.count / 3);
+        }   mCommands.clear();
+    }
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+// Local Headers
+#include "mesh.hpp"
+
+// System Headers
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Collects a Frame's Draws and Submits Them Sorted by a 64-Bit Key, so
+    // Draws Sharing a Program, Material or Vertex Array Run Back to Back and
+    // GLState Can Skip the Redundant Binds Between Them:
+    //
+    //     | Program (16) | Material (24) | Vertex Array (24) |
+    //
+    // The Queue Holds Pointers to Each Material, so Meshes Must Outlive submit().
+    class RenderQueue
+    {
+    public:
+
+        // Public Member Functions
+        void push(GLuint program, Material const & material, GLuint vertexArray,
+                  GLsizei count, GLenum type, std::size_t offset, glm::mat4 const & model);
+        void submit();
+        void clear() { mCommands.clear(); }
+        std::size_t size() const { return mCommands.size(); }
+        static std::uint64_t key(GLuint program, GLuint material, GLuint vertexArray);
+
+    private:
+
+        // One Queued Draw
+        struct Command {
+            std::uint64_t key;
+            GLuint program;
+            GLuint vertexArray;
+            Material const * material;
+            GLsizei count;
+            GLenum type;
+            std::size_t offset;
+            glm::mat4 model;
+        };
+
+        // Private Member Containers
+        std::vector<Command> mCommands;
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> mOrder; // Key, Command
+
+    };
+};
@@ -0,0 +1,293 @@
+// Local Headers
+#include "residency.hpp"
+#include "compress.hpp"
+#include "Extensions.hpp"
+#include "GLState.hpp"
+#include "Jobs.hpp"
+#include "Profiler.hpp"
+
+// System Headers
+#include <GLFW/glfw3.h>
+
+// Standard Headers
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// Define Namespace
+namespace Mirage
+{
+    // Levels No Larger Than This Stay Resident Once Loaded
+    static int const FloorSize = 64;
+    // Frames a Texture Keeps its Detail After the Last Request
+    static std::uint64_t const Linger = 120;
+    // Loads Decoding on Workers at Once
+    static unsigned const MaxLoads = 4;
+
+    typedef void (APIENTRYP PageCommitment)(GLenum target, GLint level, GLint x, GLint y, GLint z,
+                                            GLsizei width, GLsizei height, GLsizei depth, GLboolean commit);
+
+    static PageCommitment pageCommitment()
+    {
+        static PageCommitment function = [] {
+            if (!GLAD_GL_VERSION_4_2 || !hasExtension("GL_ARB_sparse_texture")) return PageCommitment(nullptr);
+            return (PageCommitment) glfwGetProcAddress("glTexPageCommitmentARB");
+        }();
+        return function;
+    }
+
+    static int extent(int size, unsigned level)
+    {
+        return std::max(size >> level, 1);
+    }
+
+    TextureResidency & TextureResidency::get()
+    {
+        static TextureResidency residency;
+        return residency;
+    }
+
+    bool TextureResidency::sparse() const
+    {
+        return pageCommitment() != nullptr;
+    }
+
+    std::size_t TextureResidency::bytes(Entry const & entry, unsigned first) const
+    {
+        // Sized Like TextureUploader::bytes(), Three Channels Padded to Four
+        std::size_t texel = (entry.source.channels == 3) ? 4 : entry.source.channels, total = 0;
+        for (unsigned level = first; level < entry.levels; level++)
+            total += std::size_t(extent(entry.source.width, level)) * extent(entry.source.height, level) * texel;
+        return total;
+    }
+
+    GLuint TextureResidency::create(Image const & image, TextureOptions const & options)
+    {
+        if (!image.pixels) return 0;
+        Entry entry;
+        entry.source   = image;
+        entry.levels   = unsigned(options.mipmaps ? TextureUploader::levels(image.width, image.height) : 1);
+        entry.floor    = 0;
+        while (entry.floor + 1 < entry.levels &&
+               std::max(extent(image.width, entry.floor), extent(image.height, entry.floor)) > FloorSize)
+            entry.floor++;
+        entry.used     = 0;
+        entry.serial   = ++mSerial;
+        entry.sparse   = false;
+        entry.loading  = false;
+
+        // Bind Texture and Set Filtering Levels
+        GLuint texture;
+        glGenTextures(1, & texture);
+        GLState::get().bindTexture(0, GL_TEXTURE_2D, texture);
+        TextureUploader::configure(image.channels, options, entry.format, entry.internal);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(entry.levels - 1));
+
+        // Sparse Storage Wants Level Zero to be Made of Whole Pages
+        if (pageCommitment())
+        {   GLint sizes = 0, pageX = 0, pageY = 0;
+            glGetInternalformativ(GL_TEXTURE_2D, entry.internal, GL_NUM_VIRTUAL_PAGE_SIZES_ARB, 1, & sizes);
+            if (sizes > 0)
+            {   glGetInternalformativ(GL_TEXTURE_2D, entry.internal, GL_VIRTUAL_PAGE_SIZE_X_ARB, 1, & pageX);
+                glGetInternalformativ(GL_TEXTURE_2D, entry.internal, GL_VIRTUAL_PAGE_SIZE_Y_ARB, 1, & pageY);
+            }
+            entry.sparse = pageX > 0 && pageY > 0 && image.width % pageX == 0 && image.height % pageY == 0;
+        }
+
+        // The Mip Tail Shares its Pages, so it is Committed Once and Never Dropped
+        if (entry.sparse)
+        {   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SPARSE_ARB, GL_TRUE);
+            glTexParameteri(GL_TEXTURE_2D, GL_VIRTUAL_PAGE_SIZE_INDEX_ARB, 0);
+            glTexStorage2D(GL_TEXTURE_2D, GLsizei(entry.levels), entry.internal, image.width, image.height);
+            GLint tail = GLint(entry.levels);
+            glGetTexParameteriv(GL_TEXTURE_2D, GL_NUM_SPARSE_LEVELS_ARB, & tail);
+            entry.floor = std::min(entry.floor, unsigned(tail));
+            if (unsigned(tail) < entry.levels)
+                pageCommitment()(GL_TEXTURE_2D, tail, 0, 0, 0, extent(image.width, tail),
+                                 extent(image.height, tail), 1, GL_TRUE);
+        }
+
+        // Nothing is Resident Yet; Sampling Starts Once the Floor Arrives
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, GLint(entry.levels - 1));
+        entry.resident = entry.levels;
+        entry.wanted   = entry.levels;
+        entry.desired  = entry.floor;
+        entry.target   = entry.floor;
+        fetch(texture, mEntries[texture] = entry);
+        return texture;
+    }
+
+    void TextureResidency::release(GLuint texture)
+    {
+        // Loads Still in Flight are Discarded by Their Serial
+        auto it = mEntries.find(texture);
+        if (it == mEntries.end()) return;
+        mUsed -= bytes(it->second, it->second.resident);
+        mEntries.erase(it);
+    }
+
+    void TextureResidency::request(GLuint texture, float uvPerPixel)
+    {
+        auto it = mEntries.find(texture);
+        if (it == mEntries.end()) return;
+
+        // One Pixel Covers This Many Texels of Level Zero Along the Longer Side
+        Entry & entry = it->second;
+        float texels = uvPerPixel * float(std::max(entry.source.width, entry.source.height));
+        unsigned level = texels > 1.0f ? unsigned(std::log2(texels)) : 0;
+        entry.wanted = std::min(entry.wanted, level);
+        entry.used   = mFrame;
+    }
+
+    int TextureResidency::level(GLuint texture) const
+    {
+        auto it = mEntries.find(texture);
+        return it == mEntries.end() ? -1 : int(it->second.resident);
+    }
+
+    void TextureResidency::fit()
+    {
+        // Keep Last Frame's Finest Request, Falling Back to the Floor Once Unused
+        for (auto & i : mEntries)
+        {   Entry & entry = i.second;
+            if (entry.wanted < entry.levels) entry.desired = std::min(entry.wanted, entry.floor);
+            else if (mFrame - entry.used > Linger) entry.desired = entry.floor;
+            entry.wanted = entry.levels;
+        }
+
+        // Then the Smallest Shared Bias That Brings the Total Under Budget
+        for (mBias = 0;; mBias++)
+        {   std::size_t total = 0; bool coarsest = true;
+            for (auto & i : mEntries)
+            {   unsigned target = std::min(i.second.desired + mBias, i.second.floor);
+                total += bytes(i.second, target);
+                coarsest = coarsest && target == i.second.floor;
+            }
+            if (total <= mBudget) break;
+            if (coarsest)
+            {   static bool reported = false;
+                if (!reported) fprintf(stderr, "Texture Residency Floors Exceed the Budget: %zu of %zu Bytes\n", total, mBudget);
+                reported = true;
+                break;
+            }
+        }
+        for (auto & i : mEntries)
+            i.second.target = std::min(i.second.desired + mBias, i.second.floor);
+    }
+
+    void TextureResidency::drop(GLuint texture, Entry & entry, unsigned level)
+    {
+        // Move Sampling Off the Levels First, Then Give Their Memory Back
+        GLState::get().bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, GLint(level));
+        for (unsigned i = entry.resident; i < level; i++)
+            if (entry.sparse) pageCommitment()(GL_TEXTURE_2D, GLint(i), 0, 0, 0, extent(entry.source.width, i),
+                                               extent(entry.source.height, i), 1, GL_FALSE);
+            else glTexImage2D(GL_TEXTURE_2D, GLint(i), GLint(entry.internal), 0, 0, 0,
+                              entry.format, GL_UNSIGNED_BYTE, nullptr);
+        mUsed -= bytes(entry, entry.resident) - bytes(entry, level);
+        entry.resident = level;
+    }
+
+    void TextureResidency::fetch(GLuint texture, Entry & entry)
+    {
+        // The Worker Rebuilds the Chain From Level Zero and Keeps Only the Missing
+        // Levels. The First Load Uses the Cache's Pixels; Later Ones Decode Again.
+        Load request;
+        request.texture = texture;
+        request.serial  = entry.serial;
+        request.first   = entry.target;
+        request.last    = entry.resident;
+        Image source    = entry.source;
+        entry.source.pixels.reset();
+        entry.loading = true;
+        mLoading++;
+        JobSystem::get().run([this, request, source]() mutable
+        {   Image image = source.pixels ? source : Image::decode(source.filename);
+            if (image.pixels && image.width == source.width && image.height == source.height
+                             && image.channels == source.channels)
+            {   std::vector<unsigned char> current, next;
+                unsigned char const * pixels = image.pixels.get();
+                int width = image.width, height = image.height, channels = image.channels;
+                request.pixels.resize(request.last - request.first);
+                for (unsigned level = 0; level < request.last; level++)
+                {   if (level >= request.first)
+                        request.pixels[level - request.first].assign(pixels, pixels + std::size_t(width) * height * channels);
+                    if (level + 1 == request.last) break;
+                    downsample(pixels, width, height, channels, next);
+                    current.swap(next);
+                    pixels = current.data();
+                    width  = extent(width, 1);
+                    height = extent(height, 1);
+                }
+            }
+            std::lock_guard<std::mutex> lock(mMutex);
+            mReady.push_back(std::move(request));
+        }, nullptr, "Stream Texture");
+    }
+
+    void TextureResidency::upload(Load & load)
+    {
+        mLoading--;
+        auto it = mEntries.find(load.texture);
+        if (it == mEntries.end() || it->second.serial != load.serial) return;
+        Entry & entry = it->second;
+
+        // A Failed Decode Leaves the Texture as it is and Stops Further Loads
+        if (load.pixels.empty())
+        {   fprintf(stderr, "%s %s\n", "Failed to Stream Texture", entry.source.filename.c_str());
+            return;
+        }
+        entry.loading = false;
+
+        // Levels Must Join What is Resident, and Any Now Finer Than the Target are Skipped
+        unsigned first = std::max(load.first, entry.target);
+        if (load.last != entry.resident || first >= load.last) return;
+        GLState::get().bindTexture(0, GL_TEXTURE_2D, load.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (unsigned level = load.last; level-- > first;)
+        {   GLsizei width = extent(entry.source.width, level), height = extent(entry.source.height, level);
+            GLvoid const * pixels = load.pixels[level - load.first].data();
+            if (entry.sparse)
+            {   pageCommitment()(GL_TEXTURE_2D, GLint(level), 0, 0, 0, width, height, 1, GL_TRUE);
+                glTexSubImage2D(GL_TEXTURE_2D, GLint(level), 0, 0, width, height,
+                                entry.format, GL_UNSIGNED_BYTE, pixels);
+            }
+            else glTexImage2D(GL_TEXTURE_2D, GLint(level), GLint(entry.internal), width, height, 0,
+                              entry.format, GL_UNSIGNED_BYTE, pixels);
+        }   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, GLint(first));
+
+        std::size_t uploaded = bytes(entry, first) - bytes(entry, load.last);
+        Profiler::get().count(ProfileCounter::UploadBytes, uploaded);
+        mUsed += uploaded;
+        entry.resident = first;
+    }
+
+    void TextureResidency::update(double budget)
+    {
+        PROFILE_SCOPE("Texture Residency");
+        auto start = std::chrono::steady_clock::now();
+        fit();
+
+        // Drop Before Fetching so Freed Room is There for What Comes In
+        for (auto & i : mEntries)
+        {   Entry & entry = i.second;
+            if (entry.resident < entry.target) drop(i.first, entry, entry.target);
+            else if (entry.target < entry.resident && !entry.loading && mLoading < MaxLoads) fetch(i.first, entry);
+        }
+
+        // Upload Whatever the Workers Have Finished, at Least One per Frame
+        for (;;)
+        {   Load load;
+            {   std::lock_guard<std::mutex> lock(mMutex);
+                if (mReady.empty()) break;
+                load = std::move(mReady.front());
+                mReady.pop_front();
+            }   upload(load);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budget) break;
+        }   mFrame++;
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+// Local Headers
+#include "texture.hpp"
+
+// System Headers
+#include <glad/glad.h>
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Keeps Mip Chains Inside a Fixed VRAM Budget by Streaming Levels In and
+    // Out. Draws Report How Finely They Sample Each Texture on Screen With
+    // request(), and Once a Frame update() Picks the Finest Level Each Texture
+    // Needs, Coarsening Every Texture by the Same Bias Until the Total Fits.
+    // Levels Past That are Dropped at Once; Missing Ones are Rebuilt by a
+    // JobSystem Worker From the Source Image and Uploaded by update() Within
+    // a Time Budget.
+    //
+    // Where ARB_sparse_texture Supports the Format and Size, Levels are
+    // Committed and Decommitted in Place. Otherwise the Texture Uses Mutable
+    // Storage, and Dropped Levels are Respecified as Empty Images. Either Way
+    // GL_TEXTURE_BASE_LEVEL Keeps Sampling on Resident Levels and the Texture
+    // Name Never Changes, so Materials Need Not Know.
+    //
+    //     TextureResidency::get().setBudget(512 << 20); // Before Loading Models
+    //     mesh.select(LodView(eye, fovy, height), model); // Also Requests Levels
+    //     TextureResidency::get().update(0.002);
+    //
+    // Levels of 64 Texels and Below (Plus the Sparse Mip Tail) Always Stay.
+    class TextureResidency
+    {
+    public:
+
+        // Public Member Functions
+        static TextureResidency & get();
+
+        // A Budget of Zero Turns Streaming Off for Textures Acquired Later
+        void setBudget(std::size_t bytes) { mBudget = bytes; }
+        std::size_t budget() const { return mBudget; }
+        bool enabled() const { return mBudget > 0; }
+        std::size_t used() const { return mUsed; }
+        unsigned bias() const { return mBias; }
+
+        // Create a Streamed Texture From a Decoded Image; Its Coarse Levels
+        // Arrive Through update(), and the Rest Only Once Requested. Returns
+        // 0 for an Empty Image. GL Thread Only, Like Everything Below.
+        GLuint create(Image const & image, TextureOptions const & options);
+        void release(GLuint texture);
+
+        // Screen-Space Sampling Rate: UV Units Covered by One Pixel. The
+        // Finest Request per Frame Wins; Textures Nobody Asks for Coarsen
+        // Once They Have Gone Unrequested for a Short While.
+        void request(GLuint texture, float uvPerPixel);
+
+        // Fit Last Frame's Requests to the Budget, Drop and Queue Levels, and
+        // Upload Finished Levels Until budget Seconds Pass
+        void update(double budget);
+
+        // Finest Level Sampled From, or -1 for Textures Not Streamed
+        int level(GLuint texture) const;
+        bool sparse() const;
+
+    private:
+
+        // Implement Default Constructor
+        TextureResidency() : mBudget(0), mUsed(0), mBias(0), mFrame(0), mSerial(0), mLoading(0) {}
+
+        // Disable Copying and Assignment
+        TextureResidency(TextureResidency const &) = delete;
+        TextureResidency & operator=(TextureResidency const &) = delete;
+
+        // One Streamed Texture; Levels [resident, levels) Have Pixels, and
+        // Levels [floor, levels) are Never Dropped
+        struct Entry {
+            Image         source;   // Pixels Kept for the First Load, Then Only the Filename
+            GLenum        format;
+            GLenum        internal;
+            unsigned      levels;
+            unsigned      floor;
+            unsigned      resident; // Equal to levels Until the First Load Lands
+            unsigned      wanted;   // Finest Level Requested This Frame, levels if None
+            unsigned      desired;  // Finest Useful Level Before the Bias
+            unsigned      target;
+            std::uint64_t used;     // Frame of the Last Request
+            std::uint64_t serial;   // Tells Apart Textures That Reuse a Name
+            bool          sparse;
+            bool          loading;
+        };
+
+        // Pixels for Levels [first, last) of One Texture, Built by a Worker
+        struct Load {
+            GLuint        texture;
+            std::uint64_t serial;
+            unsigned      first;
+            unsigned      last;
+            std::vector<std::vector<unsigned char>> pixels; // Empty if Decoding Failed
+        };
+
+        // Private Member Functions
+        void fit();
+        void drop(GLuint texture, Entry & entry, unsigned level);
+        void fetch(GLuint texture, Entry & entry);
+        void upload(Load & load);
+        std::size_t bytes(Entry const & entry, unsigned first) const;
+
+        // Private Member Containers
+        std::unordered_map<GLuint, Entry> mEntries;
+        std::deque<Load> mReady;
+
+        // Private Member Variables
+        std::mutex    mMutex; // Guards mReady
+        std::size_t   mBudget;
+        std::size_t   mUsed;
+        unsigned      mBias;
+        std::uint64_t mFrame;
+        std::uint64_t mSerial;
+        unsigned      mLoading;
+
+    };
+};
@@ -0,0 +1,108 @@
+// Local Headers
+#include "scene.hpp"
+#include "commands.hpp"
+#include "mesh.hpp"
+#include "Profiler.hpp"
+#include "queue.hpp"
+
+// Standard Headers
+#include <algorithm>
+
+// Define Namespace
+namespace Mirage
+{
+    Scene::Node const Scene::None;
+
+    Scene::Node Scene::add(Node parent, std::string const & name,
+                           glm::vec3 const & position, glm::quat const & rotation, glm::vec3 const & scale)
+    {
+        // Appending Keeps Every Parent Ahead of its Children
+        Node node = Node(mParents.size());
+        mParents.push_back(parent < node ? parent : None);
+        mNames.push_back(name);
+        mPositionX.push_back(position.x); mPositionY.push_back(position.y); mPositionZ.push_back(position.z);
+        mRotationX.push_back(rotation.x); mRotationY.push_back(rotation.y);
+        mRotationZ.push_back(rotation.z); mRotationW.push_back(rotation.w);
+        mScaleX.push_back(scale.x); mScaleY.push_back(scale.y); mScaleZ.push_back(scale.z);
+        mLocal.push_back(glm::mat4(1.0f));
+        mWorld.push_back(glm::mat4(1.0f));
+        mDirty.push_back(1);
+        mMoved.push_back(0);
+        return node;
+    }
+
+    void Scene::attach(Node node, Mesh & mesh)
+    {
+        mMeshNodes.push_back(node);
+        mMeshes.push_back(& mesh);
+    }
+
+    void Scene::setPosition(Node node, glm::vec3 const & position)
+    {
+        mPositionX[node] = position.x; mPositionY[node] = position.y; mPositionZ[node] = position.z;
+        mDirty[node] = 1;
+    }
+
+    void Scene::setRotation(Node node, glm::quat const & rotation)
+    {
+        mRotationX[node] = rotation.x; mRotationY[node] = rotation.y;
+        mRotationZ[node] = rotation.z; mRotationW[node] = rotation.w;
+        mDirty[node] = 1;
+    }
+
+    void Scene::setScale(Node node, glm::vec3 const & scale)
+    {
+        mScaleX[node] = scale.x; mScaleY[node] = scale.y; mScaleZ[node] = scale.z;
+        mDirty[node] = 1;
+    }
+
+    Scene::Node Scene::find(std::string const & name) const
+    {
+        auto it = std::find(mNames.begin(), mNames.end(), name);
+        return it == mNames.end() ? None : Node(it - mNames.begin());
+    }
+
+    void Scene::compose(Node node)
+    {
+        // Scaled Rotation in the Upper 3x3, Translation in the Last Column
+        float x = mRotationX[node], y = mRotationY[node], z = mRotationZ[node], w = mRotationW[node];
+        float xx = 2 * x * x, yy = 2 * y * y, zz = 2 * z * z;
+        float xy = 2 * x * y, xz = 2 * x * z, yz = 2 * y * z;
+        float wx = 2 * w * x, wy = 2 * w * y, wz = 2 * w * z;
+        glm::mat4 & local = mLocal[node];
+        local[0] = glm::vec4((1 - yy - zz) * mScaleX[node], (xy + wz) * mScaleX[node], (xz - wy) * mScaleX[node], 0.0f);
+        local[1] = glm::vec4((xy - wz) * mScaleY[node], (1 - xx - zz) * mScaleY[node], (yz + wx) * mScaleY[node], 0.0f);
+        local[2] = glm::vec4((xz + wy) * mScaleZ[node], (yz - wx) * mScaleZ[node], (1 - xx - yy) * mScaleZ[node], 0.0f);
+        local[3] = glm::vec4(mPositionX[node], mPositionY[node], mPositionZ[node], 1.0f);
+    }
+
+    void Scene::update()
+    {
+        PROFILE_SCOPE("Scene Update");
+
+        // Parents Come First, so Their World Matrix and Moved Flag are Final
+        // by the Time Any Child Reads Them; No Stack, No Recursion
+        std::size_t count = mParents.size();
+        for (std::size_t i = 0; i < count; i++)
+        {   Node parent = mParents[i];
+            std::uint8_t moved = mDirty[i] | (parent != None ? mMoved[parent] : 0);
+            mMoved[i] = moved;
+            if (!moved) continue;
+            if (mDirty[i]) compose(Node(i));
+            mWorld[i] = parent != None ? mWorld[parent] * mLocal[i] : mLocal[i];
+        }   std::fill(mDirty.begin(), mDirty.end(), 0);
+    }
+
+    void Scene::draw(RenderQueue & queue, GLuint shader) const
+    {
+        for (std::size_t i = 0; i < mMeshes.size(); i++)
+            mMeshes[i]->draw(queue, shader, mWorld[mMeshNodes[i]]);
+    }
+
+    void Scene::record(CommandQueue & queue, GLuint shader) const
+    {
+        // Reads Only, so the Queue's Jobs Can Share the Scene
+        queue.record(mMeshes.size(), [this, shader](CommandBuffer & buffer, std::size_t i)
+        {   mMeshes[i]->draw(buffer, shader, mWorld[mMeshNodes[i]]); });
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+// System Headers
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Standard Headers
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Forward Declarations
+    class CommandQueue;
+    class Mesh;
+    class RenderQueue;
+
+    // Flat Node Hierarchy Kept in Topological Order: Every Node is Stored
+    // After its Parent, so World Matrices are Rebuilt in One Forward Pass
+    // Over Plain Arrays Instead of a Recursive Walk. Local Transforms Live
+    // in Separate Position, Rotation and Scale Arrays and Only Changed Nodes
+    // are Recomposed; a Change Reaches the Children Through the Same Pass.
+    //
+    //     Scene scene;
+    //     Mesh model("robot.fbx", scene);          // One Node per Assimp Node
+    //     auto arm = scene.find("LeftArm");
+    //     scene.setRotation(arm, glm::angleAxis(angle, glm::vec3(1, 0, 0)));
+    //     scene.update();
+    //     scene.draw(queue, shader);
+    //
+    // Nodes are Never Removed. Attached Meshes are Referenced, so They Must
+    // Outlive the Scene's Draws.
+    class Scene
+    {
+    public:
+
+        typedef std::uint32_t Node;
+        static Node const None = ~Node(0);
+
+        // Public Member Functions
+        Node add(Node parent, std::string const & name,
+                 glm::vec3 const & position = glm::vec3(0.0f),
+                 glm::quat const & rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                 glm::vec3 const & scale    = glm::vec3(1.0f));
+        void attach(Node node, Mesh & mesh);
+        void update();
+
+        // Local Transform Relative to the Parent; Writes Mark the Node Dirty
+        void setPosition(Node node, glm::vec3 const & position);
+        void setRotation(Node node, glm::quat const & rotation);
+        void setScale(Node node, glm::vec3 const & scale);
+        glm::vec3 position(Node node) const { return glm::vec3(mPositionX[node], mPositionY[node], mPositionZ[node]); }
+        glm::quat rotation(Node node) const { return glm::quat(mRotationW[node], mRotationX[node], mRotationY[node], mRotationZ[node]); }
+        glm::vec3 scale(Node node) const { return glm::vec3(mScaleX[node], mScaleY[node], mScaleZ[node]); }
+
+        // World Matrices as of the Last update(); moved() is True for Nodes
+        // Whose World Matrix That update() Changed
+        glm::mat4 const & world(Node node) const { return mWorld[node]; }
+        glm::mat4 const * worlds() const { return mWorld.data(); }
+        bool moved(Node node) const { return mMoved[node] != 0; }
+
+        Node parent(Node node) const { return mParents[node]; }
+        std::string const & name(Node node) const { return mNames[node]; }
+        Node find(std::string const & name) const;
+        std::size_t size() const { return mParents.size(); }
+
+        // Queue Every Attached Mesh at its Node's World Matrix, in Attachment
+        // Order; record() Spreads the Meshes Across the Queue's Buffers
+        void draw(RenderQueue & queue, GLuint shader) const;
+        void record(CommandQueue & queue, GLuint shader) const;
+
+    private:
+
+        // Private Member Functions
+        void compose(Node node);
+
+        // Private Member Containers
+        std::vector<Node> mParents;
+        std::vector<std::string> mNames;
+        std::vector<float> mPositionX, mPositionY, mPositionZ;
+        std::vector<float> mRotationX, mRotationY, mRotationZ, mRotationW;
+        std::vector<float> mScaleX, mScaleY, mScaleZ;
+        std::vector<glm::mat4> mLocal;
+        std::vector<glm::mat4> mWorld;
+        std::vector<std::uint8_t> mDirty; // Local Changed Since the Last update()
+        std::vector<std::uint8_t> mMoved;
+        std::vector<Node> mMeshNodes;     // Parallel to mMeshes
+        std::vector<Mesh *> mMeshes;
+
+    };
+};
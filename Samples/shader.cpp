@@ -1,52 +1,71 @@
 // Local Headers
 #include "shader.hpp"
+#include "Extensions.hpp"
+#include "GLState.hpp"
+#include "ProgramCache.hpp"
+#include "ShaderLibrary.hpp"
+#include "UniformBuffer.hpp"
+
+// System Headers
+#include <GLFW/glfw3.h>
 
 // Standard Headers
 #include <cassert>
-#include <fstream>
 #include <memory>
 
 // Define Namespace
 namespace Mirage
 {
+    Shader::~Shader()
+    {
+        GLState::get().deleteProgram(mProgram);
+    }
+
     Shader & Shader::activate()
     {
-        glUseProgram(mProgram);
+        finalize();
+        GLState::get().useProgram(mProgram);
         return *this;
     }
 
+    GLint Shader::uniform(std::string const & name)
+    {
+        finalize();
+        auto it = mUniforms.find(name);
+        return (it != mUniforms.end()) ? it->second : -1;
+    }
+
+    void Shader::bind(unsigned int location, int value) { glUniform1i(location, value); }
     void Shader::bind(unsigned int location, float value) { glUniform1f(location, value); }
+    void Shader::bind(unsigned int location, double value) { glUniform1f(location, GLfloat(value)); }
+    void Shader::bind(unsigned int location, glm::vec2 const & vector)
+    { glUniform2fv(location, 1, glm::value_ptr(vector)); }
+    void Shader::bind(unsigned int location, glm::vec3 const & vector)
+    { glUniform3fv(location, 1, glm::value_ptr(vector)); }
+    void Shader::bind(unsigned int location, glm::vec4 const & vector)
+    { glUniform4fv(location, 1, glm::value_ptr(vector)); }
     void Shader::bind(unsigned int location, glm::mat4 const & matrix)
     { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix)); }
 
-    Shader & Shader::attach(std::string const & filename)
+    Shader & Shader::attach(std::string const & filename, std::string const & directory)
     {
-        // Load GLSL Shader Source from File
-        std::string path = PROJECT_SOURCE_DIR "/Mirage/Shaders/";
-        std::ifstream fd(path + filename);
-        auto src = std::string(std::istreambuf_iterator<char>(fd),
-                              (std::istreambuf_iterator<char>()));
+        // Load GLSL Shader Source from File, Expanding #include Directives;
+        // Compilation is Deferred to link()
+        std::string src;
+        ShaderLibrary::preprocess(directory + filename, src, nullptr, directory);
+        mSources.push_back(std::make_pair(filename, src));
+        return *this;
+    }
 
-        // Create a Shader Object
+    GLuint Shader::compile(std::string const & filename, std::string const & src)
+    {
+        // Create a Shader Object; Status is Checked in finalize()
         const char * source = src.c_str();
         auto shader = create(filename);
         glShaderSource(shader, 1, & source, nullptr);
         glCompileShader(shader);
-        glGetShaderiv(shader, GL_COMPILE_STATUS, & mStatus);
-
-        // Display the Build Log on Error
-        if (mStatus == false)
-        {
-            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, & mLength);
-            std::unique_ptr<char[]> buffer(new char[mLength]);
-            glGetShaderInfoLog(shader, mLength, nullptr, buffer.get());
-            fprintf(stderr, "%s\n%s", filename.c_str(), buffer.get());
-        }
-
-        // Attach the Shader and Free Allocated Memory
         glAttachShader(mProgram, shader);
-        glDeleteShader(shader);
-        return *this;
+        return shader;
     }
 
     GLuint Shader::create(std::string const & filename)
@@ -62,16 +81,152 @@ namespace Mirage
 
     Shader & Shader::link()
     {
-        glLinkProgram(mProgram);
+        submit();
+        finalize();
+        return *this;
+    }
+
+    Shader & Shader::submit()
+    {
+        // Key the Binary Cache on Filenames (Shader Stages) and Sources
+        std::vector<std::string> sources;
+        for (auto & i : mSources)
+        {   sources.push_back(i.first);
+            sources.push_back(i.second);
+        }
+
+        // Restore a Cached Program Binary, Otherwise Issue Compile and Link Only
+        auto & cache = ProgramCache::get();
+        mCacheKey = cache.key(sources);
+        mPending  = true;
+        if (cache.load(mProgram, mCacheKey)) mCacheKey.clear();
+        else
+        {
+            for (auto & i : mSources)
+                mShaders.push_back(std::make_pair(i.first, compile(i.first, i.second)));
+            ProgramCache::prepare(mProgram);
+            glLinkProgram(mProgram);
+        }
+        mSources.clear();
+        return *this;
+    }
+
+    bool Shader::ready()
+    {
+        // Without the Extension Any Status Query Blocks, so Report Ready
+        if (!mPending || mShaders.empty() || !ShaderBatch::parallel()) return true;
+        GLint complete = GL_FALSE;
+        glGetProgramiv(mProgram, GL_COMPLETION_STATUS_KHR, & complete);
+        return complete == GL_TRUE;
+    }
+
+    void Shader::finalize()
+    {
+        if (!mPending) return;
+        mPending = false;
         glGetProgramiv(mProgram, GL_LINK_STATUS, & mStatus);
-        if(mStatus == false)
+
+        // Display the Build Logs on Error
+        if (mStatus == false)
         {
+            for (auto & i : mShaders)
+            {   GLint compiled;
+                glGetShaderiv(i.second, GL_COMPILE_STATUS, & compiled);
+                if (compiled == true) continue;
+                glGetShaderiv(i.second, GL_INFO_LOG_LENGTH, & mLength);
+                std::unique_ptr<char[]> buffer(new char[mLength]);
+                glGetShaderInfoLog(i.second, mLength, nullptr, buffer.get());
+                fprintf(stderr, "%s\n%s", i.first.c_str(), buffer.get());
+            }
             glGetProgramiv(mProgram, GL_INFO_LOG_LENGTH, & mLength);
             std::unique_ptr<char[]> buffer(new char[mLength]);
             glGetProgramInfoLog(mProgram, mLength, nullptr, buffer.get());
             fprintf(stderr, "%s", buffer.get());
         }
+        else if (!mCacheKey.empty()) ProgramCache::get().store(mProgram, mCacheKey);
+
+        // Free Shader Objects Now That the Program is Built
+        for (auto & i : mShaders)
+        {   glDetachShader(mProgram, i.second);
+            glDeleteShader(i.second);
+        }
+        mShaders.clear();
+        mCacheKey.clear();
         assert(mStatus == true);
+        reflect();
+        bindUniformBlocks(mProgram);
+    }
+
+    void Shader::reflect()
+    {
+        // Enumerate Active Uniforms Once After Linking
+        GLint count, length;
+        mUniforms.clear();
+        glGetProgramiv(mProgram, GL_ACTIVE_UNIFORMS, & count);
+        glGetProgramiv(mProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, & length);
+        std::unique_ptr<char[]> buffer(new char[length + 1]);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint  size;
+            GLenum type;
+            glGetActiveUniform(mProgram, i, length + 1, nullptr, & size, & type, buffer.get());
+            std::string name = buffer.get();
+
+            // Skip Uniform Block Members, Which Have No Location
+            GLint location = glGetUniformLocation(mProgram, name.c_str());
+            if (location == -1) continue;
+            mUniforms[name] = location;
+
+            // Register Arrays Under Their Base Name and Every Element
+            auto index = name.find("[");
+            if (index == std::string::npos) continue;
+            auto base = name.substr(0, index);
+            mUniforms[base] = location;
+            for (GLint j = 1; j < size; j++)
+            {
+                auto element = base + "[" + std::to_string(j) + "]";
+                mUniforms[element] = glGetUniformLocation(mProgram, element.c_str());
+            }
+        }
+    }
+
+    ShaderBatch::ShaderBatch()
+    {
+        // Let the Driver Use as Many Compiler Threads as it Likes
+        typedef void (APIENTRYP MaxThreads)(GLuint count);
+        if (!parallel()) return;
+        auto threads = (MaxThreads) glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (!threads) threads = (MaxThreads) glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+        if (threads) threads(0xFFFFFFFF);
+    }
+
+    bool ShaderBatch::parallel()
+    {
+        static bool supported = hasExtension("GL_KHR_parallel_shader_compile")
+                             || hasExtension("GL_ARB_parallel_shader_compile");
+        return supported;
+    }
+
+    ShaderBatch & ShaderBatch::add(Shader & shader)
+    {
+        shader.submit();
+        mPending.push_back(& shader);
         return *this;
     }
+
+    bool ShaderBatch::poll()
+    {
+        // Finalize Completed Programs; Without the Extension Finalize One per
+        // Call so the Unavoidable Stalls are Spread Across Frames
+        bool blocking = false;
+        for (auto it = mPending.begin(); it != mPending.end();)
+        {
+            if (!parallel() && blocking) break;
+            if ((*it)->ready())
+            {   (*it)->finalize();
+                it = mPending.erase(it);
+                blocking = true;
+            }   else ++it;
+        }   return mPending.empty();
+    }
 };
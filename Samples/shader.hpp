@@ -7,6 +7,9 @@
 
 // Standard Headers
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // Define Namespace
 namespace Mirage
@@ -16,22 +19,35 @@ namespace Mirage
     public:
 
         // Implement Custom Constructor and Destructor
-         Shader() { mProgram = glCreateProgram(); }
-        ~Shader() { glDeleteProgram(mProgram); }
+         Shader() : mPending(false) { mProgram = glCreateProgram(); }
+        ~Shader();
 
         // Public Member Functions
         Shader & activate();
-        Shader & attach(std::string const & filename);
+        Shader & attach(std::string const & filename,
+                        std::string const & directory = PROJECT_SOURCE_DIR "/Mirage/Shaders/");
         GLuint   create(std::string const & filename);
-        GLuint   get() { return mProgram; }
+        GLuint   get() { finalize(); return mProgram; }
+        GLint    uniform(std::string const & name);
         Shader & link();
 
+        // Non-Blocking Build: submit() Issues Compile and Link Without Querying
+        // Status, ready() Polls the Driver, and Status Checks Happen on First Use
+        Shader & submit();
+        bool     ready();
+        bool     pending() const { return mPending; }
+
         // Wrap Calls to glUniform
+        void bind(unsigned int location, int value);
         void bind(unsigned int location, float value);
+        void bind(unsigned int location, double value); // Literals Like 1.0 Bind as Float
+        void bind(unsigned int location, glm::vec2 const & vector);
+        void bind(unsigned int location, glm::vec3 const & vector);
+        void bind(unsigned int location, glm::vec4 const & vector);
         void bind(unsigned int location, glm::mat4 const & matrix);
         template<typename T> Shader & bind(std::string const & name, T&& value)
         {
-            int location = glGetUniformLocation(mProgram, name.c_str());
+            int location = uniform(name);
             if (location == -1) fprintf(stderr, "Missing Uniform: %s\n", name.c_str());
             else bind(location, std::forward<T>(value));
             return *this;
@@ -42,11 +58,51 @@ namespace Mirage
         // Disable Copying and Assignment
         Shader(Shader const &) = delete;
         Shader & operator=(Shader const &) = delete;
+        friend class ShaderBatch;
+
+        // Private Member Functions
+        GLuint compile(std::string const & filename, std::string const & source);
+        void   finalize();
+        void   reflect();
+
+        // Private Member Containers
+        std::unordered_map<std::string, GLint> mUniforms;
+        std::vector<std::pair<std::string, std::string>> mSources;
+        std::vector<std::pair<std::string, GLuint>> mShaders;
 
         // Private Member Variables
+        std::string mCacheKey;
         GLuint mProgram;
         GLint  mStatus;
         GLint  mLength;
+        bool   mPending;
+
+    };
+
+    // Compile Many Programs at Once. With KHR_parallel_shader_compile the
+    // Driver Builds Them on its Own Threads While the App Keeps Rendering.
+    //
+    //     ShaderBatch batch;
+    //     batch.add(a.attach("a.vert").attach("a.frag"))
+    //          .add(b.attach("b.vert").attach("b.frag"));
+    //     while (!batch.poll()) drawLoadingScreen();
+    class ShaderBatch
+    {
+    public:
+
+        // Implement Default Constructor
+        ShaderBatch();
+
+        // Public Member Functions
+        ShaderBatch & add(Shader & shader);
+        bool poll();
+        std::size_t remaining() const { return mPending.size(); }
+        static bool parallel();
+
+    private:
+
+        // Private Member Containers
+        std::vector<Shader *> mPending;
 
     };
 };
@@ -0,0 +1,359 @@
+// Preprocessor Directives
+#define STB_IMAGE_IMPLEMENTATION
+
+// Local Headers
+#include "texture.hpp"
+#include "cooked.hpp"
+#include "GLState.hpp"
+#include "ktx.hpp"
+#include "residency.hpp"
+
+// System Headers
+#include <stb_image.h>
+
+// Standard Headers
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Define Namespace
+namespace Mirage
+{
+    Image Image::decode(std::string const & filename)
+    {
+        Image image;
+        image.filename = filename;
+
+        // Cooked Textures are Mapped, Not Decoded; pixels Keeps the Mapping Alive
+        if (filename.substr(filename.find_last_of(".") + 1) == "ktx2")
+        {   auto file = std::make_shared<MappedFile>(filename);
+            if (!Ktx::read(* file, image))
+            {   fprintf(stderr, "%s %s\n", "Invalid Cooked Texture", filename.c_str());
+                Image empty; empty.filename = filename;
+                return empty;
+            }   image.pixels = std::shared_ptr<unsigned char>(file, const_cast<unsigned char *>(file->data()));
+            return image;
+        }
+        unsigned char * pixels = stbi_load(filename.c_str(), & image.width, & image.height, & image.channels, 0);
+        if (!pixels) fprintf(stderr, "%s %s\n", "Failed to Load Texture", filename.c_str());
+        else image.pixels = std::shared_ptr<unsigned char>(pixels, stbi_image_free);
+        return image;
+    }
+
+    bool Image::cook(std::string const & filename, std::string const & output, CompressOptions const & options)
+    {
+        Image image = decode(filename);
+        if (!image.pixels || image.block) return false;
+
+        // Compress Each Level, Then Box Filter it Down for the Next
+        BlockFormat format = pickFormat(image.channels, options);
+        GLsizei count = options.mipmaps ? TextureUploader::levels(image.width, image.height) : 1;
+        std::vector<std::vector<unsigned char>> levels;
+        std::vector<unsigned char> current, next;
+        unsigned char const * pixels = image.pixels.get();
+        int width = image.width, height = image.height;
+        for (GLsizei i = 0; i < count; i++)
+        {   levels.push_back(compress(pixels, width, height, image.channels, format));
+            if (i + 1 == count) break;
+            downsample(pixels, width, height, image.channels, next);
+            current.swap(next);
+            pixels = current.data();
+            width  = std::max(width  >> 1, 1);
+            height = std::max(height >> 1, 1);
+        }   return Ktx::write(output, image.width, image.height, format, levels);
+    }
+
+    TextureUploader::TextureUploader(std::size_t slotSize, unsigned int slots)
+        : mSlotSize(slotSize)
+        , mSlot(0)
+        , mOffset(0)
+        , mMapped(nullptr)
+    {
+        // Persistently Map Every Slot at Once, Otherwise Orphan a Single Slot
+        glGenBuffers(1, & mBuffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer);
+        if (GLAD_GL_VERSION_4_4)
+        {   GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, mSlotSize * slots, nullptr, flags);
+            mMapped = (unsigned char *) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, mSlotSize * slots, flags);
+        }
+        if (mMapped) mFences.assign(slots, nullptr);
+        else glBufferData(GL_PIXEL_UNPACK_BUFFER, mSlotSize, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    TextureUploader::~TextureUploader()
+    {
+        for (auto fence : mFences) if (fence) glDeleteSync(fence);
+        if (mMapped)
+        {   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }   glDeleteBuffers(1, & mBuffer);
+    }
+
+    TextureUploader & TextureUploader::get()
+    {
+        // Never Destroyed; the Buffer Goes Away With the Context
+        static TextureUploader * uploader = new TextureUploader();
+        return * uploader;
+    }
+
+    GLsizei TextureUploader::levels(int width, int height)
+    {
+        GLsizei count = 1;
+        for (int size = std::max(width, height); size > 1; size >>= 1) count++;
+        return count;
+    }
+
+    std::size_t TextureUploader::bytes(Image const & image, bool mipmaps)
+    {
+        // Drivers Usually Pad Three Channel Formats to Four Bytes per Texel
+        std::size_t texel = (image.channels == 3) ? 4 : image.channels, total = 0;
+        if (image.block)
+        {   std::size_t count = mipmaps ? image.levels.size() : 1;
+            for (std::size_t i = 0; i < count; i++) total += image.levels[i].second;
+            return total;
+        }
+        GLsizei count = mipmaps ? levels(image.width, image.height) : 1;
+        for (GLsizei i = 0; i < count; i++)
+            total += std::max(image.width >> i, 1) * std::max(image.height >> i, 1) * texel;
+        return total;
+    }
+
+    GLuint TextureUploader::upload(Image const & image, TextureOptions const & options)
+    {
+        if (!image.pixels) return 0;
+        if (image.block && !blockSupported(image.block->format))
+        {   fprintf(stderr, "%s %s\n", "Unsupported Compressed Texture", image.filename.c_str());
+            return 0;
+        }
+
+        // Bind Texture and Set Filtering Levels
+        GLuint texture; GLenum format, internal;
+        glGenTextures(1, & texture);
+        GLState::get().bindTexture(0, GL_TEXTURE_2D, texture);
+        configure(image.channels, options, format, internal);
+
+        // Cooked Images Bring Their Own Mips; Copy the Blocks From the Mapping
+        if (image.block)
+        {   GLsizei count = options.mipmaps ? GLsizei(image.levels.size()) : 1;
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
+            if (GLAD_GL_VERSION_4_2)
+                glTexStorage2D(GL_TEXTURE_2D, count, image.block->internal, image.width, image.height);
+            for (GLsizei i = 0; i < count; i++)
+            {   GLsizei width = std::max(image.width >> i, 1), height = std::max(image.height >> i, 1);
+                GLsizei size = GLsizei(image.levels[i].second);
+                GLvoid const * blocks = image.pixels.get() + image.levels[i].first;
+                if (GLAD_GL_VERSION_4_2)
+                    glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, width, height, image.block->internal, size, blocks);
+                else glCompressedTexImage2D(GL_TEXTURE_2D, i, image.block->internal, width, height, 0, size, blocks);
+            }   return texture;
+        }
+
+        // Allocate Immutable Storage for the Full Mip Chain
+        GLsizei count = options.mipmaps ? levels(image.width, image.height) : 1;
+        if (!options.mipmaps) glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        if (GLAD_GL_VERSION_4_2)
+            glTexStorage2D(GL_TEXTURE_2D, count, internal, image.width, image.height);
+        else glTexImage2D(GL_TEXTURE_2D, 0, internal, image.width, image.height, 0,
+                          format, GL_UNSIGNED_BYTE, nullptr);
+
+        // Stream Rows Through the Ring, as Many as Fit in One Slot at a Time
+        std::size_t pitch = std::size_t(image.width) * image.channels;
+        int strip = int(mSlotSize / pitch);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (strip == 0) glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height,
+                                        format, GL_UNSIGNED_BYTE, image.pixels.get());
+        else
+        {   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffer);
+            for (int y = 0; y < image.height; y += strip)
+            {   int rows = std::min(strip, image.height - y);
+                std::memcpy(acquire(), image.pixels.get() + y * pitch, rows * pitch);
+                release();
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, image.width, rows,
+                                format, GL_UNSIGNED_BYTE, (GLvoid *) mOffset);
+                fence();
+            }   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // Fill the Remaining Mip Levels on the GPU
+        if (options.mipmaps) glGenerateMipmap(GL_TEXTURE_2D);
+        return texture;
+    }
+
+    void TextureUploader::configure(int channels, TextureOptions const & options, GLenum & format, GLenum & internal)
+    {
+        // Pick a Sized Format; Emulate Grey and Grey-Alpha Images with Swizzles
+        GLint grey[] = { GL_RED, GL_RED, GL_RED, GL_ONE   };
+        GLint pair[] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+        switch (channels)
+        {
+            case 1  : format = GL_RED;  internal = GL_R8;    break;
+            case 2  : format = GL_RG;   internal = GL_RG8;   break;
+            case 3  : format = GL_RGB;  internal = GL_RGB8;  break;
+            default : format = GL_RGBA; internal = GL_RGBA8; break;
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.mipmaps ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+             if (channels == 1) glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, grey);
+        else if (channels == 2) glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, pair);
+    }
+
+    unsigned char * TextureUploader::acquire()
+    {
+        // Orphan the Buffer so the Driver Doesn't Wait on the Previous Copy
+        if (!mMapped)
+        {   mOffset = 0;
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, mSlotSize, nullptr, GL_STREAM_DRAW);
+            return (unsigned char *) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, mSlotSize,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        }
+
+        // Otherwise Wait Until the GPU Has Consumed This Slot's Last Copy
+        GLsync & fence = mFences[mSlot];
+        if (fence)
+        {   GLenum status = GL_TIMEOUT_EXPIRED;
+            while (status == GL_TIMEOUT_EXPIRED)
+                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }   mOffset = mSlot * mSlotSize;
+        return mMapped + mOffset;
+    }
+
+    void TextureUploader::release()
+    {
+        if (!mMapped) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    void TextureUploader::fence()
+    {
+        if (!mMapped) return;
+        mFences[mSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mSlot = (mSlot + 1) % mFences.size();
+    }
+
+    std::string TextureOptions::key() const
+    {
+        return std::to_string(wrap) + (mipmaps ? "|mip" : "|nomip");
+    }
+
+    Texture::Texture(GLuint id, std::size_t bytes, std::string const & key)
+        : mId(id), mBytes(bytes), mKey(key) {}
+
+    Texture::~Texture()
+    {
+        TextureResidency::get().release(mId);
+        GLState::get().deleteTexture(mId);
+        auto & cache = TextureCache::get();
+        std::lock_guard<std::mutex> lock(cache.mMutex);
+        cache.mUsed -= mBytes;
+        auto it = cache.mTextures.find(mKey);
+        if (it != cache.mTextures.end() && it->second.expired())
+            cache.mTextures.erase(it);
+    }
+
+    TextureCache & TextureCache::get()
+    {
+        static TextureCache cache;
+        return cache;
+    }
+
+    std::string TextureCache::resolve(std::string const & filename)
+    {
+        // Prefer the Canonical Path so Links and "../" Segments Share an Entry
+        #ifdef _WIN32
+        char buffer[_MAX_PATH];
+        std::string path = _fullpath(buffer, filename.c_str(), _MAX_PATH) ? buffer : filename;
+        #else
+        char * resolved = realpath(filename.c_str(), nullptr);
+        std::string path = resolved ? resolved : filename;
+        free(resolved);
+        #endif
+        std::replace(path.begin(), path.end(), '\\', '/');
+        return path;
+    }
+
+    std::string TextureCache::key(std::string const & filename, TextureOptions const & options) const
+    {
+        return resolve(filename) + "|" + options.key();
+    }
+
+    bool TextureCache::resident(std::string const & key)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mTextures.find(key);
+        return it != mTextures.end() && !it->second.expired();
+    }
+
+    Image TextureCache::decode(std::string const & key, std::string const & filename)
+    {
+        // The First Thread to Ask Decodes; Everyone Else Waits and Shares the Pixels
+        std::shared_ptr<std::promise<Image>> promise;
+        std::shared_future<Image> future;
+        {   std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mDecoding.find(key);
+            if (it != mDecoding.end()) future = it->second;
+            else
+            {   promise = std::make_shared<std::promise<Image>>();
+                future = mDecoding[key] = promise->get_future().share();
+            }
+        }   if (promise) promise->set_value(Image::decode(filename));
+        return future.get();
+    }
+
+    std::shared_ptr<Texture> TextureCache::acquire(std::string const & key, Image const & image,
+                                                   TextureOptions const & options)
+    {
+        // Share the Resident Texture if There is One
+        {   std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mTextures.find(key);
+            if (it != mTextures.end())
+                if (auto texture = it->second.lock()) return texture;
+        }
+
+        // Otherwise Upload, Decoding First if the Texture Was Released Meanwhile.
+        // Streamed Textures are Counted by the Residency Budget Instead; Cooked
+        // Ones Already Hold Their Mips, so They are Uploaded Whole
+        Image source = image.pixels ? image : decode(key, image.filename);
+        auto & residency = TextureResidency::get();
+        bool streamed = residency.enabled() && options.mipmaps && !source.block;
+        GLuint id = streamed ? residency.create(source, options) : TextureUploader::get().upload(source, options);
+        std::shared_ptr<Texture> texture;
+        if (id) texture = std::make_shared<Texture>(id, streamed ? 0 : TextureUploader::bytes(source, options.mipmaps), key);
+
+        // Register it and Drop the CPU-Side Pixels
+        std::size_t used = 0;
+        {   std::lock_guard<std::mutex> lock(mMutex);
+            mDecoding.erase(key);
+            if (texture)
+            {   mTextures[key] = texture;
+                used = mUsed += texture->bytes();
+            }
+        }   if (mBudget > 0 && used > mBudget) fprintf(stderr, "Texture Budget Exceeded: %zu of %zu Bytes\n", used, mBudget);
+        return texture;
+    }
+
+    void TextureCache::report()
+    {
+        // Copy Live Textures Out Under the Lock, but Print and Let Go After
+        // Unlocking: Dropping the Last Owner Runs ~Texture, Which Locks Again
+        std::vector<std::pair<std::string, std::shared_ptr<Texture>>> live;
+        {   std::lock_guard<std::mutex> lock(mMutex);
+            for (auto & i : mTextures)
+                if (auto texture = i.second.lock())
+                    live.push_back(std::make_pair(i.first, texture));
+        }
+        for (auto & i : live)
+            fprintf(stderr, "%10zu  %s\n", i.second->bytes(), i.first.c_str());
+        fprintf(stderr, "%10zu  Total (Budget %zu)\n", std::size_t(mUsed), mBudget);
+        live.clear();
+        auto & residency = TextureResidency::get();
+        if (residency.enabled())
+            fprintf(stderr, "%10zu  Streamed (Budget %zu, Bias %u)\n", residency.used(), residency.budget(), residency.bias());
+    }
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+// Local Headers
+#include "compress.hpp"
+
+// System Headers
+#include <glad/glad.h>
+
+// Standard Headers
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Decoded Texture Image; Decoding Makes No GL Calls and is Thread Safe.
+    // Files Ending in ".ktx2" are Mapped Instead: block is Set, pixels Holds
+    // the Mapping, and levels Locates Each Compressed Level, Finest First.
+    struct Image
+    {
+        static Image decode(std::string const & filename);
+
+        // Compress an Image Offline Into a KTX2 File With its Whole Mip Chain
+        // (See ktx.hpp), Which decode() Then Maps Without Any Per-Texel Work
+        static bool cook(std::string const & filename, std::string const & output,
+                         CompressOptions const & options = CompressOptions());
+
+        std::string filename;
+        std::shared_ptr<unsigned char> pixels;
+        int width    = 0;
+        int height   = 0;
+        int channels = 0;
+        BlockInfo const * block = nullptr;
+        std::vector<std::pair<std::size_t, std::size_t>> levels; // Offset Into pixels, Size
+    };
+
+    // Sampling and Storage Choices That Make Two Loads of One File Distinct
+    struct TextureOptions
+    {
+        std::string key() const;
+
+        GLint wrap   = GL_REPEAT;
+        bool mipmaps = true;
+    };
+
+    // Reference Counted GL Texture; Deleted When the Last Mesh Lets Go of it
+    class Texture
+    {
+    public:
+
+        // Implement Custom Constructor and Destructor
+        Texture(GLuint id, std::size_t bytes, std::string const & key);
+        ~Texture();
+
+        // Public Member Functions
+        GLuint id() const { return mId; }
+        std::size_t bytes() const { return mBytes; }
+        std::string const & key() const { return mKey; }
+
+    private:
+
+        // Disable Copying and Assignment
+        Texture(Texture const &) = delete;
+        Texture & operator=(Texture const &) = delete;
+
+        // Private Member Variables
+        GLuint mId;
+        std::size_t mBytes;
+        std::string mKey;
+
+    };
+
+    // Uploads Images Through a Ring of Pixel Unpack Buffer Slots. Each Slot is
+    // Fenced After Use, so Copies Overlap GPU Work Instead of Stalling on it.
+    // Images Larger Than a Slot are Streamed in Strips of Rows.
+    class TextureUploader
+    {
+    public:
+
+        // Implement Custom Constructor and Destructor
+        TextureUploader(std::size_t slotSize = 8 << 20, unsigned int slots = 4);
+        ~TextureUploader();
+
+        // Public Member Functions
+        GLuint upload(Image const & image, TextureOptions const & options = TextureOptions());
+        static TextureUploader & get();
+        static GLsizei levels(int width, int height);
+        static std::size_t bytes(Image const & image, bool mipmaps);
+
+        // Set Wrapping, Filtering and Swizzles on the Texture Bound to Unit 0,
+        // and Pick the Pixel Format and Sized Format for the Channel Count
+        static void configure(int channels, TextureOptions const & options, GLenum & format, GLenum & internal);
+
+    private:
+
+        // Disable Copying and Assignment
+        TextureUploader(TextureUploader const &) = delete;
+        TextureUploader & operator=(TextureUploader const &) = delete;
+
+        // Private Member Functions
+        unsigned char * acquire();
+        void release();
+        void fence();
+
+        // Private Member Containers
+        std::vector<GLsync> mFences;
+
+        // Private Member Variables
+        GLuint mBuffer;
+        std::size_t mSlotSize;
+        unsigned int mSlot;
+        std::size_t mOffset;
+        unsigned char * mMapped;
+
+    };
+
+    // Process-Wide Texture Cache Keyed by Resolved Path and Options. Sub-Meshes
+    // and Models That Reference the Same File Share One Decode and One GL Texture.
+    // Lookups and Decodes are Thread Safe; acquire() Must Run on the GL Thread.
+    class TextureCache
+    {
+    public:
+
+        // Public Member Functions
+        static TextureCache & get();
+        static std::string resolve(std::string const & filename);
+        std::string key(std::string const & filename, TextureOptions const & options) const;
+
+        bool resident(std::string const & key);
+        Image decode(std::string const & key, std::string const & filename);
+        std::shared_ptr<Texture> acquire(std::string const & key, Image const & image,
+                                         TextureOptions const & options = TextureOptions());
+
+        // Memory Accounting
+        void setBudget(std::size_t bytes) { mBudget = bytes; }
+        std::size_t budget() const { return mBudget; }
+        std::size_t used() const { return mUsed; }
+        void report();
+
+    private:
+
+        // Implement Default Constructor
+        TextureCache() : mBudget(0), mUsed(0) {}
+        friend class Texture;
+
+        // Private Member Containers
+        std::map<std::string, std::weak_ptr<Texture>> mTextures;
+        std::map<std::string, std::shared_future<Image>> mDecoding;
+
+        // Private Member Variables
+        std::mutex mMutex;
+        std::size_t mBudget;
+        std::atomic<std::size_t> mUsed; // Written Under mMutex, Read by used() Without it
+
+    };
+};
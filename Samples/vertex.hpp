@@ -0,0 +1,276 @@
+#pragma once
+
+// System Headers
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Standard Headers
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Define Namespace
+namespace Mirage
+{
+    // Vertex Format
+    struct Vertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+
+    // Axis-Aligned Box, Also the Frame Quantized Positions are Stored In. That
+    // Scale is Uniform, so Folding unpack() Into a Model Matrix Leaves Normal
+    // Matrices Correct Up to Length, Which the Shader Normalizes Away Anyway.
+    struct Bounds {
+        Bounds() : min(INFINITY), max(-INFINITY) {}
+        void add(glm::vec3 const & point) { min = glm::min(min, point); max = glm::max(max, point); }
+        void add(std::vector<Vertex> const & vertices) { for (auto & i : vertices) add(i.position); }
+        void add(Bounds const & other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+        bool empty() const { return min.x > max.x; }
+
+        // Box Around This Box After a Transform (Arvo's Method)
+        Bounds transformed(glm::mat4 const & matrix) const
+        {   Bounds result; if (empty()) return result;
+            glm::vec3 middle = glm::vec3(matrix * glm::vec4(center(), 1.0f)), half = (max - min) * 0.5f, extent(0.0f);
+            for (int i = 0; i < 3; i++) extent += glm::abs(glm::vec3(matrix[i])) * half[i];
+            result.min = middle - extent;
+            result.max = middle + extent;
+            return result;
+        }
+
+        glm::vec3 center() const { return (min + max) * 0.5f; }
+        float     radius() const
+        {   glm::vec3 extent = (max - min) * 0.5f;
+            float largest = std::fmax(extent.x, std::fmax(extent.y, extent.z));
+            return largest > 0.0f ? largest : 1.0f;
+        }
+
+        // Map Positions Into [-1, 1] and Back
+        glm::vec3 relative(glm::vec3 const & point) const { return (point - center()) / radius(); }
+        glm::mat4 unpack() const
+        {   return glm::scale(glm::translate(glm::mat4(1.0f), center()), glm::vec3(radius()));
+        }
+
+        glm::vec3 min, max;
+    };
+
+    // Ritter's Bounding Sphere as (Center, Radius); Within a Few Percent of Minimal
+    inline glm::vec4 boundingSphere(Vertex const * vertices, std::size_t count)
+    {
+        if (count == 0) return glm::vec4(0.0f);
+
+        // Seed With the Most Separated Pair of Axis Extremes
+        std::size_t lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+        for (std::size_t i = 0; i < count; i++)
+        for (int axis = 0; axis < 3; axis++)
+        {   if (vertices[i].position[axis] < vertices[lo[axis]].position[axis]) lo[axis] = i;
+            if (vertices[i].position[axis] > vertices[hi[axis]].position[axis]) hi[axis] = i;
+        }
+        int axis = 0;
+        for (int i = 1; i < 3; i++)
+            if (glm::distance(vertices[lo[i]].position, vertices[hi[i]].position) >
+                glm::distance(vertices[lo[axis]].position, vertices[hi[axis]].position)) axis = i;
+        glm::vec3 center = (vertices[lo[axis]].position + vertices[hi[axis]].position) * 0.5f;
+        float radius = glm::distance(vertices[lo[axis]].position, vertices[hi[axis]].position) * 0.5f;
+
+        // Grow Just Enough to Take in Each Outlying Point
+        for (std::size_t i = 0; i < count; i++)
+        {   float distance = glm::distance(vertices[i].position, center);
+            if (distance <= radius) continue;
+            float grown = (radius + distance) * 0.5f;
+            center += (vertices[i].position - center) * ((grown - radius) / distance);
+            radius  = grown;
+        }   return glm::vec4(center, radius);
+    }
+
+    // UV Units per Model Unit, as the Square Root of the Ratio of Summed
+    // Triangle Areas in UV and Model Space; Zero for Untextured Triangles
+    inline float uvDensity(Vertex const * vertices, GLuint const * indices, std::size_t count)
+    {
+        float uv = 0.0f, model = 0.0f;
+        for (std::size_t i = 0; i + 2 < count; i += 3)
+        {   Vertex const & a = vertices[indices[i]], & b = vertices[indices[i + 1]], & c = vertices[indices[i + 2]];
+            glm::vec2 u = b.uv - a.uv, v = c.uv - a.uv;
+            uv    += std::fabs(u.x * v.y - u.y * v.x);
+            model += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+        }   return model > 0.0f ? std::sqrt(uv / model) : 0.0f;
+    }
+
+    // Bit Packing Helpers
+    namespace Pack
+    {
+        // IEEE Half, Rounded to Nearest; Overflow Becomes Infinity
+        inline uint16_t half(float value)
+        {   uint32_t bits; std::memcpy(& bits, & value, sizeof(bits));
+            uint32_t sign     = (bits >> 16) & 0x8000;
+            uint32_t mantissa =  bits & 0x7FFFFF;
+            int32_t  exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+            if (((bits >> 23) & 0xFF) == 0xFF) return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+            if (exponent >= 31) return uint16_t(sign | 0x7C00);
+            if (exponent <= 0)
+            {   if (exponent < -10) return uint16_t(sign);
+                mantissa = (mantissa | 0x800000) >> (1 - exponent);
+                return uint16_t(sign | ((mantissa + 0x1000) >> 13));
+            }   // A Rounding Carry Correctly Spills Into the Exponent
+            return uint16_t((sign | (uint32_t(exponent) << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+        }
+
+        inline int16_t snorm16(float value)
+        {   return int16_t(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+        }
+
+        // Three Signed 10-Bit Components in GL_INT_2_10_10_10_REV Order
+        inline uint32_t snorm1010102(glm::vec3 const & value)
+        {   uint32_t packed = 0;
+            for (int i = 0; i < 3; i++)
+            {   int32_t component = int32_t(std::lround(glm::clamp(value[i], -1.0f, 1.0f) * 511.0f));
+                packed |= (uint32_t(component) & 0x3FF) << (10 * i);
+            }   return packed;
+        }
+
+        // Project a Unit Vector Onto the Octahedron, Folding the Lower Half Over
+        inline glm::vec2 octahedral(glm::vec3 const & normal)
+        {   glm::vec3 n = normal / (std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z));
+            if (n.z >= 0.0f) return glm::vec2(n.x, n.y);
+            return glm::vec2((1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                             (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+        }
+    };
+
+    // Attribute Encodings. Each Names its Storage, How OpenGL Reads it, and
+    // How to Fill it. Positions Marked Relative are Stored Inside Bounds.
+    struct FloatPosition {
+        typedef glm::vec3 Type;
+        static constexpr GLint size = 3; static constexpr GLenum type = GL_FLOAT;
+        static constexpr GLboolean normalized = GL_FALSE; static constexpr bool relative = false;
+        static void encode(Type & out, glm::vec3 const & value) { out = value; }
+    };
+
+    struct HalfPosition {
+        struct Type { uint16_t value[4]; };
+        static constexpr GLint size = 4; static constexpr GLenum type = GL_HALF_FLOAT;
+        static constexpr GLboolean normalized = GL_FALSE; static constexpr bool relative = true;
+        static void encode(Type & out, glm::vec3 const & value)
+        {   for (int i = 0; i < 3; i++) out.value[i] = Pack::half(value[i]);
+            out.value[3] = 0x3C00; // 1.0
+        }
+    };
+
+    struct Snorm16Position {
+        struct Type { int16_t value[4]; };
+        static constexpr GLint size = 4; static constexpr GLenum type = GL_SHORT;
+        static constexpr GLboolean normalized = GL_TRUE; static constexpr bool relative = true;
+        static void encode(Type & out, glm::vec3 const & value)
+        {   for (int i = 0; i < 3; i++) out.value[i] = Pack::snorm16(value[i]);
+            out.value[3] = 32767; // 1.0
+        }
+    };
+
+    struct FloatNormal {
+        typedef glm::vec3 Type;
+        static constexpr GLint size = 3; static constexpr GLenum type = GL_FLOAT;
+        static constexpr GLboolean normalized = GL_FALSE;
+        static void encode(Type & out, glm::vec3 const & value) { out = value; }
+    };
+
+    struct PackedNormal {
+        typedef uint32_t Type;
+        static constexpr GLint size = 4; static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+        static constexpr GLboolean normalized = GL_TRUE;
+        static void encode(Type & out, glm::vec3 const & value) { out = Pack::snorm1010102(value); }
+    };
+
+    // Decode in the Vertex Shader:
+    //
+    //     vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    //     if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+    //     normal = normalize(n);
+    struct OctahedralNormal {
+        struct Type { int16_t value[2]; };
+        static constexpr GLint size = 2; static constexpr GLenum type = GL_SHORT;
+        static constexpr GLboolean normalized = GL_TRUE;
+        static void encode(Type & out, glm::vec3 const & value)
+        {   glm::vec2 folded = Pack::octahedral(value);
+            out.value[0] = Pack::snorm16(folded.x);
+            out.value[1] = Pack::snorm16(folded.y);
+        }
+    };
+
+    struct FloatUV {
+        typedef glm::vec2 Type;
+        static constexpr GLint size = 2; static constexpr GLenum type = GL_FLOAT;
+        static constexpr GLboolean normalized = GL_FALSE;
+        static void encode(Type & out, glm::vec2 const & value) { out = value; }
+    };
+
+    struct HalfUV {
+        struct Type { uint16_t value[2]; };
+        static constexpr GLint size = 2; static constexpr GLenum type = GL_HALF_FLOAT;
+        static constexpr GLboolean normalized = GL_FALSE;
+        static void encode(Type & out, glm::vec2 const & value)
+        {   out.value[0] = Pack::half(value.x);
+            out.value[1] = Pack::half(value.y);
+        }
+    };
+
+    // Interleaved Vertex Built From One Encoding per Attribute. Attribute
+    // Pointers are Generated From the Encodings, so Adding a Layout Needs No
+    // Changes to the Upload Code.
+    template<typename Position, typename Normal, typename UV>
+    struct VertexLayout {
+        typename Position::Type position;
+        typename Normal::Type   normal;
+        typename UV::Type       uv;
+
+        static constexpr bool relative = Position::relative;
+
+        static VertexLayout pack(Vertex const & vertex, Bounds const & bounds)
+        {   VertexLayout packed;
+            Position::encode(packed.position, relative ? bounds.relative(vertex.position) : vertex.position);
+            Normal::encode(packed.normal, vertex.normal);
+            UV::encode(packed.uv, vertex.uv);
+            return packed;
+        }
+
+        // Set Vertex Attribute Pointers for the Bound Vertex Buffer
+        static void attributes(std::size_t offset)
+        {   attribute<Position>(0, offset + offsetof(VertexLayout, position)); // Vertex Positions
+            attribute<Normal>  (1, offset + offsetof(VertexLayout, normal));   // Vertex Normals
+            attribute<UV>      (2, offset + offsetof(VertexLayout, uv));       // Vertex UVs
+        }
+
+    private:
+
+        template<typename Attribute> static void attribute(GLuint location, std::size_t offset)
+        {   glVertexAttribPointer(location, Attribute::size, Attribute::type, Attribute::normalized,
+                                  sizeof(VertexLayout), (GLvoid *) offset);
+            glEnableVertexAttribArray(location);
+        }
+    };
+
+    // Layouts Selectable per Mesh
+    typedef VertexLayout<FloatPosition,   FloatNormal,      FloatUV> FloatVertex;   // 32 Bytes
+    typedef VertexLayout<HalfPosition,    PackedNormal,     HalfUV>  HalfVertex;    // 16 Bytes
+    typedef VertexLayout<Snorm16Position, OctahedralNormal, HalfUV>  CompactVertex; // 16 Bytes
+    static_assert(sizeof(FloatVertex)   == sizeof(Vertex), "FloatVertex must Match Vertex");
+    static_assert(sizeof(HalfVertex)    == 16, "HalfVertex must be Tightly Packed");
+    static_assert(sizeof(CompactVertex) == 16, "CompactVertex must be Tightly Packed");
+
+    enum class VertexFormat { Float, Half, Compact };
+
+    // Pack and Upload Vertices to the Bound Array Buffer, Then Point the
+    // Bound Vertex Array at Them
+    template<typename Layout>
+    void upload(std::vector<Vertex> const & vertices, Bounds const & bounds)
+    {
+        std::vector<Layout> packed;
+        packed.reserve(vertices.size());
+        for (auto & i : vertices) packed.push_back(Layout::pack(i, bounds));
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(Layout), packed.data(), GL_STATIC_DRAW);
+        Layout::attributes(0);
+    }
+};